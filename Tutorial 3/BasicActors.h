@@ -24,6 +24,8 @@ namespace PhysicsEngine
 
 			numberOfActors++;
 		}
+
+		CompoundPlayer(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundJoust : public DynamicActor
@@ -44,6 +46,8 @@ namespace PhysicsEngine
 			GetShape(3)->setLocalPose(PxTransform(PxVec3(1.2f, 0.0f, -2.5f)));
 			numberOfActors++;
 		}
+
+		CompoundJoust(CheckpointActor& state) : DynamicActor(state) {}
 	};
 	class CompoundGoal : public DynamicActor
 	{
@@ -62,6 +66,8 @@ namespace PhysicsEngine
 			numberOfActors++;
 
 		}
+
+		CompoundGoal(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundCatapult : public DynamicActor
@@ -84,6 +90,8 @@ namespace PhysicsEngine
 			GetShape(4)->setLocalPose(PxTransform(PxVec3(1.4f, -3.0f, 0.0f), PxQuat(PxPi / 5, PxVec3(0.0f, 0.0f, 1.0f))));
 			numberOfActors++;
 		}
+
+		CompoundCatapult(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundCatapultThrow : public DynamicActor
@@ -100,6 +108,8 @@ namespace PhysicsEngine
 			GetShape(2)->setLocalPose(PxTransform(PxVec3(0.0f, -0.2f, -2.0f)));
 			numberOfActors++;
 		}
+
+		CompoundCatapultThrow(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundField : public DynamicActor
@@ -122,6 +132,8 @@ namespace PhysicsEngine
 			GetShape(4)->setLocalPose(PxTransform(PxVec3(40, 0.0f, -50.0f))); // right side of feild
 			numberOfActors++;
 		}
+
+		CompoundField(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundGun : public DynamicActor
@@ -143,6 +155,8 @@ namespace PhysicsEngine
 			numberOfActors++;
 
 		}
+
+		CompoundGun(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class CompoundWall : public DynamicActor
@@ -173,6 +187,8 @@ namespace PhysicsEngine
 
 			PhysicsEngine::numberOfActors++;
 		}
+
+		CompoundWall(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class compoundRugbyBall : public DynamicActor
@@ -190,6 +206,8 @@ namespace PhysicsEngine
 			GetShape(3)->setLocalPose(PxTransform(PxVec3(0.7f, 0.0f, 0.0f)));
 			numberOfActors++;
 		}
+
+		compoundRugbyBall(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class compoundFireworkBase : public DynamicActor
@@ -223,6 +241,8 @@ namespace PhysicsEngine
 			CreateShape(PxPlaneGeometry());
 			numberOfActors++;
 		}
+
+		Plane(CheckpointActor& state) : StaticActor(state) {}
 	};
 
 	///Sphere class
@@ -239,6 +259,8 @@ namespace PhysicsEngine
 			CreateShape(PxSphereGeometry(radius), density);
 			numberOfActors++;
 		}
+
+		Sphere(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	///Box class
@@ -255,6 +277,8 @@ namespace PhysicsEngine
 			CreateShape(PxBoxGeometry(dimensions), density);
 			numberOfActors++;
 		}
+
+		Box(CheckpointActor& state) : DynamicActor(state) {}
 	};
 
 	class Capsule : public DynamicActor
@@ -351,6 +375,8 @@ namespace PhysicsEngine
 			Stiffness(1.f);
 		}
 
+		DistanceJoint(CheckpointJoint& state) : Joint(state) {}
+
 		void Stiffness(PxReal value)
 		{
 			((PxDistanceJoint*)joint)->setStiffness(value);
@@ -386,6 +412,8 @@ namespace PhysicsEngine
 			joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION,true);
 		}
 
+		RevoluteJoint(CheckpointJoint& state) : Joint(state) {}
+
 		void DriveVelocity(PxReal value)
 		{
 			//wake up the attached actors
@@ -420,17 +448,22 @@ namespace PhysicsEngine
 	class Cloth : public Actor
 	{
 		PxClothMeshDesc mesh_desc;
+		//the renderer and Save read the quads through UserData, the particles are only needed for cooking
+		std::vector<PxU32> quads;
 
 	public:
 		//constructor
 		Cloth(PxTransform pose = PxTransform(PxIdentity), const PxVec2& size = PxVec2(1.f, 1.f), PxU32 width = 1, PxU32 height = 1, bool fix_top = true)
 		{
+			MemoryScope scope(MEMORY_CLOTH);
+
 			//prepare vertices
 			PxReal w_step = size.x / width;
 			PxReal h_step = size.y / height;
 
-			PxClothParticle* vertices = new PxClothParticle[(width + 1)*(height + 1) * 4];
-			PxU32* quads = new PxU32[width*height * 4];
+			std::vector<PxClothParticle> vertices((width + 1)*(height + 1));
+			quads.resize(width*height * 4);
+			GetTrackingAllocator().Track(MEMORY_CLOTH, sizeof(PxU32)*quads.size());
 
 			for (PxU32 j = 0; j < (height + 1); j++)
 			{
@@ -458,15 +491,15 @@ namespace PhysicsEngine
 			}
 
 			//init cloth mesh description
-			mesh_desc.points.data = vertices;
+			mesh_desc.points.data = &vertices.front();
 			mesh_desc.points.count = (width + 1)*(height + 1);
 			mesh_desc.points.stride = sizeof(PxClothParticle);
 
-			mesh_desc.invMasses.data = &vertices->invWeight;
+			mesh_desc.invMasses.data = &vertices.front().invWeight;
 			mesh_desc.invMasses.count = (width + 1)*(height + 1);
 			mesh_desc.invMasses.stride = sizeof(PxClothParticle);
 
-			mesh_desc.quads.data = quads;
+			mesh_desc.quads.data = &quads.front();
 			mesh_desc.quads.count = width * height;
 			mesh_desc.quads.stride = sizeof(PxU32) * 4;
 
@@ -474,19 +507,42 @@ namespace PhysicsEngine
 			PxClothFabric* fabric = PxClothFabricCreate(*GetPhysics(), mesh_desc, PxVec3(0, -1, 0));
 
 			//create cloth
-			actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, vertices, PxClothFlags());
+			actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, &vertices.front(), PxClothFlags());
 			//collisions with the scene objects
 			((PxCloth*)actor)->setClothFlag(PxClothFlag::eSCENE_COLLISION, true);
 
+			//the cloth has its own copy of the particles
+			mesh_desc.points.data = 0;
+			mesh_desc.invMasses.data = 0;
+
 			colors.push_back(default_color);
 			actor->userData = new UserData(&colors.back(), &mesh_desc);
 
 			numberOfActors++;
 		}
 
+		///A cloth loaded from a checkpoint, the renderer only needs the quads of the mesh
+		Cloth(CheckpointActor& state) : Actor(state)
+		{
+			MemoryScope scope(MEMORY_CLOTH);
+
+			quads = state.quads;
+			GetTrackingAllocator().Track(MEMORY_CLOTH, sizeof(PxU32)*quads.size());
+
+			mesh_desc.points.count = ((PxCloth*)actor)->getNbParticles();
+			mesh_desc.quads.data = quads.size() ? &quads.front() : 0;
+			mesh_desc.quads.count = (PxU32)state.quads.size() / 4;
+			mesh_desc.quads.stride = sizeof(PxU32) * 4;
+
+			if (colors.empty())
+				colors.push_back(default_color);
+			actor->userData = new UserData(&colors.back(), &mesh_desc);
+		}
+
 		~Cloth()
 		{
 			delete (UserData*)actor->userData;
+			GetTrackingAllocator().Untrack(MEMORY_CLOTH, sizeof(PxU32)*quads.size());
 		}
 	};
 }
\ No newline at end of file
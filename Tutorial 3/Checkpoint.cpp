@@ -0,0 +1,565 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "PhysicsEngine.h"
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const PxU32 CHECKPOINT_MAGIC = 0x4b435850;
+	//2: the gameplay state is made of typed entries
+	static const PxU32 CHECKPOINT_VERSION = 2;
+	//PhysX needs the collection 128 byte aligned, the mapping itself is page aligned
+	static const size_t CHECKPOINT_HEADER = 128;
+
+	///Start of the file, padded to CHECKPOINT_HEADER
+	struct CheckpointHeader
+	{
+		PxU32 magic, version;
+		PxU64 collection_size;
+		PxU64 table_offset, table_size;
+	};
+
+	///A mapping that holds PhysX objects, with the objects that are released together with it
+	struct CheckpointMemory
+	{
+		void* data;
+		size_t size;
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping;
+#endif
+		PxCollection* objects;
+	};
+
+	//kept by the scenes, the ones left are unmapped by PxRelease
+	static vector<CheckpointMemory*> checkpoint_memory;
+
+	static void Unmap(const CheckpointMemory& memory)
+	{
+#ifdef _WIN32
+		if (memory.data)
+			UnmapViewOfFile(memory.data);
+		if (memory.mapping)
+			CloseHandle(memory.mapping);
+		if (memory.file_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(memory.file_handle);
+#else
+		if (memory.data)
+			munmap(memory.data, memory.size);
+#endif
+	}
+
+	template<class T> void PutTable(vector<PxU8>& buffer, const T& value)
+	{
+		const PxU8* bytes = (const PxU8*)&value;
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	///Reads the side table, stops at its end instead of reading past it
+	struct TableReader
+	{
+		const PxU8* p;
+		const PxU8* end;
+		bool ok;
+
+		TableReader(const PxU8* _p, const PxU8* _end) : p(_p), end(_end), ok(true) {}
+
+		template<class T> T Get()
+		{
+			T value;
+			if (p + sizeof(T) > end)
+			{
+				ok = false;
+				memset(&value, 0, sizeof(T));
+				return value;
+			}
+			memcpy(&value, p, sizeof(T));
+			p += sizeof(T);
+			return value;
+		}
+
+		///Pointer to count items of type T, 0 if the table is too short
+		template<class T> const T* Array(PxU32 count)
+		{
+			if ((size_t)(end - p)/sizeof(T) < count)
+			{
+				ok = false;
+				return 0;
+			}
+			const T* items = (const T*)p;
+			p += count*sizeof(T);
+			return items;
+		}
+	};
+
+	///CheckpointWriter methods
+	CheckpointWriter::CheckpointWriter() : collection(PxCreateCollection())
+	{
+	}
+
+	CheckpointWriter::~CheckpointWriter()
+	{
+		collection->release();
+	}
+
+	void CheckpointWriter::Add(PxActor& actor)
+	{
+		actors.push_back(&actor);
+		collection->add(actor, actors.size() + joints.size());
+	}
+
+	void CheckpointWriter::Add(PxJoint& joint)
+	{
+		joints.push_back(&joint);
+		collection->add(joint, actors.size() + joints.size());
+	}
+
+	PxSerialObjectId CheckpointWriter::Id(const PxBase* object) const
+	{
+		return object ? collection->getId(*object) : 0;
+	}
+
+	void CheckpointWriter::PutEntry(CheckpointEntry kind, const void* value, size_t bytes)
+	{
+		custom.push_back((PxU8)kind);
+		PxU32 size = (PxU32)bytes;
+		custom.insert(custom.end(), (const PxU8*)&size, (const PxU8*)&size + sizeof(size));
+		custom.insert(custom.end(), (const PxU8*)value, (const PxU8*)value + bytes);
+	}
+
+	void CheckpointWriter::Put(const string& value)
+	{
+		PutEntry(CHECKPOINT_STRING, value.data(), value.size());
+	}
+
+	bool CheckpointWriter::Write(const string& filename)
+	{
+		PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(*GetPhysics());
+
+		//materials, shapes, meshes and cloth fabrics come along with the actors
+		PxSerialization::complete(*collection, *registry);
+
+		PxDefaultMemoryOutputStream binary;
+		bool serialized = PxSerialization::isSerializable(*collection, *registry) &&
+			PxSerialization::serializeCollectionToBinary(binary, *collection, *registry);
+		registry->release();
+
+		if (!serialized)
+		{
+			cerr << "CheckpointWriter: the scene could not be serialised" << endl;
+			return false;
+		}
+
+		//side table: the wrapper state of every actor, the joints and the gameplay state
+		vector<PxU8> table;
+		PutTable(table, (PxU32)actors.size());
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			PxActor* actor = actors[i];
+			PutTable(table, Id(actor));
+
+			string name = actor->getName() ? actor->getName() : "";
+			PutTable(table, (PxU32)name.size());
+			table.insert(table.end(), name.begin(), name.end());
+
+			//the colours live in the wrappers, the shapes only point at them
+			vector<PxVec3> colors;
+			vector<PxU32> quads;
+			if (actor->isRigidActor())
+			{
+				PxRigidActor* rigid_actor = (PxRigidActor*)actor;
+				vector<PxShape*> shapes(rigid_actor->getNbShapes());
+				if (shapes.size())
+					rigid_actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					const UserData* user_data = (const UserData*)shapes[j]->userData;
+					colors.push_back((user_data && user_data->color) ? *user_data->color : PxVec3(-1.f));
+				}
+			}
+			else if (actor->isCloth() && actor->userData)
+			{
+				const UserData* user_data = (const UserData*)actor->userData;
+				colors.push_back(user_data->color ? *user_data->color : PxVec3(-1.f));
+				const PxClothMeshDesc* mesh_desc = user_data->cloth_mesh_desc;
+				if (mesh_desc)
+				{
+					const PxU8* quad = (const PxU8*)mesh_desc->quads.data;
+					for (PxU32 j = 0; j < mesh_desc->quads.count; j++, quad += mesh_desc->quads.stride)
+						quads.insert(quads.end(), (const PxU32*)quad, (const PxU32*)quad + 4);
+				}
+			}
+
+			PutTable(table, (PxU32)colors.size());
+			for (PxU32 j = 0; j < colors.size(); j++)
+				PutTable(table, colors[j]);
+			PutTable(table, (PxU32)quads.size());
+			for (PxU32 j = 0; j < quads.size(); j++)
+				PutTable(table, quads[j]);
+		}
+
+		PutTable(table, (PxU32)joints.size());
+		for (PxU32 i = 0; i < joints.size(); i++)
+			PutTable(table, Id(joints[i]));
+
+		PutTable(table, (PxU32)custom.size());
+		table.insert(table.end(), custom.begin(), custom.end());
+
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (!file)
+		{
+			cerr << "CheckpointWriter: could not open " << filename << endl;
+			return false;
+		}
+
+		PxU8 header[CHECKPOINT_HEADER] = { 0 };
+		CheckpointHeader* h = (CheckpointHeader*)header;
+		h->magic = CHECKPOINT_MAGIC;
+		h->version = CHECKPOINT_VERSION;
+		h->collection_size = binary.getSize();
+		h->table_offset = CHECKPOINT_HEADER + binary.getSize();
+		h->table_size = table.size();
+
+		bool written = (fwrite(header, sizeof(header), 1, file) == 1) &&
+			(!binary.getSize() || (fwrite(binary.getData(), binary.getSize(), 1, file) == 1)) &&
+			(fwrite(&table.front(), table.size(), 1, file) == 1);
+		written = (fclose(file) == 0) && written;
+
+		if (!written)
+			cerr << "CheckpointWriter: could not write " << filename << endl;
+		return written;
+	}
+
+	///CheckpointReader methods
+	CheckpointReader::CheckpointReader() : data(0), size(0), collection(0), custom(0), custom_end(0), created(false)
+	{
+#ifdef _WIN32
+		file_handle = INVALID_HANDLE_VALUE;
+		mapping = 0;
+#endif
+	}
+
+	CheckpointReader::~CheckpointReader()
+	{
+		Close();
+	}
+
+	bool CheckpointReader::Open(const string& filename)
+	{
+		Close();
+
+		//copy on write: PhysX fixes up the pointers of the objects in place
+#ifdef _WIN32
+		file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		LARGE_INTEGER file_size;
+		if ((file_handle != INVALID_HANDLE_VALUE) && GetFileSizeEx(file_handle, &file_size) && (file_size.QuadPart > 0))
+		{
+			mapping = CreateFileMappingA(file_handle, 0, PAGE_WRITECOPY, 0, 0, 0);
+			if (mapping)
+			{
+				data = (PxU8*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+				size = (size_t)file_size.QuadPart;
+			}
+		}
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		struct stat file_stat;
+		if ((fd >= 0) && (fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0))
+		{
+			void* memory = mmap(0, (size_t)file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (memory != MAP_FAILED)
+			{
+				data = (PxU8*)memory;
+				size = (size_t)file_stat.st_size;
+			}
+		}
+		//the mapping stays valid without the descriptor
+		if (fd >= 0)
+			close(fd);
+#endif
+
+		if (!data)
+		{
+			cerr << "CheckpointReader: could not open " << filename << endl;
+			Close();
+			return false;
+		}
+
+		const CheckpointHeader* h = (const CheckpointHeader*)data;
+		if ((size < CHECKPOINT_HEADER) || (h->magic != CHECKPOINT_MAGIC) || (h->version != CHECKPOINT_VERSION) ||
+			(h->table_offset != CHECKPOINT_HEADER + h->collection_size) || (h->table_offset + h->table_size > size))
+		{
+			cerr << "CheckpointReader: " << filename << " is not a checkpoint" << endl;
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void CheckpointReader::Close()
+	{
+		//objects no scene has taken go before their memory
+		if (collection)
+		{
+			if (created)
+				PxCollectionExt::releaseObjects(*collection);
+			collection->release();
+			collection = 0;
+		}
+
+		CheckpointMemory memory;
+		memory.data = data;
+		memory.size = size;
+#ifdef _WIN32
+		memory.file_handle = file_handle;
+		memory.mapping = mapping;
+		mapping = 0;
+		file_handle = INVALID_HANDLE_VALUE;
+#endif
+		Unmap(memory);
+
+		data = 0;
+		size = 0;
+		actors.clear();
+		joints.clear();
+		custom = custom_end = 0;
+		created = false;
+	}
+
+	bool CheckpointReader::Deserialize()
+	{
+		if (!data || created)
+			return false;
+
+		const CheckpointHeader* h = (const CheckpointHeader*)data;
+		PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(*GetPhysics());
+		collection = PxSerialization::createCollectionFromBinary(data + CHECKPOINT_HEADER, *registry);
+		registry->release();
+		if (!collection)
+		{
+			//e.g. written by another PhysX version or platform
+			cerr << "CheckpointReader: the PhysX objects could not be created" << endl;
+			Close();
+			return false;
+		}
+		created = true;
+
+		TableReader table(data + h->table_offset, data + h->table_offset + h->table_size);
+		PxU32 actor_count = table.Get<PxU32>();
+		for (PxU32 i = 0; (i < actor_count) && table.ok; i++)
+		{
+			CheckpointActor entry;
+			PxBase* object = collection->find(table.Get<PxSerialObjectId>());
+			entry.actor = object ? object->is<PxActor>() : 0;
+			entry.wrapper = 0;
+
+			PxU32 length = table.Get<PxU32>();
+			const char* name = table.Array<char>(length);
+			if (name)
+				entry.name.assign(name, length);
+
+			PxU32 count = table.Get<PxU32>();
+			const PxVec3* colors = table.Array<PxVec3>(count);
+			if (colors)
+				entry.colors.assign(colors, colors + count);
+
+			count = table.Get<PxU32>();
+			const PxU32* quads = table.Array<PxU32>(count);
+			if (quads)
+				entry.quads.assign(quads, quads + count);
+
+			if (!entry.actor)
+				table.ok = false;
+			actors.push_back(entry);
+		}
+
+		PxU32 joint_count = table.Get<PxU32>();
+		for (PxU32 i = 0; (i < joint_count) && table.ok; i++)
+		{
+			CheckpointJoint entry;
+			PxBase* object = collection->find(table.Get<PxSerialObjectId>());
+			entry.joint = object ? object->is<PxJoint>() : 0;
+			entry.wrapper = 0;
+			if (!entry.joint)
+				table.ok = false;
+			joints.push_back(entry);
+		}
+
+		PxU32 custom_size = table.Get<PxU32>();
+		const PxU8* custom_data = table.Array<PxU8>(custom_size);
+		if (custom_data)
+		{
+			custom = custom_data - data;
+			custom_end = custom + custom_size;
+		}
+
+		//the gameplay state is read after the current scene is gone, so it is checked now:
+		//every entry inside the block and every id of an actor or joint of this file, adopted at most once
+		vector<bool> claimed(actors.size() + joints.size() + 1, false);
+		TableReader entries(data + custom, data + custom_end);
+		while (table.ok && (entries.p < entries.end))
+		{
+			PxU8 kind = entries.Get<PxU8>();
+			PxU32 bytes = entries.Get<PxU32>();
+			const PxU8* value = entries.Array<PxU8>(bytes);
+			if (!entries.ok || (kind > CHECKPOINT_ID))
+				table.ok = false;
+			else if (kind == CHECKPOINT_ID)
+			{
+				PxSerialObjectId id = 0;
+				if (bytes == sizeof(id))
+					memcpy(&id, value, sizeof(id));
+				if ((bytes != sizeof(id)) || (id >= claimed.size()) || (id && claimed[(size_t)id]))
+					table.ok = false;
+				else
+					claimed[(size_t)id] = true;
+			}
+		}
+
+		if (!table.ok)
+		{
+			cerr << "CheckpointReader: the side table is damaged" << endl;
+			//the objects go with the mapping
+			Close();
+		}
+		return table.ok;
+	}
+
+	CheckpointMemory* CheckpointReader::Keep()
+	{
+		if (!created)
+			return 0;
+
+		//the wrappers release their actors with the exclusive shapes and their joints before the scene goes
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			if (!actors[i].wrapper)
+				continue;
+			if (actors[i].actor->isRigidActor())
+			{
+				PxRigidActor* rigid_actor = (PxRigidActor*)actors[i].actor;
+				vector<PxShape*> shapes(rigid_actor->getNbShapes());
+				if (shapes.size())
+					rigid_actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					if (shapes[j]->isExclusive() && collection->contains(*shapes[j]))
+						collection->remove(*shapes[j]);
+				}
+			}
+			collection->remove(*actors[i].actor);
+		}
+		for (PxU32 i = 0; i < joints.size(); i++)
+		{
+			if (joints[i].wrapper)
+				collection->remove(*joints[i].joint);
+		}
+
+		CheckpointMemory* memory = new CheckpointMemory();
+		memory->data = data;
+		memory->size = size;
+#ifdef _WIN32
+		memory->file_handle = file_handle;
+		memory->mapping = mapping;
+		file_handle = INVALID_HANDLE_VALUE;
+		mapping = 0;
+#endif
+		memory->objects = collection;
+		checkpoint_memory.push_back(memory);
+
+		collection = 0;
+		data = 0;
+		Close();
+		return memory;
+	}
+
+	CheckpointActor* CheckpointReader::Claim(PxSerialObjectId id)
+	{
+		if (!id)
+			return 0;
+
+		//ids are given in the order of adding, actors first
+		if ((id > actors.size()) || actors[(size_t)id - 1].wrapper)
+			throw new Exception("PhysicsEngine::CheckpointReader::Claim, the checkpoint does not match the game.");
+		return &actors[(size_t)id - 1];
+	}
+
+	CheckpointJoint* CheckpointReader::ClaimJoint(PxSerialObjectId id)
+	{
+		if (!id)
+			return 0;
+
+		if ((id <= actors.size()) || (id > actors.size() + joints.size()) || joints[(size_t)id - actors.size() - 1].wrapper)
+			throw new Exception("PhysicsEngine::CheckpointReader::ClaimJoint, the checkpoint does not match the game.");
+		return &joints[(size_t)id - actors.size() - 1];
+	}
+
+	const PxU8* CheckpointReader::Entry(CheckpointEntry kind, PxU32& bytes)
+	{
+		//Deserialize has checked the entries, so this only fails if the game reads them back differently than it wrote them
+		PxU8 entry_kind;
+		PxU32 entry_size;
+		if (custom + sizeof(entry_kind) + sizeof(entry_size) > custom_end)
+			throw new Exception("PhysicsEngine::CheckpointReader::Entry, the checkpoint does not match the game.");
+		memcpy(&entry_kind, data + custom, sizeof(entry_kind));
+		memcpy(&entry_size, data + custom + sizeof(entry_kind), sizeof(entry_size));
+		if ((entry_kind != kind) || ((bytes != (PxU32)-1) && (entry_size != bytes)))
+			throw new Exception("PhysicsEngine::CheckpointReader::Entry, the checkpoint does not match the game.");
+
+		const PxU8* value = data + custom + sizeof(entry_kind) + sizeof(entry_size);
+		custom += sizeof(entry_kind) + sizeof(entry_size) + entry_size;
+		bytes = entry_size;
+		return value;
+	}
+
+	PxSerialObjectId CheckpointReader::GetId()
+	{
+		PxSerialObjectId id;
+		PxU32 bytes = sizeof(id);
+		memcpy(&id, Entry(CHECKPOINT_ID, bytes), sizeof(id));
+		return id;
+	}
+
+	string CheckpointReader::GetString()
+	{
+		PxU32 bytes = (PxU32)-1;
+		const PxU8* value = Entry(CHECKPOINT_STRING, bytes);
+		return string((const char*)value, bytes);
+	}
+
+	void ReleaseCheckpoint(CheckpointMemory* memory)
+	{
+		vector<CheckpointMemory*>::iterator kept = find(checkpoint_memory.begin(), checkpoint_memory.end(), memory);
+		if (kept == checkpoint_memory.end())
+			return;
+		checkpoint_memory.erase(kept);
+
+		//exclusive shapes go with their actors
+		PxCollectionExt::releaseObjects(*memory->objects, false);
+		memory->objects->release();
+		Unmap(*memory);
+		delete memory;
+	}
+
+	void ReleaseCheckpoints()
+	{
+		for (PxU32 i = 0; i < checkpoint_memory.size(); i++)
+		{
+			checkpoint_memory[i]->objects->release();
+			Unmap(*checkpoint_memory[i]);
+			delete checkpoint_memory[i];
+		}
+		checkpoint_memory.clear();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <string.h>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	class Actor;
+	class Joint;
+	struct CheckpointMemory;
+
+	///Kinds of the entries of the gameplay state, so that a checkpoint can be checked before it replaces a scene
+	enum CheckpointEntry
+	{
+		CHECKPOINT_VALUE,
+		CHECKPOINT_STRING,
+		CHECKPOINT_ID
+	};
+
+	///Wrapper state of an actor in a checkpoint, taken over by the adopting constructors of the wrappers
+	struct CheckpointActor
+	{
+		PxActor* actor;
+		std::string name;
+		//one per shape, negative for the default colour
+		std::vector<PxVec3> colors;
+		//quads of a cloth, see Cloth
+		std::vector<PxU32> quads;
+		//set by the adopting constructor
+		Actor* wrapper;
+	};
+
+	struct CheckpointJoint
+	{
+		PxJoint* joint;
+		Joint* wrapper;
+	};
+
+	///Collects a scene for Scene::Save.
+	///The PhysX objects go into a binary collection, the wrappers and the game add their state to a side table.
+	class CheckpointWriter
+	{
+		PxCollection* collection;
+		std::vector<PxActor*> actors;
+		std::vector<PxJoint*> joints;
+		std::vector<PxU8> custom;
+
+		void PutEntry(CheckpointEntry kind, const void* value, size_t bytes);
+
+	public:
+		CheckpointWriter();
+
+		~CheckpointWriter();
+
+		///Add an actor, ids are given in order and restored in the same order
+		void Add(PxActor& actor);
+
+		void Add(PxJoint& joint);
+
+		///Serial id of an added actor or joint, 0 for none
+		PxSerialObjectId Id(const PxBase* object) const;
+
+		///Gameplay state for Scene::CustomLoad, read back in the same order
+		template<class T> void Put(const T& value)
+		{
+			PutEntry(CHECKPOINT_VALUE, &value, sizeof(T));
+		}
+
+		void Put(const std::string& value);
+
+		///Id of the actor or joint of a wrapper (0 for none), for CheckpointReader::Adopt
+		template<class T> void PutId(T* wrapper)
+		{
+			PxSerialObjectId id = Id(wrapper ? wrapper->Get() : 0);
+			PutEntry(CHECKPOINT_ID, &id, sizeof(id));
+		}
+
+		///Serialise everything and write the file
+		bool Write(const std::string& filename);
+	};
+
+	///A checkpoint file mapped into memory.
+	///The PhysX objects are created in place inside the mapping, which goes to the scene with Keep.
+	///Objects that are not kept are released together with the mapping.
+	class CheckpointReader
+	{
+		PxU8* data;
+		size_t size;
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping;
+#endif
+		//the loaded objects by their serial ids
+		PxCollection* collection;
+
+		std::vector<CheckpointActor> actors;
+		std::vector<CheckpointJoint> joints;
+		//gameplay state and read position
+		size_t custom, custom_end;
+		//PhysX objects were created in the mapping
+		bool created;
+
+		void Close();
+
+		///Next entry of the gameplay state, throws if it has another kind or size (bytes = -1 for any size)
+		const PxU8* Entry(CheckpointEntry kind, PxU32& bytes);
+
+		PxSerialObjectId GetId();
+
+	public:
+		CheckpointReader();
+
+		~CheckpointReader();
+
+		///Map a file written by CheckpointWriter and check its header
+		bool Open(const std::string& filename);
+
+		///Create the PhysX objects of the checkpoint, they are not in a scene yet.
+		///Also checks the gameplay state: every entry inside the file and every id of an actor or joint adopted at most once.
+		bool Deserialize();
+
+		///Hand the loaded objects and the mapping over to a scene, to go with ReleaseCheckpoint.
+		///The adopted actors and joints are left out, their wrappers release them with the scene.
+		CheckpointMemory* Keep();
+
+		///Take an actor by its serial id for an adopting constructor, 0 gives 0
+		CheckpointActor* Claim(PxSerialObjectId id);
+
+		CheckpointJoint* ClaimJoint(PxSerialObjectId id);
+
+		///Read an id written by CheckpointWriter::PutId and wrap its actor in a new T, 0 for none
+		template<class T> T* Adopt()
+		{
+			CheckpointActor* state = Claim(GetId());
+			return state ? new T(*state) : 0;
+		}
+
+		template<class T> T* AdoptJoint()
+		{
+			CheckpointJoint* state = ClaimJoint(GetId());
+			return state ? new T(*state) : 0;
+		}
+
+		///All actors in the order they were saved
+		std::vector<CheckpointActor>& Actors() { return actors; }
+
+		std::vector<CheckpointJoint>& Joints() { return joints; }
+
+		///Gameplay state written with CheckpointWriter::Put
+		template<class T> T Get()
+		{
+			T value;
+			PxU32 bytes = sizeof(T);
+			memcpy(&value, Entry(CHECKPOINT_VALUE, bytes), sizeof(T));
+			return value;
+		}
+
+		std::string GetString();
+	};
+
+	///Release the objects kept from a checkpoint and unmap it, after the scene that adopted them
+	void ReleaseCheckpoint(CheckpointMemory* memory);
+
+	///Unmap the checkpoints still kept, once PhysX has released their objects
+	void ReleaseCheckpoints();
+}
@@ -0,0 +1,138 @@
+#include "DeterminismCheck.h"
+#include "ScenarioBenchmark.h"
+#include "MyPhysicsEngine.h"
+#include <iostream>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///State hashes of one run, entry 0 is the state before the first step
+	struct HashTrace
+	{
+		vector<PxU64> steps;
+		vector<vector<PxU64> > actors;
+	};
+
+	void TraceScenario(MyScene& scene, const Scenario& scenario, const DeterminismCheckSettings& settings, PxU32 threads, HashTrace& trace)
+	{
+		const PxReal delta_time = 1.f/60.f;
+
+		scene.Threads(threads);
+		scene.Seed(settings.seed);
+		scene.Reset();
+		scenario.setup(scene);
+
+		trace.steps.resize(settings.steps + 1);
+		trace.actors.resize(settings.steps + 1);
+		trace.steps[0] = scene.Hash(&trace.actors[0]);
+
+		for (PxU32 i = 0; i < settings.steps; i++)
+		{
+			scenario.step(scene, i);
+			scene.Update(delta_time);
+			trace.steps[i+1] = scene.Hash(&trace.actors[i+1]);
+		}
+	}
+
+	const char* ActorTypeName(PxActor* actor)
+	{
+		switch (actor->getType())
+		{
+		case PxActorType::eRIGID_DYNAMIC: return "dynamic";
+		case PxActorType::eRIGID_STATIC: return "static";
+		case PxActorType::eCLOTH: return "cloth";
+		default: return "other";
+		}
+	}
+
+	///Compare two runs, prints the first divergence and returns false if there is one
+	bool CompareTraces(MyScene& scene, const Scenario& scenario, const HashTrace& a, const HashTrace& b)
+	{
+		for (size_t step = 0; step < a.steps.size(); step++)
+		{
+			if (a.steps[step] == b.steps[step])
+				continue;
+
+			cout << scenario.name << ": DIVERGED at step " << step;
+
+			const vector<PxU64>& actors_a = a.actors[step];
+			const vector<PxU64>& actors_b = b.actors[step];
+			if (actors_a.size() != actors_b.size())
+			{
+				cout << ", " << actors_a.size() << " vs " << actors_b.size() << " actors" << endl;
+				return false;
+			}
+
+			for (size_t i = 0; i < actors_a.size(); i++)
+			{
+				if (actors_a[i] == actors_b[i])
+					continue;
+
+				//the scene still holds the second run, the game only adds actors so the index is the same
+				vector<PxActor*> actors = scene.GetAllActors();
+				PxActor* actor = (i < actors.size()) ? actors[i] : 0;
+				cout << ", actor " << i;
+				if (actor)
+					cout << " (" << ActorTypeName(actor) << (actor->getName() ? string(", ") + actor->getName() : string()) << ")";
+				cout << endl;
+				return false;
+			}
+
+			//all actors match, so it is the state added by CustomHash
+			cout << ", gameplay state" << endl;
+			return false;
+		}
+
+		cout << scenario.name << ": identical over " << a.steps.size() - 1 << " steps (" << hex << a.steps.back() << dec << ")" << endl;
+		return true;
+	}
+
+	int DeterminismCheck(const DeterminismCheckSettings& settings)
+	{
+		MyScene* scene;
+
+		try
+		{
+			PxInit(settings.backend);
+			scene = new MyScene();
+			scene->Init();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		cout << "Determinism check, seed " << settings.seed << ", " << settings.steps << " steps, "
+			<< settings.threads_a << " vs " << settings.threads_b << " threads" << endl;
+
+		PxU32 count;
+		const Scenario* scenarios = Scenarios(count);
+		PxU32 checked = 0, diverged = 0;
+		for (PxU32 i = 0; i < count; i++)
+		{
+			if (settings.scenario.size() && (settings.scenario != scenarios[i].name))
+				continue;
+
+			HashTrace a, b;
+			TraceScenario(*scene, scenarios[i], settings, settings.threads_a, a);
+			TraceScenario(*scene, scenarios[i], settings, settings.threads_b, b);
+			checked++;
+			diverged += !CompareTraces(*scene, scenarios[i], a, b);
+		}
+
+		delete scene;
+		PxRelease();
+
+		if (!checked)
+		{
+			cerr << "DeterminismCheck: unknown scenario " << settings.scenario << endl;
+			return 1;
+		}
+
+		return diverged ? 2 : 0;
+	}
+}
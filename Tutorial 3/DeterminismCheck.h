@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+#include "Extras\TrackingAllocator.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Determinism check options
+	struct DeterminismCheckSettings
+	{
+		//check only the scenario with this name (empty = all)
+		std::string scenario;
+		//steps simulated and hashed per run
+		PxU32 steps;
+		//seed of the game's random numbers
+		unsigned int seed;
+		//SDK worker threads of the first and the second run
+		PxU32 threads_a, threads_b;
+		//memory of the SDK and the wrappers
+		MemoryBackend backend;
+
+		DeterminismCheckSettings() : steps(600), seed(1), threads_a(1), threads_b(1), backend(MEMORY_HEAP) {}
+	};
+
+	///Run every scenario twice from the same seed and compare the state hash after each step.
+	///Reports the first step and actor that differ. Returns 2 on a divergence, 1 on errors, 0 otherwise.
+	int DeterminismCheck(const DeterminismCheckSettings& settings);
+}
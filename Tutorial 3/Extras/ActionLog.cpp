@@ -0,0 +1,126 @@
+#include "ActionLog.h"
+#include <iostream>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const PxU32 ACTION_MAGIC = 0x43415850;
+	static const PxU32 ACTION_VERSION = 1;
+
+	bool ActionRecorder::Start(const string& filename, const ActionHeader& header, PxU32 step)
+	{
+		if (file)
+			fclose(file);
+
+		file = fopen(filename.c_str(), "wb");
+		if (!file)
+		{
+			cerr << "ActionRecorder: could not open " << filename << endl;
+			return false;
+		}
+
+		PxU32 id[2] = { ACTION_MAGIC, ACTION_VERSION };
+		fwrite(id, sizeof(id), 1, file);
+		fwrite(&header, sizeof(header), 1, file);
+
+		base_step = last_step = step;
+		count = 0;
+		return true;
+	}
+
+	void ActionRecorder::WriteNumber(PxU32 value)
+	{
+		//7 bits per byte, the high bit marks that more follow
+		while (value >= 0x80)
+		{
+			fputc((int)(value & 0x7f) | 0x80, file);
+			value >>= 7;
+		}
+		fputc((int)value, file);
+	}
+
+	void ActionRecorder::Record(PxU32 step, PxU32 type)
+	{
+		if (!file)
+			return;
+
+		WriteNumber(step - last_step);
+		WriteNumber(type + 1);
+		last_step = step;
+		count++;
+	}
+
+	void ActionRecorder::Stop(PxU32 step, PxU64 hash)
+	{
+		if (!file)
+			return;
+
+		WriteNumber(step - last_step);
+		WriteNumber(0);
+		fwrite(&hash, sizeof(hash), 1, file);
+
+		fclose(file);
+		file = 0;
+	}
+
+	///Read a number written by WriteNumber, false at the end of the file
+	bool ReadNumber(FILE* file, PxU32& value)
+	{
+		value = 0;
+		for (PxU32 shift = 0; shift < 35; shift += 7)
+		{
+			int c = fgetc(file);
+			if (c == EOF)
+				return false;
+			value |= (PxU32)(c & 0x7f) << shift;
+			if (!(c & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	bool ActionFile::Load(const string& filename)
+	{
+		FILE* file = fopen(filename.c_str(), "rb");
+		if (!file)
+		{
+			cerr << "ActionFile: could not open " << filename << endl;
+			return false;
+		}
+
+		PxU32 id[2];
+		if ((fread(id, sizeof(id), 1, file) != 1) || (id[0] != ACTION_MAGIC) || (id[1] != ACTION_VERSION) || (fread(&header, sizeof(header), 1, file) != 1))
+		{
+			cerr << "ActionFile: " << filename << " is not an action recording" << endl;
+			fclose(file);
+			return false;
+		}
+
+		actions.clear();
+		steps = 0;
+		hash = 0;
+		complete = false;
+
+		PxU32 delta, type;
+		while (ReadNumber(file, delta) && ReadNumber(file, type))
+		{
+			steps += delta;
+			if (!type)
+			{
+				complete = (fread(&hash, sizeof(hash), 1, file) == 1);
+				break;
+			}
+
+			Action action = { steps, type - 1 };
+			actions.push_back(action);
+		}
+
+		//without the end the last action still has to run
+		if (!complete && actions.size())
+			steps = actions.back().step + 1;
+
+		fclose(file);
+		return true;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///A gameplay action and the simulation step it was applied before
+	struct Action
+	{
+		PxU32 step;
+		PxU32 type;
+	};
+
+	///Settings a recording was made with, needed to replay it
+	struct ActionHeader
+	{
+		unsigned int seed;
+		PxReal delta_time;
+		PxU32 backend;
+	};
+
+	///Writes the actions of a session into a compact file:
+	///"PXAC", version, ActionHeader, then (step delta, type + 1) pairs as variable length integers.
+	///Type 0 ends the file and is followed by the state hash after the last step.
+	///Steps are stored relative to the step the recording started at.
+	class ActionRecorder
+	{
+		FILE* file;
+		PxU32 base_step, last_step, count;
+
+		void WriteNumber(PxU32 value);
+
+	public:
+		ActionRecorder() : file(0), base_step(0), last_step(0), count(0) {}
+
+		//a recording that is not stopped has no end and replays without the final check
+		~ActionRecorder() { if (file) fclose(file); }
+
+		///Start a new file, step is the current step of the scene
+		bool Start(const std::string& filename, const ActionHeader& header, PxU32 step);
+
+		///Close the file, step and hash describe the state the recording ends in
+		void Stop(PxU32 step, PxU64 hash);
+
+		bool Active() const { return file != 0; }
+
+		void Record(PxU32 step, PxU32 type);
+
+		PxU32 Count() const { return count; }
+	};
+
+	///Actions of a recording, steps start at 0
+	struct ActionFile
+	{
+		ActionHeader header;
+		std::vector<Action> actions;
+		//steps recorded, state hash after them, complete is false if the end is missing (e.g. after a crash)
+		PxU32 steps;
+		PxU64 hash;
+		bool complete;
+
+		///Read a file written by ActionRecorder
+		bool Load(const std::string& filename);
+	};
+}
@@ -0,0 +1,287 @@
+#include "FrameCapture.h"
+#include "GLExtensions.h"
+#include "Profiler.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string.h>
+
+namespace VisualDebugger
+{
+	using namespace std;
+
+	FrameCapture::FrameCapture(unsigned int ring_size, size_t _max_queued)
+		: slots(ring_size < 1 ? 1 : ring_size), next_slot(0), width(0), height(0), max_queued(_max_queued), stop(false),
+		format(IMAGE_SEQUENCE), stream(0), active(false), frames_captured(0), frames_written(0), frames_dropped(0), latency(0.f)
+	{
+		for (unsigned int i = 0; i < slots.size(); i++)
+		{
+			slots[i].buffer = 0;
+			slots[i].pending = false;
+		}
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		//the GL context may already be gone, so frames still in flight are lost
+		StopWriter();
+		for (unsigned int i = 0; i < free_frames.size(); i++)
+			delete free_frames[i];
+	}
+
+	bool FrameCapture::Start(const string& _prefix, Format _format)
+	{
+		if (active)
+			return true;
+
+		prefix = _prefix;
+		format = _format;
+
+		if (format == RAW_STREAM)
+		{
+			stream = fopen((prefix + ".raw").c_str(), "wb");
+			if (!stream)
+			{
+				cerr << "FrameCapture: could not open " << prefix << ".raw" << endl;
+				return false;
+			}
+		}
+
+		width = height = 0;
+		frames_captured = 0;
+		frames_written = 0;
+		frames_dropped = 0;
+		latency = 0.f;
+		stop = false;
+		active = true;
+		writer = thread(&FrameCapture::WriterLoop, this);
+		return true;
+	}
+
+	void FrameCapture::Stop()
+	{
+		if (!active)
+			return;
+
+		//collect readbacks still in flight, oldest first
+		for (unsigned int i = 0; i < slots.size(); i++)
+			Collect(slots[(next_slot + i) % slots.size()]);
+		ReleaseSlots();
+
+		StopWriter();
+	}
+
+	void FrameCapture::StopWriter()
+	{
+		if (!active)
+			return;
+
+		{
+			lock_guard<mutex> lock(queue_mutex);
+			stop = true;
+		}
+		wake.notify_one();
+		writer.join();
+
+		if (stream)
+		{
+			fclose(stream);
+			stream = 0;
+			cout << "FrameCapture: " << prefix << ".raw holds " << frames_written << " frames, bgra " << width << "x" << height << ", bottom-up" << endl;
+		}
+
+		active = false;
+	}
+
+	void FrameCapture::ReleaseSlots()
+	{
+		for (unsigned int i = 0; i < slots.size(); i++)
+		{
+			if (slots[i].buffer)
+				GLExtensions::DeleteBuffers(1, &slots[i].buffer);
+			slots[i].buffer = 0;
+			slots[i].pending = false;
+		}
+	}
+
+	FrameCapture::Frame* FrameCapture::AcquireFrame(int frame_width, int frame_height)
+	{
+		lock_guard<mutex> lock(queue_mutex);
+
+		//the disk cannot keep up, skip this frame
+		if (queue.size() >= max_queued)
+		{
+			frames_dropped++;
+			return 0;
+		}
+
+		Frame* frame;
+		if (free_frames.size())
+		{
+			frame = free_frames.back();
+			free_frames.pop_back();
+		}
+		else
+			frame = new Frame();
+
+		frame->width = frame_width;
+		frame->height = frame_height;
+		frame->pixels.resize(frame_width*frame_height*4);
+		return frame;
+	}
+
+	void FrameCapture::Queue(Frame* frame)
+	{
+		{
+			lock_guard<mutex> lock(queue_mutex);
+			queue.push_back(frame);
+		}
+		wake.notify_one();
+	}
+
+	void FrameCapture::Collect(Slot& slot)
+	{
+		if (!slot.pending)
+			return;
+
+		slot.pending = false;
+
+		GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		const GLubyte* data = (const GLubyte*)GLExtensions::MapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (data)
+		{
+			Frame* frame = AcquireFrame(width, height);
+			if (frame)
+			{
+				memcpy(&frame->pixels.front(), data, frame->pixels.size());
+				frame->index = slot.index;
+				frame->issued = slot.issued;
+				Queue(frame);
+			}
+			GLExtensions::UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void FrameCapture::CaptureFrame(int frame_width, int frame_height)
+	{
+		if (!active)
+			return;
+
+		//a raw stream has a single frame size, so it ends with the window size it started with
+		if ((format == RAW_STREAM) && width && ((frame_width != width) || (frame_height != height)))
+		{
+			cerr << "FrameCapture: the window size changed, stopped writing " << prefix << ".raw" << endl;
+			Stop();
+			return;
+		}
+
+		PROFILE_ZONE("FrameCapture::CaptureFrame");
+		unsigned int index = frames_captured++;
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+		//synchronous fallback without pixel buffer objects
+		if (!GLExtensions::HasPixelBuffers())
+		{
+			width = frame_width;
+			height = frame_height;
+			Frame* frame = AcquireFrame(width, height);
+			if (frame)
+			{
+				frame->index = index;
+				frame->issued = Clock::now();
+				glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, &frame->pixels.front());
+				Queue(frame);
+			}
+			return;
+		}
+
+		//window resized: whatever is in flight has the old size
+		if ((frame_width != width) || (frame_height != height))
+		{
+			for (unsigned int i = 0; i < slots.size(); i++)
+				Collect(slots[(next_slot + i) % slots.size()]);
+			ReleaseSlots();
+			next_slot = 0;
+
+			width = frame_width;
+			height = frame_height;
+			for (unsigned int i = 0; i < slots.size(); i++)
+			{
+				GLExtensions::GenBuffers(1, &slots[i].buffer);
+				GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+				GLExtensions::BufferData(GL_PIXEL_PACK_BUFFER, width*height*4, 0, GL_STREAM_READ);
+			}
+			GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
+		//the oldest slot was issued ring_size frames ago, so its transfer is normally finished by now
+		Slot& slot = slots[next_slot];
+		Collect(slot);
+
+		GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+		GLExtensions::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot.pending = true;
+		slot.index = index;
+		slot.issued = Clock::now();
+		next_slot = (next_slot + 1) % slots.size();
+	}
+
+	void FrameCapture::WriterLoop()
+	{
+		Profiler::ThreadName("FrameCapture writer");
+		unique_lock<mutex> lock(queue_mutex);
+		while (true)
+		{
+			wake.wait(lock, [this] { return stop || queue.size(); });
+			if (queue.empty())
+				break;
+
+			Frame* frame = queue.front();
+			queue.pop_front();
+
+			lock.unlock();
+			{
+				PROFILE_ZONE("FrameCapture::Write");
+				Write(*frame);
+			}
+			float time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frame->issued).count()/1000.f;
+			latency = time;
+			frames_written++;
+			lock.lock();
+
+			free_frames.push_back(frame);
+		}
+	}
+
+	void FrameCapture::Write(const Frame& frame)
+	{
+		if (format == RAW_STREAM)
+		{
+			fwrite(&frame.pixels.front(), frame.pixels.size(), 1, stream);
+			return;
+		}
+
+		stringstream filename;
+		filename << prefix << setfill('0') << setw(5) << frame.index << ".tga";
+		FILE* file = fopen(filename.str().c_str(), "wb");
+		if (!file)
+			return;
+
+		//uncompressed true colour TGA with alpha, bottom-up like the framebuffer
+		GLubyte header[18] = { 0 };
+		header[2] = 2;
+		header[12] = frame.width & 0xff;
+		header[13] = (frame.width >> 8) & 0xff;
+		header[14] = frame.height & 0xff;
+		header[15] = (frame.height >> 8) & 0xff;
+		header[16] = 32;
+		header[17] = 8;
+
+		fwrite(header, sizeof(header), 1, file);
+		fwrite(&frame.pixels.front(), frame.pixels.size(), 1, file);
+		fclose(file);
+	}
+}
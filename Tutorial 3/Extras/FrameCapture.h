@@ -0,0 +1,106 @@
+#pragma once
+
+#include <GL/glut.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+
+namespace VisualDebugger
+{
+	///Captures rendered frames without stalling the renderer.
+	///Frames are read back through a ring of pixel buffer objects and written to disk by a background thread.
+	class FrameCapture
+	{
+	public:
+		enum Format
+		{
+			IMAGE_SEQUENCE,	//one TGA file per frame
+			RAW_STREAM		//all frames in a single file, BGRA bottom-up
+		};
+
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		///A frame waiting to be written
+		struct Frame
+		{
+			std::vector<GLubyte> pixels;
+			int width, height;
+			unsigned int index;
+			Clock::time_point issued;
+		};
+
+		///A readback in flight
+		struct Slot
+		{
+			GLuint buffer;
+			bool pending;
+			unsigned int index;
+			Clock::time_point issued;
+		};
+
+		std::vector<Slot> slots;
+		unsigned int next_slot;
+		int width, height;
+
+		//frames handed over to the writer thread, and recycled frames
+		std::deque<Frame*> queue;
+		std::vector<Frame*> free_frames;
+		size_t max_queued;
+		std::mutex queue_mutex;
+		std::condition_variable wake;
+		std::thread writer;
+		bool stop;
+
+		std::string prefix;
+		Format format;
+		FILE* stream;
+		bool active;
+
+		unsigned int frames_captured;
+		std::atomic<unsigned int> frames_written;
+		std::atomic<unsigned int> frames_dropped;
+		//time from the readback request to the frame being on disk [ms]
+		std::atomic<float> latency;
+
+		void StopWriter();
+		void ReleaseSlots();
+		void Collect(Slot& slot);
+		Frame* AcquireFrame(int frame_width, int frame_height);
+		void Queue(Frame* frame);
+		void WriterLoop();
+		void Write(const Frame& frame);
+
+	public:
+		///ring_size - readbacks in flight, max_queued - frames waiting for the disk before new ones are dropped
+		FrameCapture(unsigned int ring_size=3, size_t max_queued=16);
+
+		~FrameCapture();
+
+		///Start capturing, files are named <prefix>NNNNN.tga or <prefix>.raw
+		bool Start(const std::string& prefix, Format format=IMAGE_SEQUENCE);
+
+		///Stop capturing and wait for all frames to be written
+		void Stop();
+
+		bool Active() const { return active; }
+
+		///Request readback of the current frame (call before swapping buffers).
+		///A raw stream is stopped when the frame size changes.
+		void CaptureFrame(int frame_width, int frame_height);
+
+		unsigned int FramesCaptured() const { return frames_captured; }
+
+		unsigned int FramesWritten() const { return frames_written; }
+
+		unsigned int FramesDropped() const { return frames_dropped; }
+
+		float Latency() const { return latency; }
+	};
+}
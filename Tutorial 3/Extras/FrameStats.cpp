@@ -0,0 +1,122 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace VisualDebugger
+{
+	using namespace std;
+
+	//time of a phase that was not recorded in a frame
+	static const float NOT_MEASURED = -1.f;
+
+	FrameStats::FrameStats(unsigned int _capacity)
+		: capacity(_capacity < 1 ? 1 : _capacity), head(0), count(0), dirty(true)
+	{
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			history[i].resize(capacity, NOT_MEASURED);
+			current[i] = NOT_MEASURED;
+		}
+		scratch.reserve(capacity);
+	}
+
+	void FrameStats::EndFrame()
+	{
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			history[i][head] = current[i];
+			current[i] = NOT_MEASURED;
+		}
+
+		head = (head + 1) % capacity;
+		if (count < capacity)
+			count++;
+		dirty = true;
+	}
+
+	float FrameStats::Frame(Phase phase, unsigned int frame) const
+	{
+		return history[phase][(head + capacity - count + frame) % capacity];
+	}
+
+	void FrameStats::UpdatePercentiles() const
+	{
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			Percentiles& p = percentiles[i];
+
+			//the ring is not in time order, but percentiles do not care
+			scratch.clear();
+			for (unsigned int f = 0; f < count; f++)
+			{
+				if (history[i][f] >= 0.f)
+					scratch.push_back(history[i][f]);
+			}
+
+			if (scratch.empty())
+			{
+				p.p50 = p.p95 = p.p99 = p.max = 0.f;
+				continue;
+			}
+
+			//each selection only needs the part above the previous one
+			size_t measured = scratch.size();
+			vector<float>::iterator it50 = scratch.begin() + (measured - 1)*50/100;
+			vector<float>::iterator it95 = scratch.begin() + (measured - 1)*95/100;
+			vector<float>::iterator it99 = scratch.begin() + (measured - 1)*99/100;
+			nth_element(scratch.begin(), it50, scratch.end());
+			nth_element(it50, it95, scratch.end());
+			nth_element(it95, it99, scratch.end());
+
+			p.p50 = *it50;
+			p.p95 = *it95;
+			p.p99 = *it99;
+			p.max = *max_element(it99, scratch.end());
+		}
+
+		dirty = false;
+	}
+
+	const FrameStats::Percentiles& FrameStats::Get(Phase phase) const
+	{
+		if (dirty)
+			UpdatePercentiles();
+		return percentiles[phase];
+	}
+
+	bool FrameStats::Dump(const string& filename) const
+	{
+		FILE* file = fopen(filename.c_str(), "w");
+		if (!file)
+			return false;
+
+		fprintf(file, "frame");
+		for (int i = 0; i < PHASE_COUNT; i++)
+			fprintf(file, ",%s_ms", Name((Phase)i));
+		fprintf(file, "\n");
+
+		for (unsigned int f = 0; f < count; f++)
+		{
+			fprintf(file, "%u", f);
+			for (int i = 0; i < PHASE_COUNT; i++)
+			{
+				//empty if not measured
+				float time = Frame((Phase)i, f);
+				if (time >= 0.f)
+					fprintf(file, ",%.4f", time);
+				else
+					fprintf(file, ",");
+			}
+			fprintf(file, "\n");
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	const char* FrameStats::Name(Phase phase)
+	{
+		static const char* names[PHASE_COUNT] = { "input", "gameplay", "simulate", "fetch", "render", "frame" };
+		return names[phase];
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+namespace VisualDebugger
+{
+	///History of per-frame timings with rolling percentiles.
+	///Times are in milliseconds, the oldest frame is overwritten once the history is full.
+	///A phase not recorded in a frame (e.g. no simulation step while paused) is left out of its percentiles.
+	class FrameStats
+	{
+	public:
+		enum Phase
+		{
+			INPUT,		//key handling
+			GAMEPLAY,	//CustomUpdate
+			SIMULATE,	//simulate call
+			FETCH,		//fetchResults, waits for the simulation to finish
+			RENDER,		//scene and HUD
+			FRAME,		//start to start of consecutive frames
+			PHASE_COUNT
+		};
+
+		struct Percentiles
+		{
+			float p50, p95, p99, max;
+		};
+
+	private:
+		std::vector<float> history[PHASE_COUNT];
+		unsigned int capacity;
+		//next frame to write and number of valid frames
+		unsigned int head, count;
+		float current[PHASE_COUNT];
+
+		mutable Percentiles percentiles[PHASE_COUNT];
+		mutable bool dirty;
+		mutable std::vector<float> scratch;
+
+		void UpdatePercentiles() const;
+
+	public:
+		FrameStats(unsigned int capacity=600);
+
+		///Set the time of a phase for the frame being measured, phases without a time are not measured
+		void Record(Phase phase, float time) { current[phase] = time; }
+
+		///Store the frame being measured in the history
+		void EndFrame();
+
+		///Percentiles over the whole history
+		const Percentiles& Get(Phase phase) const;
+
+		///Number of frames in the history
+		unsigned int Count() const { return count; }
+
+		///Time of a phase, frame 0 is the oldest one, negative if the phase was not measured in that frame
+		float Frame(Phase phase, unsigned int frame) const;
+
+		///Write the history as CSV, oldest frame first
+		bool Dump(const std::string& filename) const;
+
+		static const char* Name(Phase phase);
+	};
+}
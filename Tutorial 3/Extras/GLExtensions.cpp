@@ -0,0 +1,139 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "GLExtensions.h"
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+namespace VisualDebugger
+{
+	namespace GLExtensions
+	{
+		using namespace std;
+
+		ActiveTextureProc ActiveTexture = 0;
+
+		GenBuffersProc GenBuffers = 0;
+		DeleteBuffersProc DeleteBuffers = 0;
+		BindBufferProc BindBuffer = 0;
+		BufferDataProc BufferData = 0;
+		BufferSubDataProc BufferSubData = 0;
+		MapBufferProc MapBuffer = 0;
+		UnmapBufferProc UnmapBuffer = 0;
+
+		GenFramebuffersProc GenFramebuffers = 0;
+		DeleteFramebuffersProc DeleteFramebuffers = 0;
+		BindFramebufferProc BindFramebuffer = 0;
+		FramebufferTexture2DProc FramebufferTexture2D = 0;
+		CheckFramebufferStatusProc CheckFramebufferStatus = 0;
+
+		int gl_major = 1;
+		int gl_minor = 1;
+
+		void* GetProcAddress(const char* name)
+		{
+#ifdef _WIN32
+			return (void*)wglGetProcAddress(name);
+#else
+			return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+		}
+
+		bool Version(int major, int minor)
+		{
+			return (gl_major > major) || ((gl_major == major) && (gl_minor >= minor));
+		}
+
+		void Init()
+		{
+			const char* version = (const char*)glGetString(GL_VERSION);
+			if (!version || (sscanf(version, "%d.%d", &gl_major, &gl_minor) != 2))
+			{
+				gl_major = 1;
+				gl_minor = 1;
+			}
+
+			ActiveTexture = (ActiveTextureProc)GetProcAddress("glActiveTexture");
+			if (!ActiveTexture)
+				ActiveTexture = (ActiveTextureProc)GetProcAddress("glActiveTextureARB");
+
+			//core names first, then the ARB suffix
+			const char* suffix = Version(1, 5) ? "" : (Supported("GL_ARB_vertex_buffer_object") ? "ARB" : 0);
+			if (suffix)
+			{
+				GenBuffers = (GenBuffersProc)GetProcAddress((string("glGenBuffers") + suffix).c_str());
+				DeleteBuffers = (DeleteBuffersProc)GetProcAddress((string("glDeleteBuffers") + suffix).c_str());
+				BindBuffer = (BindBufferProc)GetProcAddress((string("glBindBuffer") + suffix).c_str());
+				BufferData = (BufferDataProc)GetProcAddress((string("glBufferData") + suffix).c_str());
+				BufferSubData = (BufferSubDataProc)GetProcAddress((string("glBufferSubData") + suffix).c_str());
+				MapBuffer = (MapBufferProc)GetProcAddress((string("glMapBuffer") + suffix).c_str());
+				UnmapBuffer = (UnmapBufferProc)GetProcAddress((string("glUnmapBuffer") + suffix).c_str());
+			}
+
+			if (Supported("GL_EXT_framebuffer_object"))
+			{
+				GenFramebuffers = (GenFramebuffersProc)GetProcAddress("glGenFramebuffersEXT");
+				DeleteFramebuffers = (DeleteFramebuffersProc)GetProcAddress("glDeleteFramebuffersEXT");
+				BindFramebuffer = (BindFramebufferProc)GetProcAddress("glBindFramebufferEXT");
+				FramebufferTexture2D = (FramebufferTexture2DProc)GetProcAddress("glFramebufferTexture2DEXT");
+				CheckFramebufferStatus = (CheckFramebufferStatusProc)GetProcAddress("glCheckFramebufferStatusEXT");
+			}
+		}
+
+		bool Supported(const char* extension)
+		{
+			const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+			if (!extensions)
+				return false;
+
+			//match whole names only, e.g. GL_ARB_shadow must not match GL_ARB_shadow_ambient
+			size_t length = strlen(extension);
+			for (const char* s = strstr(extensions, extension); s; s = strstr(s + length, extension))
+			{
+				if (((s == extensions) || (s[-1] == ' ')) && ((s[length] == ' ') || (s[length] == '\0')))
+					return true;
+			}
+			return false;
+		}
+
+		bool HasTextureCombine()
+		{
+			return ActiveTexture && (Version(1, 3) || (Supported("GL_ARB_multitexture") && Supported("GL_ARB_texture_env_combine")));
+		}
+
+		bool HasShadowMaps()
+		{
+			return HasTextureCombine() && (Version(1, 4) || (Supported("GL_ARB_depth_texture") && Supported("GL_ARB_shadow")));
+		}
+
+		bool HasBuffers()
+		{
+			return GenBuffers && DeleteBuffers && BindBuffer && BufferData && BufferSubData;
+		}
+
+		bool HasVertexArrayBGRA()
+		{
+			static int bgra = -1;
+			if (bgra < 0)
+				bgra = Version(3, 2) || Supported("GL_ARB_vertex_array_bgra") || Supported("GL_EXT_vertex_array_bgra");
+			return bgra != 0;
+		}
+
+		bool HasPixelBuffers()
+		{
+			return HasBuffers() && MapBuffer && UnmapBuffer &&
+				(Version(2, 1) || Supported("GL_ARB_pixel_buffer_object") || Supported("GL_EXT_pixel_buffer_object"));
+		}
+
+		bool HasFramebufferObjects()
+		{
+			return GenFramebuffers && DeleteFramebuffers && BindFramebuffer && FramebufferTexture2D && CheckFramebufferStatus;
+		}
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <GL/glut.h>
+#include <stddef.h>
+
+///OpenGL entry points and enums beyond the 1.1 headers shipped with GLUT.
+///Entry points are loaded at runtime by GLExtensions::Init, which needs a current context.
+
+#ifdef _WIN32
+#define GLEXT_APIENTRY __stdcall
+#else
+#define GLEXT_APIENTRY
+#endif
+
+#ifndef GL_VERSION_1_2
+#define GL_BGR							0x80E0
+#define GL_BGRA							0x80E1
+#endif
+
+#ifndef GL_VERSION_1_3
+#define GL_TEXTURE0						0x84C0
+#define GL_TEXTURE1						0x84C1
+#define GL_CLAMP_TO_BORDER				0x812D
+#define GL_COMBINE						0x8570
+#define GL_COMBINE_RGB					0x8571
+#define GL_COMBINE_ALPHA				0x8572
+#define GL_CONSTANT						0x8576
+#define GL_PRIMARY_COLOR				0x8577
+#define GL_PREVIOUS						0x8578
+#define GL_SOURCE0_RGB					0x8580
+#define GL_SOURCE1_RGB					0x8581
+#define GL_SOURCE0_ALPHA				0x8588
+#define GL_OPERAND0_RGB					0x8590
+#define GL_OPERAND1_RGB					0x8591
+#define GL_OPERAND0_ALPHA				0x8598
+#endif
+
+#ifndef GL_VERSION_1_4
+#define GL_DEPTH_COMPONENT24			0x81A6
+#define GL_DEPTH_TEXTURE_MODE			0x884B
+#define GL_TEXTURE_COMPARE_MODE			0x884C
+#define GL_TEXTURE_COMPARE_FUNC			0x884D
+#define GL_COMPARE_R_TO_TEXTURE			0x884E
+#endif
+
+#ifndef GL_VERSION_1_5
+typedef ptrdiff_t GLintptr;
+typedef ptrdiff_t GLsizeiptr;
+#define GL_ARRAY_BUFFER					0x8892
+#define GL_ELEMENT_ARRAY_BUFFER			0x8893
+#define GL_STREAM_DRAW					0x88E0
+#define GL_STATIC_DRAW					0x88E4
+#define GL_DYNAMIC_DRAW					0x88E8
+#define GL_STREAM_READ					0x88E1
+#define GL_READ_ONLY					0x88B8
+#endif
+
+#ifndef GL_VERSION_2_1
+#define GL_PIXEL_PACK_BUFFER			0x88EB
+#endif
+
+#ifndef GL_EXT_framebuffer_object
+#define GL_FRAMEBUFFER_EXT				0x8D40
+#define GL_FRAMEBUFFER_COMPLETE_EXT		0x8CD5
+#define GL_DEPTH_ATTACHMENT_EXT			0x8D00
+#endif
+
+namespace VisualDebugger
+{
+	namespace GLExtensions
+	{
+		typedef void (GLEXT_APIENTRY *ActiveTextureProc)(GLenum texture);
+		typedef void (GLEXT_APIENTRY *GenFramebuffersProc)(GLsizei n, GLuint* framebuffers);
+		typedef void (GLEXT_APIENTRY *DeleteFramebuffersProc)(GLsizei n, const GLuint* framebuffers);
+		typedef void (GLEXT_APIENTRY *BindFramebufferProc)(GLenum target, GLuint framebuffer);
+		typedef void (GLEXT_APIENTRY *FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+		typedef GLenum (GLEXT_APIENTRY *CheckFramebufferStatusProc)(GLenum target);
+		typedef void (GLEXT_APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+		typedef void (GLEXT_APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+		typedef void (GLEXT_APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+		typedef void (GLEXT_APIENTRY *BufferDataProc)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+		typedef void (GLEXT_APIENTRY *BufferSubDataProc)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+		typedef void* (GLEXT_APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+		typedef GLboolean (GLEXT_APIENTRY *UnmapBufferProc)(GLenum target);
+
+		//OpenGL 1.3
+		extern ActiveTextureProc ActiveTexture;
+
+		//OpenGL 1.5 (ARB_vertex_buffer_object)
+		extern GenBuffersProc GenBuffers;
+		extern DeleteBuffersProc DeleteBuffers;
+		extern BindBufferProc BindBuffer;
+		extern BufferDataProc BufferData;
+		extern BufferSubDataProc BufferSubData;
+		extern MapBufferProc MapBuffer;
+		extern UnmapBufferProc UnmapBuffer;
+
+		//EXT_framebuffer_object
+		extern GenFramebuffersProc GenFramebuffers;
+		extern DeleteFramebuffersProc DeleteFramebuffers;
+		extern BindFramebufferProc BindFramebuffer;
+		extern FramebufferTexture2DProc FramebufferTexture2D;
+		extern CheckFramebufferStatusProc CheckFramebufferStatus;
+
+		///Load the entry points (requires a current GL context)
+		void Init();
+
+		///Check if the driver advertises a specific extension
+		bool Supported(const char* extension);
+
+		///Multitexturing with texture combiners (GL 1.3)
+		bool HasTextureCombine();
+
+		///Depth textures with depth comparison (GL 1.4 or ARB_depth_texture + ARB_shadow)
+		bool HasShadowMaps();
+
+		///Vertex and index buffer objects (GL 1.5 or ARB_vertex_buffer_object)
+		bool HasBuffers();
+
+		///Packed BGRA colour arrays (GL 3.2 or ARB/EXT_vertex_array_bgra)
+		bool HasVertexArrayBGRA();
+
+		///Asynchronous pixel readback into buffer objects (GL 2.1 or ARB_pixel_buffer_object)
+		bool HasPixelBuffers();
+
+		///Render to texture (EXT_framebuffer_object)
+		bool HasFramebufferObjects();
+	}
+}
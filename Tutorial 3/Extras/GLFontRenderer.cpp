@@ -11,6 +11,10 @@ unsigned int GLFontRenderer::m_textureObject=0;
 int GLFontRenderer::m_screenWidth=640;
 int GLFontRenderer::m_screenHeight=480;
 float GLFontRenderer::m_color[4]={1.0f, 1.0f, 1.0f, 1.0f};
+std::vector<float> GLFontRenderer::m_batchVerts;
+std::vector<float> GLFontRenderer::m_batchUVs;
+std::vector<unsigned char> GLFontRenderer::m_batchColors;
+unsigned int GLFontRenderer::m_batchGlyphs=0;
 
 bool GLFontRenderer::init()
 {
@@ -21,34 +25,84 @@ bool GLFontRenderer::init()
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
-	// expand to rgba
-	unsigned char* pNewSource = new unsigned char[OGL_FONT_TEXTURE_WIDTH*OGL_FONT_TEXTURE_HEIGHT*4];
-	for(int i=0;i<OGL_FONT_TEXTURE_WIDTH*OGL_FONT_TEXTURE_HEIGHT;i++)
-	{
-		pNewSource[i*4+0]=255;
-		pNewSource[i*4+1]=255;
-		pNewSource[i*4+2]=255;
-		pNewSource[i*4+3]=OGLFontData[i];
-	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, OGL_FONT_TEXTURE_WIDTH, OGL_FONT_TEXTURE_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, pNewSource);
-	delete[] pNewSource;
+	// single channel atlas, the colour comes from the vertices
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, OGL_FONT_TEXTURE_WIDTH, OGL_FONT_TEXTURE_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, OGLFontData);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
 	return true;
 }
 
-void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+unsigned int GLFontRenderer::buildGeometry(float x, float y, float fontSize, const char* pString, std::vector<float>& verts, std::vector<float>& uvs, bool forceMonoSpace, int monoSpaceWidth)
+{
+	verts.clear();
+	uvs.clear();
+	return appendGeometry(x, y, fontSize, pString, verts, uvs, forceMonoSpace, monoSpaceWidth);
+}
+
+unsigned int GLFontRenderer::appendGeometry(float x, float y, float fontSize, const char* pString, std::vector<float>& verts, std::vector<float>& uvs, bool forceMonoSpace, int monoSpaceWidth)
 {
 	x = x*m_screenWidth;
 	y = y*m_screenHeight;
 	fontSize = fontSize*m_screenHeight;
 
+	const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
+	const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
+
+	float translate = 0.0f;
+	float translateDown = 0.0f;
+	unsigned int count = 0;
+
+	for(unsigned int i=0;pString[i];i++)
+	{
+		if (pString[i] == '\n') {
+			translateDown-=0.005f*m_screenHeight+fontSize;
+			translate = 0.0f;
+			continue;
+		}
+
+		int c = pString[i]-OGL_FONT_CHAR_BASE;
+		if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
+
+			count++;
+
+			float glyphWidth = (float)GLFontGlyphWidth[c];
+			if(forceMonoSpace){
+				glyphWidth = (float)monoSpaceWidth;
+			}
+			
+			glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
+
+			float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
+			float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
+
+			float x0 = x+translate;
+			float y0 = y+translateDown;
+			float x1 = x0+fontSize;
+			float y1 = y0+fontSize;
+
+			//two triangles per glyph
+			const float glyphVerts[] = { x0, y0, x1, y1, x0, y1, x0, y0, x1, y0, x1, y1 };
+			const float glyphUVs[] = { cxUV, cyUV+glyphHeightUV, cxUV+glyphWidthUV, cyUV, cxUV, cyUV,
+				cxUV, cyUV+glyphHeightUV, cxUV+glyphWidthUV, cyUV+glyphHeightUV, cxUV+glyphWidthUV, cyUV };
+			verts.insert(verts.end(), glyphVerts, glyphVerts+12);
+			uvs.insert(uvs.end(), glyphUVs, glyphUVs+12);
+
+			translate+=glyphWidth;
+		}
+	}
+
+	return count;
+}
+
+void GLFontRenderer::draw(const float* pVertList, const float* pTextureCoordList, const unsigned char* pColorList, unsigned int count, bool doOrthoProj)
+{
 	if(!m_isInit)
 	{
 		m_isInit = init();
 	}
 
-	unsigned int num = (unsigned int)strlen(pString);
-	if(m_isInit && num > 0)
+	if(m_isInit && count > 0)
 	{
 		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 		glDisable(GL_DEPTH_TEST);
@@ -71,95 +125,23 @@ void GLFontRenderer::print(float x, float y, float fontSize, const char* pString
 
 		glEnable(GL_BLEND);
 
-		glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
-
-		const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
-
-		float translate = 0.0f;
-
-		float* pVertList = new float[num*3*6];
-    	float* pTextureCoordList = new float[num*2*6];
-		int vertIndex = 0;
-    	int textureCoordIndex = 0;
-
-		float translateDown = 0.0f;
-		unsigned int count = 0;
-
-		for(unsigned int i=0;i<num; i++)
+		if(pColorList)
 		{
-			const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
-
-			if (pString[i] == '\n') {
-				translateDown-=0.005f*m_screenHeight+fontSize;
-				translate = 0.0f;
-				continue;
-			}
-
-			int c = pString[i]-OGL_FONT_CHAR_BASE;
-			if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
-
-				count++;
-
-				float glyphWidth = (float)GLFontGlyphWidth[c];
-				if(forceMonoSpace){
-					glyphWidth = (float)monoSpaceWidth;
-				}
-				
-				glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
-
-				float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
-				float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				translate+=glyphWidth;
-			}
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(4, GL_UNSIGNED_BYTE, 0, pColorList);
 		}
+		else
+			glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
 
 		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(3, GL_FLOAT, 0, pVertList);
+		glVertexPointer(2, GL_FLOAT, 0, pVertList);
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		glTexCoordPointer(2, GL_FLOAT, 0, pTextureCoordList);
 		glDrawArrays(GL_TRIANGLES, 0, count*6);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
-
-		delete[] pVertList;
-		delete[] pTextureCoordList;
+		if(pColorList)
+			glDisableClientState(GL_COLOR_ARRAY);
 
 		if(doOrthoProj)
 		{
@@ -176,6 +158,47 @@ void GLFontRenderer::print(float x, float y, float fontSize, const char* pString
 	}
 }
 
+void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+{
+	batch(x, y, fontSize, pString, forceMonoSpace, monoSpaceWidth);
+	flush(doOrthoProj);
+}
+
+void GLFontRenderer::batchColors(unsigned int count)
+{
+	unsigned char color[4];
+	for(int i=0;i<4;i++)
+		color[i] = (unsigned char)(m_color[i]*255.0f+0.5f);
+
+	for(unsigned int i=0;i<count*6;i++)
+		m_batchColors.insert(m_batchColors.end(), color, color+4);
+	m_batchGlyphs+=count;
+}
+
+void GLFontRenderer::batch(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth)
+{
+	batchColors(appendGeometry(x, y, fontSize, pString, m_batchVerts, m_batchUVs, forceMonoSpace, monoSpaceWidth));
+}
+
+void GLFontRenderer::batch(const float* pVertList, const float* pTextureCoordList, unsigned int count)
+{
+	m_batchVerts.insert(m_batchVerts.end(), pVertList, pVertList+count*12);
+	m_batchUVs.insert(m_batchUVs.end(), pTextureCoordList, pTextureCoordList+count*12);
+	batchColors(count);
+}
+
+void GLFontRenderer::flush(bool doOrthoProj)
+{
+	if(m_batchGlyphs)
+		draw(&m_batchVerts.front(), &m_batchUVs.front(), &m_batchColors.front(), m_batchGlyphs, doOrthoProj);
+
+	// keep the capacity for the next frame
+	m_batchVerts.clear();
+	m_batchUVs.clear();
+	m_batchColors.clear();
+	m_batchGlyphs = 0;
+}
+
 void GLFontRenderer::setScreenResolution(int screenWidth, int screenHeight)
 {
 	m_screenWidth = screenWidth;
@@ -9,6 +9,8 @@
 #ifndef __GL_FONT_RENDERER__
 #define __GL_FONT_RENDERER__
 
+#include <vector>
+
 class GLFontRenderer{
 	
 private:
@@ -18,11 +20,29 @@ private:
 	static int m_screenWidth;
 	static int m_screenHeight;
 	static float m_color[4];
+	// glyphs queued for the next flush
+	static std::vector<float> m_batchVerts;
+	static std::vector<float> m_batchUVs;
+	static std::vector<unsigned char> m_batchColors;
+	static unsigned int m_batchGlyphs;
+
+	static unsigned int appendGeometry(float x, float y, float fontSize, const char* pString, std::vector<float>& verts, std::vector<float>& uvs, bool forceMonoSpace, int monoSpaceWidth);
+	static void batchColors(unsigned int count);
 
 public:
 	
 	static bool init();
 	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11, bool doOrthoProj=true);
+	// glyph quads in screen pixels (2 floats per vertex, 6 vertices per glyph), returns the number of glyphs
+	static unsigned int buildGeometry(float x, float y, float fontSize, const char* pString, std::vector<float>& verts, std::vector<float>& uvs, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// pColorList is rgba per vertex, or 0 to use the current colour
+	static void draw(const float* pVertList, const float* pTextureCoordList, const unsigned char* pColorList, unsigned int count, bool doOrthoProj=true);
+	// queue text (or prebuilt glyphs) in the current colour, everything queued is drawn at once by flush
+	static void batch(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	static void batch(const float* pVertList, const float* pTextureCoordList, unsigned int count);
+	static void flush(bool doOrthoProj=true);
+	static int screenWidth() { return m_screenWidth; }
+	static int screenHeight() { return m_screenHeight; }
 	static void setScreenResolution(int screenWidth, int screenHeight);
 	static void setColor(float r, float g, float b, float a);
 	
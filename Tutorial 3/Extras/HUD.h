@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Renderer.h"
+#include "Profiler.h"
+#include "TrackingAllocator.h"
 #include <string>
 #include <list>
 
@@ -8,10 +10,54 @@ namespace VisualDebugger
 {
 	using namespace std;
 
+	///Combine the values a line shows into a key for HUDScreen::Stale
+	inline PxU64 HUDKey(PxU64 a, PxU64 b=0, PxU64 c=0, PxU64 d=0)
+	{
+		PxU64 values[] = { a, b, c, d };
+		PxU64 key = 14695981039346656037ULL;
+		for (unsigned int i = 0; i < 4; i++)
+			key = (key ^ values[i]) * 1099511628211ULL;
+		return key;
+	}
+
+	///A single HUD line, keeps its glyph geometry until the text or layout changes
+	struct HUDLine
+	{
+		string text;
+		//value the text was built from, see HUDScreen::Stale
+		PxU64 key;
+		bool dirty;
+		vector<float> verts;
+		vector<float> uvs;
+		unsigned int glyphs;
+
+		HUDLine(const string& _text) : text(_text), key(~(PxU64)0), dirty(true), glyphs(0) {}
+	};
+
 	///A single HUD screen
 	class HUDScreen
 	{
-		vector<string> content;
+		vector<HUDLine> content;
+		//layout the cached geometry was built for
+		int layout_width, layout_height;
+		PxReal layout_font_size;
+		//glyph geometry reported to the memory tracker, together with the screen itself
+		size_t geometry_bytes;
+
+		///Report the size of the screen and its cached geometry to the memory tracker
+		void TrackGeometry()
+		{
+			size_t bytes = 0;
+			for (unsigned int i = 0; i < content.size(); i++)
+				bytes += (content[i].verts.capacity() + content[i].uvs.capacity())*sizeof(float);
+
+			if (bytes != geometry_bytes)
+			{
+				PhysicsEngine::GetTrackingAllocator().Untrack(PhysicsEngine::MEMORY_HUD, sizeof(HUDScreen) + geometry_bytes);
+				PhysicsEngine::GetTrackingAllocator().Track(PhysicsEngine::MEMORY_HUD, sizeof(HUDScreen) + bytes);
+				geometry_bytes = bytes;
+			}
+		}
 
 	public:
 		int id;
@@ -19,27 +65,83 @@ namespace VisualDebugger
 		PxVec3 color;
 
 		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f) :
-			id(screen_id), color(_color), font_size(_font_size)
+			id(screen_id), color(_color), font_size(_font_size), layout_width(0), layout_height(0), layout_font_size(0.f), geometry_bytes(0)
+		{
+			PhysicsEngine::GetTrackingAllocator().Track(PhysicsEngine::MEMORY_HUD, sizeof(HUDScreen));
+		}
+
+		~HUDScreen()
+		{
+			PhysicsEngine::GetTrackingAllocator().Untrack(PhysicsEngine::MEMORY_HUD, sizeof(HUDScreen) + geometry_bytes);
+		}
+
+		///Add a single line of text, returns its index
+		unsigned int AddLine(string line)
+		{
+			content.push_back(HUDLine(line));
+			return (unsigned int)content.size()-1;
+		}
+
+		///Replace the text of a line, the geometry is rebuilt only if the text differs
+		void SetLine(unsigned int index, const string& line)
 		{
+			if ((index < content.size()) && (content[index].text != line))
+			{
+				content[index].text = line;
+				content[index].dirty = true;
+			}
 		}
 
-		///Add a single line of text
-		void AddLine(string line)
+		///Check if the value a line shows has changed since the last call, so the text needs rebuilding
+		bool Stale(unsigned int index, PxU64 key)
 		{
-			content.push_back(line);
+			if ((index >= content.size()) || (content[index].key == key))
+				return false;
+			content[index].key = key;
+			return true;
 		}
 
 		///Render the screen
 		void Render()
 		{
+			int width = Renderer::WindowWidth();
+			int height = Renderer::WindowHeight();
+			GLFontRenderer::setScreenResolution(width, height);
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+
+			//the geometry is in pixels, rebuild everything when the layout changes
+			bool layout_changed = (width != layout_width) || (height != layout_height) || (font_size != layout_font_size);
+			layout_width = width;
+			layout_height = height;
+			layout_font_size = font_size;
+
+			bool rebuilt = false;
 			for (unsigned int i = 0; i < content.size(); i++)
-				Renderer::RenderText(content[i], PxVec2(0.0, 1.f-(i+1)*font_size), color, font_size);
+			{
+				HUDLine& line = content[i];
+				if (line.dirty || layout_changed)
+				{
+					line.glyphs = GLFontRenderer::buildGeometry(0.f, 1.f-(i+1)*font_size, font_size, line.text.c_str(), line.verts, line.uvs);
+					line.dirty = false;
+					rebuilt = true;
+				}
+
+				if (line.glyphs)
+					GLFontRenderer::batch(&line.verts.front(), &line.uvs.front(), line.glyphs);
+			}
+
+			//the whole screen in a single draw
+			GLFontRenderer::flush();
+
+			if (rebuilt)
+				TrackGeometry();
 		}
 
 		///Clear content of the screen
 		void Clear()
 		{
 			content.clear();
+			TrackGeometry();
 		}
 	};
 
@@ -56,20 +158,29 @@ namespace VisualDebugger
 				delete screens[i];
 		}
 
-		///Add a single line to a specific screen
-		void AddLine(int screen_id, string line)
+		///Get a specific screen, created if it does not exist yet
+		HUDScreen* Screen(int screen_id)
 		{
 			for (unsigned int i = 0; i < screens.size(); i++)
 			{
 				if (screens[i]->id == screen_id)
-				{
-					screens[i]->AddLine(line);
-					return;
-				}
+					return screens[i];
 			}
 
 			screens.push_back(new HUDScreen(screen_id));
-			screens.back()->AddLine(line);
+			return screens.back();
+		}
+
+		///Add a single line to a specific screen, returns the index of the line
+		unsigned int AddLine(int screen_id, string line)
+		{
+			return Screen(screen_id)->AddLine(line);
+		}
+
+		///Replace the text of a line on a specific screen
+		void SetLine(int screen_id, unsigned int index, const string& line)
+		{
+			Screen(screen_id)->SetLine(index, line);
 		}
 
 		///Set the active screen
@@ -81,7 +192,7 @@ namespace VisualDebugger
 		///Get the active screen
 		int ActiveScreen()
 		{
-			return active_screen;		
+			return active_screen;
 		}
 
 		///Clear a specified screen (or all of them)
@@ -156,6 +267,7 @@ namespace VisualDebugger
 		///Render the active screen
 		void Render()
 		{
+			PROFILE_ZONE("HUD::Render");
 			for (unsigned int i = 0; i < screens.size(); i++)
 			{
 				if (screens[i]->id == active_screen)
@@ -0,0 +1,598 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "MatchRecording.h"
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const PxU32 MATCH_MAGIC = 0x524d5850;
+	static const PxU32 MATCH_VERSION = 1;
+	//header: magic, version, step length
+	static const size_t MATCH_HEADER = 12;
+	//positions are stored in 1/POSITION_SCALE m
+	static const PxReal POSITION_SCALE = 1000.f;
+
+	//frame flags
+	static const PxU8 FRAME_KEYFRAME = 1;
+	static const PxU8 FRAME_CLEAR = 2;
+
+	//actor flags
+	static const PxU8 ACTOR_DYNAMIC = 1;
+	static const PxU8 ACTOR_HIDDEN = 2;
+
+	//the other components of a unit quaternion are at most 1/sqrt(2) if the largest is left out
+	static const PxReal QUAT_RANGE = 0.70710678f;
+	static const PxU32 QUAT_BITS = 10;
+	static const PxU32 QUAT_MAX = (1 << QUAT_BITS) - 1;
+
+	template<class T> void Put(vector<PxU8>& buffer, const T& value)
+	{
+		const PxU8* bytes = (const PxU8*)&value;
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	///7 bits per byte, the high bit marks that more follow
+	void PutNumber(vector<PxU8>& buffer, PxU32 value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((PxU8)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((PxU8)value);
+	}
+
+	///Small negative numbers stay short: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+	void PutSigned(vector<PxU8>& buffer, PxI32 value)
+	{
+		PutNumber(buffer, ((PxU32)value << 1) ^ (PxU32)(value >> 31));
+	}
+
+	PxI32 QuantizePosition(PxReal value)
+	{
+		return (PxI32)floorf(value*POSITION_SCALE + 0.5f);
+	}
+
+	PxVec3 DequantizePosition(const PxI32* position)
+	{
+		return PxVec3((PxReal)position[0], (PxReal)position[1], (PxReal)position[2])/POSITION_SCALE;
+	}
+
+	PxU32 PackRotation(const PxQuat& q)
+	{
+		const PxReal c[4] = { q.x, q.y, q.z, q.w };
+		PxU32 largest = 0;
+		for (PxU32 i = 1; i < 4; i++)
+			if (PxAbs(c[i]) > PxAbs(c[largest]))
+				largest = i;
+
+		//q and -q are the same rotation, so the left out component is made positive
+		PxReal sign = (c[largest] < 0.f) ? -1.f : 1.f;
+		PxU32 bits = largest << 30;
+		PxU32 shift = 20;
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			PxReal value = PxClamp((c[i]*sign/QUAT_RANGE + 1.f)*0.5f, 0.f, 1.f);
+			bits |= (PxU32)(value*QUAT_MAX + 0.5f) << shift;
+			shift -= QUAT_BITS;
+		}
+		return bits;
+	}
+
+	PxQuat UnpackRotation(PxU32 bits)
+	{
+		PxU32 largest = bits >> 30;
+		PxReal c[4];
+		PxReal sum = 0.f;
+		PxU32 shift = 20;
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			if (i == largest)
+				continue;
+			c[i] = (((bits >> shift) & QUAT_MAX)/(PxReal)QUAT_MAX*2.f - 1.f)*QUAT_RANGE;
+			sum += c[i]*c[i];
+			shift -= QUAT_BITS;
+		}
+		c[largest] = PxSqrt(PxMax(1.f - sum, 0.f));
+		return PxQuat(c[0], c[1], c[2], c[3]).getNormalized();
+	}
+
+	///Reads the parts of a frame, stops at the end of the frame instead of reading past it
+	struct FrameReader
+	{
+		const PxU8* p;
+		const PxU8* end;
+		bool ok;
+
+		FrameReader(const PxU8* _p, const PxU8* _end) : p(_p), end(_end), ok(true) {}
+
+		template<class T> T Get()
+		{
+			T value;
+			if (p + sizeof(T) > end)
+			{
+				ok = false;
+				memset(&value, 0, sizeof(T));
+				return value;
+			}
+			memcpy(&value, p, sizeof(T));
+			p += sizeof(T);
+			return value;
+		}
+
+		PxU32 Number()
+		{
+			PxU32 value = 0;
+			for (PxU32 shift = 0; shift < 35; shift += 7)
+			{
+				if (p >= end)
+					break;
+				PxU8 c = *p++;
+				value |= (PxU32)(c & 0x7f) << shift;
+				if (!(c & 0x80))
+					return value;
+			}
+			ok = false;
+			return 0;
+		}
+
+		PxI32 Signed()
+		{
+			PxU32 value = Number();
+			return (PxI32)(value >> 1) ^ -(PxI32)(value & 1);
+		}
+	};
+
+	///MatchRecorder methods
+	MatchRecorder::MatchRecorder(PxU32 _keyframe_interval)
+		: file(0), new_actors(0), next_id(0), written_id(0), keyframe_interval(_keyframe_interval ? _keyframe_interval : 1),
+		frames_since_keyframe(0), cleared(false), frames_written(0), bytes_written(0)
+	{
+	}
+
+	MatchRecorder::~MatchRecorder()
+	{
+		Stop();
+	}
+
+	bool MatchRecorder::Start(const string& filename, PxReal delta_time)
+	{
+		Stop();
+
+		file = fopen(filename.c_str(), "wb");
+		if (!file)
+		{
+			cerr << "MatchRecorder: could not open " << filename << endl;
+			return false;
+		}
+
+		PxU32 header[3] = { MATCH_MAGIC, MATCH_VERSION, 0 };
+		memcpy(&header[2], &delta_time, sizeof(PxReal));
+		fwrite(header, sizeof(header), 1, file);
+
+		tracked.clear();
+		definitions.clear();
+		new_actors = next_id = written_id = 0;
+		frames_since_keyframe = 0;
+		cleared = true;
+		frames_written = 0;
+		bytes_written = sizeof(header);
+		return true;
+	}
+
+	void MatchRecorder::Stop()
+	{
+		if (!file)
+			return;
+
+		fclose(file);
+		file = 0;
+	}
+
+	void MatchRecorder::Add(PxActor* actor)
+	{
+		if (!file || !actor->isRigidActor())
+			return;
+
+		PxRigidActor* rigid_actor = (PxRigidActor*)actor;
+		bool dynamic = actor->isRigidDynamic() != 0;
+
+		std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
+		if (shapes.size())
+			rigid_actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+
+		Put(definitions, (PxU8)((dynamic ? ACTOR_DYNAMIC : 0) | (HiddenActor(actor) ? ACTOR_HIDDEN : 0)));
+		if (!dynamic)
+			Put(definitions, rigid_actor->getGlobalPose());
+
+		//meshes would need their vertices, the game does not use them
+		PxU32 count = 0;
+		for (PxU32 i = 0; i < shapes.size(); i++)
+		{
+			PxGeometryType::Enum type = shapes[i]->getGeometryType();
+			count += (type == PxGeometryType::eSPHERE) || (type == PxGeometryType::ePLANE) || (type == PxGeometryType::eCAPSULE) || (type == PxGeometryType::eBOX);
+		}
+		PutNumber(definitions, count);
+
+		for (PxU32 i = 0; i < shapes.size(); i++)
+		{
+			PxGeometryHolder geometry = shapes[i]->getGeometry();
+			switch (geometry.getType())
+			{
+			case PxGeometryType::eSPHERE:
+				Put(definitions, (PxU8)PxGeometryType::eSPHERE);
+				Put(definitions, geometry.sphere().radius);
+				break;
+			case PxGeometryType::ePLANE:
+				Put(definitions, (PxU8)PxGeometryType::ePLANE);
+				break;
+			case PxGeometryType::eCAPSULE:
+				Put(definitions, (PxU8)PxGeometryType::eCAPSULE);
+				Put(definitions, geometry.capsule().radius);
+				Put(definitions, geometry.capsule().halfHeight);
+				break;
+			case PxGeometryType::eBOX:
+				Put(definitions, (PxU8)PxGeometryType::eBOX);
+				Put(definitions, geometry.box().halfExtents);
+				break;
+			default:
+				continue;
+			}
+
+			Put(definitions, shapes[i]->getLocalPose());
+			//a negative colour uses the default colour of the renderer
+			const UserData* user_data = (const UserData*)shapes[i]->userData;
+			Put(definitions, (user_data && user_data->color) ? *user_data->color : PxVec3(-1.f));
+		}
+
+		if (dynamic)
+		{
+			Tracked entry = { (PxRigidDynamic*)actor, next_id, { 0, 0, 0 }, 0, true };
+			tracked.push_back(entry);
+		}
+		next_id++;
+		new_actors++;
+	}
+
+	void MatchRecorder::Clear()
+	{
+		tracked.clear();
+		definitions.clear();
+		new_actors = 0;
+		//ids of actors that never made it into the file are reused
+		next_id = written_id;
+		cleared = true;
+	}
+
+	void MatchRecorder::Record(PxU32 step, PxReal step_time)
+	{
+		if (!file)
+			return;
+
+		bool keyframe = cleared || (frames_since_keyframe + 1 >= keyframe_interval);
+
+		//poses first, the frame needs their count in front
+		poses.clear();
+		PxU32 pose_count = 0;
+		PxU32 expected_id = 0;
+		for (PxU32 i = 0; i < tracked.size(); i++)
+		{
+			Tracked& entry = tracked[i];
+			PxRigidDynamic* actor = entry.actor;
+
+			//sleeping actors do not move, kinematic ones can be moved while asleep
+			if (!keyframe && !entry.dirty && actor->isSleeping() && !(actor->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC))
+				continue;
+
+			PxTransform pose = actor->getGlobalPose();
+			PxI32 position[3] = { QuantizePosition(pose.p.x), QuantizePosition(pose.p.y), QuantizePosition(pose.p.z) };
+			PxU32 rotation = PackRotation(pose.q);
+
+			if (!keyframe && !entry.dirty && (rotation == entry.rotation) &&
+				(position[0] == entry.position[0]) && (position[1] == entry.position[1]) && (position[2] == entry.position[2]))
+				continue;
+
+			PutNumber(poses, entry.id - expected_id);
+			expected_id = entry.id + 1;
+			for (PxU32 j = 0; j < 3; j++)
+			{
+				PutSigned(poses, keyframe ? position[j] : position[j] - entry.position[j]);
+				entry.position[j] = position[j];
+			}
+			Put(poses, rotation);
+			entry.rotation = rotation;
+			entry.dirty = false;
+			pose_count++;
+		}
+
+		frame.clear();
+		Put(frame, step);
+		Put(frame, step_time);
+		Put(frame, (PxU8)((keyframe ? FRAME_KEYFRAME : 0) | (cleared ? FRAME_CLEAR : 0)));
+		PutNumber(frame, new_actors);
+		frame.insert(frame.end(), definitions.begin(), definitions.end());
+		PutNumber(frame, pose_count);
+		frame.insert(frame.end(), poses.begin(), poses.end());
+
+		PxU32 frame_size = (PxU32)frame.size();
+		fwrite(&frame_size, sizeof(frame_size), 1, file);
+		fwrite(&frame.front(), frame.size(), 1, file);
+
+		frames_written++;
+		bytes_written += sizeof(frame_size) + frame.size();
+		frames_since_keyframe = keyframe ? 0 : frames_since_keyframe + 1;
+		definitions.clear();
+		new_actors = 0;
+		written_id = next_id;
+		cleared = false;
+	}
+
+	///MatchRecording methods
+	MatchRecording::MatchRecording() : data(0), size(0), delta_time(1.f/60.f), current(0)
+	{
+#ifdef _WIN32
+		file_handle = INVALID_HANDLE_VALUE;
+		mapping = 0;
+#endif
+	}
+
+	MatchRecording::~MatchRecording()
+	{
+		Close();
+	}
+
+	bool MatchRecording::Open(const string& filename)
+	{
+		Close();
+
+#ifdef _WIN32
+		file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		LARGE_INTEGER file_size;
+		if ((file_handle != INVALID_HANDLE_VALUE) && GetFileSizeEx(file_handle, &file_size) && (file_size.QuadPart > 0))
+		{
+			mapping = CreateFileMappingA(file_handle, 0, PAGE_READONLY, 0, 0, 0);
+			if (mapping)
+			{
+				data = (const PxU8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				size = (size_t)file_size.QuadPart;
+			}
+		}
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		struct stat file_stat;
+		if ((fd >= 0) && (fstat(fd, &file_stat) == 0) && (file_stat.st_size > 0))
+		{
+			void* memory = mmap(0, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (memory != MAP_FAILED)
+			{
+				data = (const PxU8*)memory;
+				size = (size_t)file_stat.st_size;
+			}
+		}
+		//the mapping stays valid without the descriptor
+		if (fd >= 0)
+			close(fd);
+#endif
+
+		if (!data)
+		{
+			cerr << "MatchRecording: could not open " << filename << endl;
+			Close();
+			return false;
+		}
+
+		if (!Scan())
+		{
+			cerr << "MatchRecording: " << filename << " is not a match recording" << endl;
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void MatchRecording::Close()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(file_handle);
+		mapping = 0;
+		file_handle = INVALID_HANDLE_VALUE;
+#else
+		if (data)
+			munmap((void*)data, size);
+#endif
+		data = 0;
+		size = 0;
+		frames.clear();
+		actors.clear();
+		shapes.clear();
+		colors.clear();
+		shape_data.clear();
+		positions.clear();
+		rotations.clear();
+	}
+
+	bool MatchRecording::Scan()
+	{
+		FrameReader header(data, data + size);
+		if ((header.Get<PxU32>() != MATCH_MAGIC) || (header.Get<PxU32>() != MATCH_VERSION))
+			return false;
+		delta_time = header.Get<PxReal>();
+		if (!header.ok)
+			return false;
+
+		//the definitions are read once, the poses on Seek
+		size_t offset = MATCH_HEADER;
+		PxU32 keyframe = 0, first_actor = 0;
+		while (offset + sizeof(PxU32) <= size)
+		{
+			PxU32 frame_size;
+			memcpy(&frame_size, data + offset, sizeof(PxU32));
+			offset += sizeof(PxU32);
+			if (frame_size > size - offset)
+				break;
+
+			FrameReader reader(data + offset, data + offset + frame_size);
+			Frame frame;
+			frame.step = reader.Get<PxU32>();
+			frame.step_time = reader.Get<PxReal>();
+			PxU8 flags = reader.Get<PxU8>();
+
+			//a frame can only be decoded on its own from a keyframe
+			if (flags & FRAME_KEYFRAME)
+				keyframe = (PxU32)frames.size();
+			else if (frames.empty())
+				break;
+			if (flags & FRAME_CLEAR)
+				first_actor = (PxU32)actors.size();
+
+			PxU32 count = reader.Number();
+			for (PxU32 i = 0; (i < count) && reader.ok; i++)
+			{
+				PxU8 actor_flags = reader.Get<PxU8>();
+				Actor actor;
+				actor.dynamic = (actor_flags & ACTOR_DYNAMIC) != 0;
+				actor.pose = actor.dynamic ? PxTransform(PxIdentity) : reader.Get<PxTransform>();
+				actor.first_shape = (PxU32)shapes.size();
+				actor.shape_count = reader.Number();
+
+				for (PxU32 j = 0; (j < actor.shape_count) && reader.ok; j++)
+				{
+					RenderProxy proxy;
+					switch (reader.Get<PxU8>())
+					{
+					case PxGeometryType::eSPHERE:
+						proxy.geometry = PxSphereGeometry(reader.Get<PxReal>());
+						break;
+					case PxGeometryType::ePLANE:
+						proxy.geometry = PxPlaneGeometry();
+						break;
+					case PxGeometryType::eCAPSULE:
+						{
+							PxReal radius = reader.Get<PxReal>();
+							proxy.geometry = PxCapsuleGeometry(radius, reader.Get<PxReal>());
+						}
+						break;
+					case PxGeometryType::eBOX:
+						proxy.geometry = PxBoxGeometry(reader.Get<PxVec3>());
+						break;
+					default:
+						reader.ok = false;
+						break;
+					}
+					proxy.local = reader.Get<PxTransform>();
+					proxy.hidden = (actor_flags & ACTOR_HIDDEN) != 0;
+					proxy.user_data = 0;
+					shapes.push_back(proxy);
+					colors.push_back(reader.Get<PxVec3>());
+				}
+				actors.push_back(actor);
+			}
+
+			//the poses are skipped here, this only checks that they are complete
+			frame.poses = reader.p - data;
+			frame.end = offset + frame_size;
+			PxU32 pose_count = reader.Number();
+			for (PxU32 i = 0; (i < pose_count) && reader.ok; i++)
+			{
+				reader.Number();
+				reader.Number();
+				reader.Number();
+				reader.Number();
+				reader.Get<PxU32>();
+			}
+
+			//a damaged frame ends the recording
+			if (!reader.ok)
+			{
+				actors.resize(frames.size() ? frames.back().end_actor : 0);
+				shapes.resize(actors.size() ? actors.back().first_shape + actors.back().shape_count : 0);
+				colors.resize(shapes.size());
+				break;
+			}
+
+			frame.keyframe = keyframe;
+			frame.first_actor = first_actor;
+			frame.end_actor = (PxU32)actors.size();
+			frames.push_back(frame);
+			offset += frame_size;
+		}
+
+		//the colours move no more, so the proxies can point at them
+		shape_data.resize(shapes.size());
+		for (PxU32 i = 0; i < shapes.size(); i++)
+		{
+			shape_data[i].color = (colors[i].x >= 0.f) ? &colors[i] : 0;
+			shapes[i].user_data = &shape_data[i];
+		}
+
+		positions.assign(actors.size()*3, 0);
+		rotations.assign(actors.size(), 0);
+		current = (PxU32)-1;
+		return true;
+	}
+
+	void MatchRecording::Decode(PxU32 index)
+	{
+		const Frame& frame = frames[index];
+
+		//actors added in this frame start from the origin, their first position is relative to it
+		for (PxU32 i = index ? frames[index-1].end_actor : 0; i < frame.end_actor; i++)
+		{
+			positions[i*3] = positions[i*3+1] = positions[i*3+2] = 0;
+			rotations[i] = 0;
+		}
+
+		bool keyframe = (frame.keyframe == index);
+		FrameReader reader(data + frame.poses, data + frame.end);
+		PxU32 count = reader.Number();
+		PxU32 id = 0;
+		for (PxU32 i = 0; (i < count) && reader.ok; i++)
+		{
+			id += reader.Number();
+			if (id >= frame.end_actor)
+				break;
+
+			PxI32* position = &positions[id*3];
+			for (PxU32 j = 0; j < 3; j++)
+				position[j] = keyframe ? reader.Signed() : position[j] + reader.Signed();
+			rotations[id] = reader.Get<PxU32>();
+			id++;
+		}
+	}
+
+	void MatchRecording::Seek(PxU32 index)
+	{
+		if (index >= frames.size() || (index == current))
+			return;
+
+		PxU32 first = ((current != (PxU32)-1) && (index == current + 1)) ? index : frames[index].keyframe;
+		for (PxU32 i = first; i <= index; i++)
+			Decode(i);
+		current = index;
+	}
+
+	PxTransform MatchRecording::Pose(PxU32 actor) const
+	{
+		if (!actors[actor].dynamic)
+			return actors[actor].pose;
+
+		return PxTransform(DequantizePosition(&positions[actor*3]), UnpackRotation(rotations[actor]));
+	}
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "RenderProxy.h"
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Position in mm, shared by the recordings
+	PxI32 QuantizePosition(PxReal value);
+
+	PxVec3 DequantizePosition(const PxI32* position);
+
+	///Smallest-three quaternion: index of the largest component in the top 2 bits, the other three in 10 bits each
+	PxU32 PackRotation(const PxQuat& q);
+
+	PxQuat UnpackRotation(PxU32 bits);
+
+	///Writes the poses of the moving actors of a scene after every step into a streamable file.
+	///"PXMR", version, step length, then one frame per step: byte size, step, step time, flags, new actors, poses.
+	///Positions are stored in mm, rotations as smallest-three quaternions in 32 bits.
+	///Keyframes store every dynamic actor, the frames in between only awake actors that moved,
+	///with positions relative to the previous frame. Cloth and mesh shapes are not recorded.
+	class MatchRecorder
+	{
+		///A dynamic actor and the pose last written for it
+		struct Tracked
+		{
+			PxRigidDynamic* actor;
+			PxU32 id;
+			PxI32 position[3];
+			PxU32 rotation;
+			//not written since it was added
+			bool dirty;
+		};
+
+		FILE* file;
+		std::vector<Tracked> tracked;
+		//actors added since the last frame, already serialised
+		std::vector<PxU8> definitions;
+		PxU32 new_actors;
+		//ids are the order of the definitions in the file
+		PxU32 next_id, written_id;
+		PxU32 keyframe_interval, frames_since_keyframe;
+		bool cleared;
+		std::vector<PxU8> frame, poses;
+		PxU32 frames_written;
+		PxU64 bytes_written;
+
+	public:
+		///keyframe_interval - steps between frames that store every actor, bounds the cost of a seek
+		MatchRecorder(PxU32 keyframe_interval=60);
+
+		~MatchRecorder();
+
+		///Start a new file, delta_time is the step length of the scene
+		bool Start(const std::string& filename, PxReal delta_time);
+
+		void Stop();
+
+		bool Active() const { return file != 0; }
+
+		///Start tracking an actor, see Scene::RecordMatch
+		void Add(PxActor* actor);
+
+		///Forget all actors, the scene was reset
+		void Clear();
+
+		///Write the poses after a finished step
+		void Record(PxU32 step, PxReal step_time);
+
+		PxU32 FramesWritten() const { return frames_written; }
+
+		PxU64 BytesWritten() const { return bytes_written; }
+	};
+
+	///A match recording mapped into memory, decodes the poses of any frame without PhysX
+	class MatchRecording
+	{
+	public:
+		struct Frame
+		{
+			//pose section of the frame in the file
+			size_t poses, end;
+			PxU32 step;
+			//step time of the recorded session [ms]
+			PxReal step_time;
+			//last keyframe at or before this frame
+			PxU32 keyframe;
+			//actors that exist in this frame
+			PxU32 first_actor, end_actor;
+		};
+
+		struct Actor
+		{
+			//shapes of the actor, see Shapes
+			PxU32 first_shape, shape_count;
+			//pose of static actors
+			PxTransform pose;
+			bool dynamic;
+		};
+
+	private:
+		const PxU8* data;
+		size_t size;
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping;
+#endif
+
+		PxReal delta_time;
+		std::vector<Frame> frames;
+		std::vector<Actor> actors;
+		std::vector<RenderProxy> shapes;
+		std::vector<PxVec3> colors;
+		std::vector<UserData> shape_data;
+
+		//decoded poses
+		std::vector<PxI32> positions;
+		std::vector<PxU32> rotations;
+		PxU32 current;
+
+		bool Scan();
+		void Decode(PxU32 index);
+
+	public:
+		MatchRecording();
+
+		~MatchRecording();
+
+		///Map a file written by MatchRecorder, frames cut off at the end (e.g. by a crash) are ignored
+		bool Open(const std::string& filename);
+
+		void Close();
+
+		PxReal DeltaTime() const { return delta_time; }
+
+		PxU32 FrameCount() const { return (PxU32)frames.size(); }
+
+		const Frame& GetFrame(PxU32 index) const { return frames[index]; }
+
+		PxU32 ActorCount() const { return (PxU32)actors.size(); }
+
+		const Actor& GetActor(PxU32 index) const { return actors[index]; }
+
+		///Render proxies of all actors, local poses as in PhysX
+		const std::vector<RenderProxy>& Shapes() const { return shapes; }
+
+		///Decode the poses of a frame, from the last keyframe unless it is the next one
+		void Seek(PxU32 index);
+
+		///Pose of an actor in the frame of the last Seek
+		PxTransform Pose(PxU32 actor) const;
+	};
+}
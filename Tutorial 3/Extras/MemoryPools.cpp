@@ -0,0 +1,228 @@
+#include "MemoryPools.h"
+#include <new>
+#include <stdlib.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const size_t ALIGNMENT = 16;
+	static const size_t POOL_CHUNK = 64*1024;
+	static const size_t ARENA_CHUNK = 256*1024;
+
+	///Stored ALIGNMENT bytes in front of every object allocated with ArenaNew, whatever its own size
+	struct ObjectHeader
+	{
+		//0 for objects on the heap that no arena releases
+		Arena* arena;
+		PxU32 size;
+		PxU8 tag;
+		PxU8 alive;
+	};
+
+	static_assert(sizeof(ObjectHeader) <= ALIGNMENT, "the object header has to fit into the alignment");
+
+	Arena* active_arena = 0;
+
+	inline size_t Align(size_t size)
+	{
+		return (size + ALIGNMENT-1) & ~(ALIGNMENT-1);
+	}
+
+	///PoolAllocator methods
+
+	PoolAllocator::PoolAllocator()
+	{
+		for (PxU32 i = 0; i < CLASS_COUNT; i++)
+			classes[i].block_size = MIN_BLOCK << i;
+	}
+
+	PoolAllocator::~PoolAllocator()
+	{
+		for (PxU32 i = 0; i < CLASS_COUNT; i++)
+		{
+			for (size_t j = 0; j < classes[i].chunks.size(); j++)
+				free(classes[i].chunks[j]);
+		}
+	}
+
+	void* PoolAllocator::Allocate(size_t size, PxU8& size_class)
+	{
+		if (size > MAX_BLOCK)
+			return 0;
+
+		PxU8 index = 0;
+		while ((MIN_BLOCK << index) < size)
+			index++;
+		size_class = index;
+
+		SizeClass& pool = classes[index];
+		lock_guard<mutex> guard(pool.lock);
+		if (!pool.free_list)
+		{
+			//carve a new chunk into blocks and put them on the free list
+			char* raw = (char*)malloc(POOL_CHUNK + ALIGNMENT);
+			if (!raw)
+				return 0;
+			pool.chunks.push_back(raw);
+
+			char* block = (char*)Align((size_t)raw);
+			for (size_t i = 0; i < POOL_CHUNK/pool.block_size; i++, block += pool.block_size)
+			{
+				*(void**)block = pool.free_list;
+				pool.free_list = block;
+			}
+		}
+
+		void* block = pool.free_list;
+		pool.free_list = *(void**)block;
+		return block;
+	}
+
+	void PoolAllocator::Free(void* block, PxU8 size_class)
+	{
+		SizeClass& pool = classes[size_class];
+		lock_guard<mutex> guard(pool.lock);
+		*(void**)block = pool.free_list;
+		pool.free_list = block;
+	}
+
+	size_t PoolAllocator::Reserved()
+	{
+		size_t bytes = 0;
+		for (PxU32 i = 0; i < CLASS_COUNT; i++)
+		{
+			lock_guard<mutex> guard(classes[i].lock);
+			bytes += classes[i].chunks.size()*POOL_CHUNK;
+		}
+		return bytes;
+	}
+
+	///Arena methods
+
+	Arena::Arena() : next(0), left(0), reserved(0), pooled(true)
+	{
+	}
+
+	Arena::~Arena()
+	{
+		Release();
+	}
+
+	void* Arena::Allocate(size_t size, MemoryTag tag, void (*destroy)(void*))
+	{
+		size_t bytes = ALIGNMENT + Align(size);
+		if (!pooled)
+		{
+			next = (char*)::operator new(bytes);
+			left = bytes;
+			reserved += bytes;
+		}
+		else if (bytes > left)
+		{
+			size_t chunk = (bytes > ARENA_CHUNK) ? bytes : ARENA_CHUNK;
+			char* raw = (char*)malloc(chunk + ALIGNMENT);
+			if (!raw)
+				throw bad_alloc();
+			chunks.push_back(raw);
+			next = (char*)Align((size_t)raw);
+			left = chunk;
+			reserved += chunk;
+		}
+
+		ObjectHeader* header = (ObjectHeader*)next;
+		header->arena = this;
+		header->size = (PxU32)size;
+		header->tag = (PxU8)tag;
+		header->alive = 1;
+		next += bytes;
+		left -= bytes;
+
+		void* object = (char*)header + ALIGNMENT;
+		objects.push_back(make_pair(object, destroy));
+		GetTrackingAllocator().Track(tag, size);
+		return object;
+	}
+
+	void Arena::Release()
+	{
+		//later objects may refer to earlier ones, e.g. a joint to its actors
+		for (size_t i = objects.size(); i-- > 0;)
+		{
+			ObjectHeader* header = (ObjectHeader*)((char*)objects[i].first - ALIGNMENT);
+			if (header->alive && objects[i].second)
+				objects[i].second(objects[i].first);
+		}
+
+		//the rest after all destroy functions ran, as these may still delete objects, e.g. the UserData of an actor
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			ObjectHeader* header = (ObjectHeader*)((char*)objects[i].first - ALIGNMENT);
+			if (header->alive)
+			{
+				header->alive = 0;
+				GetTrackingAllocator().Untrack((MemoryTag)header->tag, header->size);
+			}
+			if (!pooled)
+				::operator delete(header);
+		}
+		objects.clear();
+
+		for (size_t i = 0; i < chunks.size(); i++)
+			free(chunks[i]);
+		chunks.clear();
+		next = 0;
+		left = 0;
+		reserved = 0;
+	}
+
+	size_t Arena::Reserved()
+	{
+		return reserved;
+	}
+
+	void Arena::Pooled(bool value)
+	{
+		if (objects.empty())
+			pooled = value;
+	}
+
+	void ActiveArena(Arena* arena)
+	{
+		active_arena = arena;
+	}
+
+	Arena* ActiveArena()
+	{
+		return active_arena;
+	}
+
+	void* ArenaNew(size_t size, MemoryTag tag, void (*destroy)(void*))
+	{
+		if (active_arena)
+			return active_arena->Allocate(size, tag, destroy);
+
+		ObjectHeader* header = (ObjectHeader*)::operator new(ALIGNMENT + size);
+		header->arena = 0;
+		header->size = (PxU32)size;
+		header->tag = (PxU8)tag;
+		header->alive = 1;
+		GetTrackingAllocator().Track(tag, size);
+		return (char*)header + ALIGNMENT;
+	}
+
+	void ArenaDelete(void* memory)
+	{
+		if (!memory)
+			return;
+
+		ObjectHeader* header = (ObjectHeader*)((char*)memory - ALIGNMENT);
+		if (header->alive)
+			GetTrackingAllocator().Untrack((MemoryTag)header->tag, header->size);
+		header->alive = 0;
+
+		//objects of an arena stay until it is released, also when it is not pooled
+		if (!header->arena)
+			::operator delete(header);
+	}
+}
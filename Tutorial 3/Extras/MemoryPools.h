@@ -0,0 +1,90 @@
+#pragma once
+
+#include "TrackingAllocator.h"
+#include <vector>
+#include <mutex>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Fixed size blocks for the small and frequent allocations of the SDK.
+	///Every size class has its own free list and lock, chunks are kept until the pools are destroyed.
+	class PoolAllocator
+	{
+	public:
+		static const PxU32 CLASS_COUNT = 6;
+		//block sizes are 64, 128, ..., 2048 bytes
+		static const size_t MIN_BLOCK = 64;
+		static const size_t MAX_BLOCK = MIN_BLOCK << (CLASS_COUNT-1);
+
+	private:
+		struct SizeClass
+		{
+			std::mutex lock;
+			void* free_list;
+			std::vector<void*> chunks;
+			size_t block_size;
+
+			SizeClass() : free_list(0), block_size(0) {}
+		};
+
+		SizeClass classes[CLASS_COUNT];
+
+	public:
+		PoolAllocator();
+
+		~PoolAllocator();
+
+		///Get a 16 byte aligned block of at least size bytes, 0 if size is larger than MAX_BLOCK
+		void* Allocate(size_t size, PxU8& size_class);
+
+		///Return a block to its size class
+		void Free(void* block, PxU8 size_class);
+
+		///Memory taken from the heap by all size classes [bytes]
+		size_t Reserved();
+	};
+
+	///Bump allocator for the wrapper objects of a scene (actors, joints, UserData), all released at once.
+	///Objects may register a function that is called on them when the arena is released.
+	///Not pooled, every object is a heap allocation of its own, but still released with the arena.
+	///Used from the main thread only.
+	class Arena
+	{
+		std::vector<char*> chunks;
+		char* next;
+		size_t left, reserved;
+		bool pooled;
+		//objects and their destroy functions, in order of allocation
+		std::vector<std::pair<void*, void (*)(void*)> > objects;
+
+	public:
+		Arena();
+
+		~Arena();
+
+		///Get memory for an object tracked under tag, destroy (if set) is called on it when the arena is released
+		void* Allocate(size_t size, MemoryTag tag, void (*destroy)(void*)=0);
+
+		///Destroy the live objects in reverse order and free all memory
+		void Release();
+
+		///Memory taken from the heap [bytes]
+		size_t Reserved();
+
+		///Bump allocate (pool backend) or take every object from the heap, only while the arena is empty
+		void Pooled(bool value);
+	};
+
+	///Set the arena that class level operator new of the wrappers allocates from (0 = heap)
+	void ActiveArena(Arena* arena);
+
+	Arena* ActiveArena();
+
+	///Allocate a wrapper object from the active arena or the heap, tracked under tag
+	void* ArenaNew(size_t size, MemoryTag tag, void (*destroy)(void*)=0);
+
+	///Free a wrapper object allocated with ArenaNew, the memory of arena objects is only reclaimed by Arena::Release
+	void ArenaDelete(void* memory);
+}
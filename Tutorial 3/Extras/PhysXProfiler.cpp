@@ -0,0 +1,223 @@
+#include "PhysXProfiler.h"
+#include <string>
+
+namespace Profiler
+{
+	using namespace std;
+
+	PhysXEvents::ZoneReader::ZoneReader(PhysXEvents& _owner, PxProfileZone& _zone)
+		: owner(_owner), zone(_zone)
+	{
+		PxProfileNames zone_names = zone.getProfileNames();
+		lock_guard<mutex> guard(owner.lock);
+		for (PxU32 i = 0; i < zone_names.mEventCount; i++)
+			AddName(zone_names.mEvents[i]);
+	}
+
+	void PhysXEvents::ZoneReader::AddName(const PxProfileEventName& name)
+	{
+		if (name.mName)
+			names[name.mEventId.mEventId] = owner.names.insert(name.mName).first->c_str();
+	}
+
+	void PhysXEvents::ZoneReader::handleEventAdded(const PxProfileEventName& name)
+	{
+		lock_guard<mutex> guard(owner.lock);
+		AddName(name);
+	}
+
+	void PhysXEvents::ZoneReader::handleBufferFlush(const PxU8* data, PxU32 length)
+	{
+		lock_guard<mutex> guard(owner.lock);
+		if (owner.capturing)
+			PxProfileEventHandler::parseEventBuffer(data, length, *this, false);
+	}
+
+	void PhysXEvents::ZoneReader::onStartEvent(const PxProfileEventId& id, PxU32 thread, PxU64 context, PxU8 cpu, PxU8 priority, PxU64 timestamp)
+	{
+		if ((&zone == owner.sync_zone) && (id.mEventId == owner.sync_id))
+		{
+			if (owner.sync_received < 2)
+				owner.sync_timestamp[owner.sync_received++] = timestamp;
+			return;
+		}
+
+		map<PxU16, const char*>::iterator name = names.find(id.mEventId);
+		Event event = { id.mEventId, (name != names.end()) ? name->second : "PhysX event", thread, timestamp, timestamp };
+		open[thread].push_back(event);
+	}
+
+	void PhysXEvents::ZoneReader::onStopEvent(const PxProfileEventId& id, PxU32 thread, PxU64 context, PxU8 cpu, PxU8 priority, PxU64 timestamp)
+	{
+		//events nest per thread, the matching start is normally the last one
+		vector<Event>& stack = open[thread];
+		for (size_t i = stack.size(); i > 0; i--)
+		{
+			if (stack[i-1].id == id.mEventId)
+			{
+				Event event = stack[i-1];
+				event.end = timestamp;
+				owner.events.push_back(event);
+				stack.erase(stack.begin() + (i-1));
+				return;
+			}
+		}
+	}
+
+	PhysXEvents::PhysXEvents()
+		: manager(0), capturing(false), sync_zone(0), sync_id(0), sync_sent(0), sync_received(0)
+	{
+	}
+
+	PhysXEvents::~PhysXEvents()
+	{
+		Detach();
+	}
+
+	void PhysXEvents::Attach(PxProfileZoneManager& zone_manager)
+	{
+		Detach();
+
+		manager = &zone_manager;
+		manager->addProfileZoneHandler(*this);
+
+		sync_zone = &manager->createProfileZone("Profiler sync", PxProfileNames(), 0x1000);
+		sync_id = sync_zone->getEventIdForName("Profiler sync");
+	}
+
+	void PhysXEvents::Detach()
+	{
+		if (!manager)
+			return;
+
+		manager->removeProfileZoneHandler(*this);
+
+		vector<ZoneReader*> zones;
+		{
+			lock_guard<mutex> guard(lock);
+			zones.swap(readers);
+		}
+		for (size_t i = 0; i < zones.size(); i++)
+		{
+			if (capturing)
+				zones[i]->Zone().removeClient(*zones[i]);
+			delete zones[i];
+		}
+
+		if (sync_zone)
+			sync_zone->release();
+		sync_zone = 0;
+		capturing = false;
+		manager = 0;
+	}
+
+	void PhysXEvents::onZoneAdded(PxProfileZone& zone)
+	{
+		ZoneReader* reader = new ZoneReader(*this, zone);
+		{
+			lock_guard<mutex> guard(lock);
+			readers.push_back(reader);
+		}
+		if (capturing)
+			zone.addClient(*reader);
+	}
+
+	void PhysXEvents::onZoneRemoved(PxProfileZone& zone)
+	{
+		ZoneReader* reader = 0;
+		{
+			lock_guard<mutex> guard(lock);
+			for (size_t i = 0; i < readers.size(); i++)
+			{
+				if (&readers[i]->Zone() == &zone)
+				{
+					reader = readers[i];
+					readers.erase(readers.begin() + i);
+					break;
+				}
+			}
+		}
+		if (!reader)
+			return;
+
+		if (capturing)
+			zone.removeClient(*reader);
+		delete reader;
+	}
+
+	void PhysXEvents::Sync()
+	{
+		//the SDK takes its own timestamp in startEvent, take ours on both sides of it
+		unsigned long long before = Now();
+		sync_zone->startEvent(sync_id, 0);
+		unsigned long long after = Now();
+		sync_zone->stopEvent(sync_id, 0);
+
+		lock_guard<mutex> guard(lock);
+		if (sync_sent < 2)
+			sync_time[sync_sent++] = before + (after - before)/2;
+	}
+
+	void PhysXEvents::BeginCapture()
+	{
+		if (!manager)
+			return;
+
+		vector<ZoneReader*> zones;
+		{
+			lock_guard<mutex> guard(lock);
+			events.clear();
+			sync_sent = sync_received = 0;
+			capturing = true;
+			zones = readers;
+		}
+		for (size_t i = 0; i < zones.size(); i++)
+			zones[i]->Zone().addClient(*zones[i]);
+
+		Sync();
+	}
+
+	void PhysXEvents::EndCapture()
+	{
+		if (!manager || !capturing)
+			return;
+
+		Sync();
+		manager->flushProfileEvents();
+
+		vector<ZoneReader*> zones;
+		{
+			lock_guard<mutex> guard(lock);
+			capturing = false;
+			zones = readers;
+		}
+		for (size_t i = 0; i < zones.size(); i++)
+			zones[i]->Zone().removeClient(*zones[i]);
+
+		lock_guard<mutex> guard(lock);
+
+		//map the SDK clock onto ours through the two sync events
+		if ((sync_received < 2) || (sync_timestamp[1] <= sync_timestamp[0]))
+		{
+			events.clear();
+			return;
+		}
+		double scale = (double)(sync_time[1] - sync_time[0])/(double)(sync_timestamp[1] - sync_timestamp[0]);
+
+		map<PxU32, bool> named;
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			const Event& event = events[i];
+			if (!named[event.thread])
+			{
+				ExternalThreadName(event.thread, "PhysX thread " + to_string(event.thread));
+				named[event.thread] = true;
+			}
+
+			unsigned long long start = sync_time[0] + (long long)(((double)event.start - (double)sync_timestamp[0])*scale);
+			unsigned long long end = sync_time[0] + (long long)(((double)event.end - (double)sync_timestamp[0])*scale);
+			AddExternalZone(event.thread, event.name, start, end);
+		}
+		events.clear();
+	}
+}
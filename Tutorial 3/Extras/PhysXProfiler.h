@@ -0,0 +1,103 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "physxprofilesdk/PxProfileZone.h"
+#include "physxprofilesdk/PxProfileZoneManager.h"
+#include "physxprofilesdk/PxProfileEventHandler.h"
+#include "Profiler.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <mutex>
+
+namespace Profiler
+{
+	using namespace physx;
+
+	///Feeds the internal profile events of the PhysX SDK into the profiler captures.
+	///The events are read locally from the profile zone manager, no Visual Debugger connection is needed.
+	///Only the checked and profile builds of the SDK emit events.
+	class PhysXEvents : public Source, public PxProfileZoneHandler
+	{
+		///An SDK event with its start and stop timestamps on the SDK clock
+		struct Event
+		{
+			PxU16 id;
+			const char* name;
+			PxU32 thread;
+			PxU64 start, end;
+		};
+
+		///Reads the events of a single profile zone
+		class ZoneReader : public PxProfileZoneClient, public PxProfileEventHandler
+		{
+			PhysXEvents& owner;
+			PxProfileZone& zone;
+			//event names by id interned in the owner, the ids are local to the zone
+			std::map<PxU16, const char*> names;
+			//open events of each thread
+			std::map<PxU32, std::vector<Event> > open;
+
+		public:
+			ZoneReader(PhysXEvents& _owner, PxProfileZone& _zone);
+
+			PxProfileZone& Zone() { return zone; }
+
+			///Called with the lock of the owner taken
+			void AddName(const PxProfileEventName& name);
+
+			//PxProfileZoneClient
+			virtual void handleEventAdded(const PxProfileEventName& name);
+			virtual void handleBufferFlush(const PxU8* data, PxU32 length);
+			virtual void handleClientRemoved() {}
+
+			//PxProfileEventHandler
+			virtual void onStartEvent(const PxProfileEventId& id, PxU32 thread, PxU64 context, PxU8 cpu, PxU8 priority, PxU64 timestamp);
+			virtual void onStopEvent(const PxProfileEventId& id, PxU32 thread, PxU64 context, PxU8 cpu, PxU8 priority, PxU64 timestamp);
+			virtual void onEventValue(const PxProfileEventId& id, PxU32 thread, PxU64 context, PxI64 value) {}
+			virtual void onCUDAProfileBuffer(PxU64 submit_timestamp, PxF32 time_span, const PxU8* data, PxU32 length, PxU32 version) {}
+		};
+
+		PxProfileZoneManager* manager;
+		std::vector<ZoneReader*> readers;
+		bool capturing;
+		//guards everything below, never held while calling into the SDK since
+		//the SDK calls back with its own locks taken
+		std::mutex lock;
+
+		std::vector<Event> events;
+		//copies of the event names, the names of the SDK go away with their zone
+		//while the captures still point to them
+		std::set<std::string> names;
+
+		//zone used to put the profiler clock into the SDK event stream
+		PxProfileZone* sync_zone;
+		PxU16 sync_id;
+		//profiler time and SDK time of the sync events sent at the start and end of a capture
+		unsigned long long sync_time[2];
+		PxU64 sync_timestamp[2];
+		int sync_sent, sync_received;
+
+		void Sync();
+
+	public:
+		PhysXEvents();
+
+		~PhysXEvents();
+
+		///Start reading events, the manager has to be passed to PxCreatePhysics
+		void Attach(PxProfileZoneManager& zone_manager);
+
+		///Stop reading events, before the manager is released
+		void Detach();
+
+		//Source
+		virtual void BeginCapture();
+		virtual void EndCapture();
+
+		//PxProfileZoneHandler
+		virtual void onZoneAdded(PxProfileZone& zone);
+		virtual void onZoneRemoved(PxProfileZone& zone);
+	};
+}
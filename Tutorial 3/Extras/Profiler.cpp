@@ -0,0 +1,206 @@
+#include "Profiler.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <stdio.h>
+
+namespace Profiler
+{
+	using namespace std;
+
+	std::atomic<bool> capture_active(false);
+
+	///A finished zone
+	struct Event
+	{
+		const char* name;
+		unsigned long long start, end;
+	};
+
+	///Zones of a single thread, only the owner adds to it while capturing
+	struct ThreadBuffer
+	{
+		vector<Event> events;
+		//taken by the owner for every zone, uncontended except when a capture ends
+		mutex lock;
+		unsigned int id;
+		string name;
+	};
+
+	//buffers are kept after their threads exit, so their zones still end up in the trace
+	mutex registry_lock;
+	vector<ThreadBuffer*> threads;
+	unsigned long long capture_start = 0;
+
+	//threads reported by sources, shown after the profiler's own threads
+	const unsigned int external_thread_base = 1000;
+	map<unsigned int, ThreadBuffer*> external_threads;
+	vector<Source*> sources;
+
+	thread_local ThreadBuffer* thread_buffer = 0;
+
+	ThreadBuffer& Buffer()
+	{
+		if (!thread_buffer)
+		{
+			lock_guard<mutex> lock(registry_lock);
+			thread_buffer = new ThreadBuffer();
+			thread_buffer->id = (unsigned int)threads.size();
+			thread_buffer->events.reserve(4096);
+			threads.push_back(thread_buffer);
+		}
+		return *thread_buffer;
+	}
+
+	///Get the buffer of an external thread, registry_lock has to be held
+	ThreadBuffer& ExternalBuffer(unsigned int thread)
+	{
+		ThreadBuffer*& buffer = external_threads[thread];
+		if (!buffer)
+		{
+			buffer = new ThreadBuffer();
+			buffer->id = external_thread_base + thread;
+			threads.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	unsigned long long Now()
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void BeginCapture()
+	{
+		lock_guard<mutex> lock(registry_lock);
+		for (unsigned int i = 0; i < threads.size(); i++)
+		{
+			lock_guard<mutex> thread_lock(threads[i]->lock);
+			threads[i]->events.clear();
+		}
+		capture_start = Now();
+		capture_active = true;
+
+		for (unsigned int i = 0; i < sources.size(); i++)
+			sources[i]->BeginCapture();
+	}
+
+	void AddZone(const char* name, unsigned long long start, unsigned long long end)
+	{
+		if (!Capturing())
+			return;
+
+		ThreadBuffer& buffer = Buffer();
+		Event event = { name, start, end };
+		lock_guard<mutex> lock(buffer.lock);
+		buffer.events.push_back(event);
+	}
+
+	void AddSource(Source* source)
+	{
+		lock_guard<mutex> lock(registry_lock);
+		sources.push_back(source);
+	}
+
+	void RemoveSource(Source* source)
+	{
+		lock_guard<mutex> lock(registry_lock);
+		sources.erase(remove(sources.begin(), sources.end(), source), sources.end());
+	}
+
+	void AddExternalZone(unsigned int thread, const char* name, unsigned long long start, unsigned long long end)
+	{
+		if (!Capturing())
+			return;
+
+		lock_guard<mutex> lock(registry_lock);
+		Event event = { name, start, end };
+		ExternalBuffer(thread).events.push_back(event);
+	}
+
+	void ExternalThreadName(unsigned int thread, const string& name)
+	{
+		lock_guard<mutex> lock(registry_lock);
+		ExternalBuffer(thread).name = name;
+	}
+
+	void ThreadName(const string& name)
+	{
+		ThreadBuffer& buffer = Buffer();
+		lock_guard<mutex> lock(buffer.lock);
+		buffer.name = name;
+	}
+
+	///Write a string as a JSON string literal
+	void WriteString(FILE* file, const char* text)
+	{
+		fputc('"', file);
+		for (; *text; text++)
+		{
+			if ((*text == '"') || (*text == '\\'))
+				fputc('\\', file);
+			if ((unsigned char)*text >= 0x20)
+				fputc(*text, file);
+		}
+		fputc('"', file);
+	}
+
+	bool EndCapture(const string& filename)
+	{
+		if (!Capturing())
+			return false;
+
+		//sources add their events while the capture is still running
+		vector<Source*> capture_sources;
+		{
+			lock_guard<mutex> lock(registry_lock);
+			capture_sources = sources;
+		}
+		for (unsigned int i = 0; i < capture_sources.size(); i++)
+			capture_sources[i]->EndCapture();
+
+		capture_active = false;
+
+		FILE* file = fopen(filename.c_str(), "w");
+		if (!file)
+			return false;
+
+		lock_guard<mutex> lock(registry_lock);
+
+		//complete events ("X") in microseconds since the start of the capture
+		fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		bool first = true;
+		for (unsigned int i = 0; i < threads.size(); i++)
+		{
+			ThreadBuffer& buffer = *threads[i];
+			lock_guard<mutex> thread_lock(buffer.lock);
+
+			if (buffer.name.size())
+			{
+				fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer.id);
+				WriteString(file, buffer.name.c_str());
+				fprintf(file, "}}");
+				first = false;
+			}
+
+			for (unsigned int j = 0; j < buffer.events.size(); j++)
+			{
+				const Event& event = buffer.events[j];
+				if (event.start < capture_start)
+					continue;
+
+				fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+				WriteString(file, event.name);
+				fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer.id,
+					(event.start - capture_start)/1000.0, (event.end - event.start)/1000.0);
+				first = false;
+			}
+			buffer.events.clear();
+		}
+		fprintf(file, "\n]}\n");
+
+		return fclose(file) == 0;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+//set to 0 to compile all zones out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+namespace Profiler
+{
+	//do not use directly, see Capturing
+	extern std::atomic<bool> capture_active;
+
+	///Nanoseconds on the clock shared by all zones and threads
+	unsigned long long Now();
+
+	///Start recording zones on all threads, anything recorded before is discarded
+	void BeginCapture();
+
+	///Stop recording and write the zones as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+	bool EndCapture(const std::string& filename);
+
+	///Check if zones are being recorded
+	inline bool Capturing() { return capture_active.load(std::memory_order_relaxed); }
+
+	///Record a finished zone on the calling thread, name must stay valid until the capture ends
+	void AddZone(const char* name, unsigned long long start, unsigned long long end);
+
+	///Name the calling thread in traces
+	void ThreadName(const std::string& name);
+
+	///Events timed outside of PROFILE_ZONE (e.g. inside a library), merged into every capture
+	class Source
+	{
+	public:
+		virtual ~Source() {}
+
+		///Called when a capture starts
+		virtual void BeginCapture() = 0;
+
+		///Called before the trace is written, add the events with AddExternalZone
+		virtual void EndCapture() = 0;
+	};
+
+	void AddSource(Source* source);
+
+	void RemoveSource(Source* source);
+
+	///Record a finished zone of a thread the profiler does not run on, thread is any id chosen by the source
+	void AddExternalZone(unsigned int thread, const char* name, unsigned long long start, unsigned long long end);
+
+	///Name a thread used with AddExternalZone
+	void ExternalThreadName(unsigned int thread, const std::string& name);
+
+	///A zone lasting for the lifetime of the object, use PROFILE_ZONE
+	class Zone
+	{
+		const char* name;
+		unsigned long long start;
+
+	public:
+		Zone(const char* _name) : name(_name), start(Capturing() ? Now() : 0) {}
+
+		~Zone()
+		{
+			if (start)
+				AddZone(name, start, Now());
+		}
+	};
+}
+
+#if PROFILER_ENABLED
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+///Time the rest of the enclosing scope, name has to be a string literal
+#define PROFILE_ZONE(name) Profiler::Zone PROFILER_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
@@ -0,0 +1,263 @@
+#include "RenderProxy.h"
+#include <string>
+#include <algorithm>
+#include <xmmintrin.h>
+
+using namespace physx;
+
+void RenderProxyStore::Add(PxActor* actor)
+{
+	if (actor_index.count(actor))
+		return;
+
+	if (actor->isCloth())
+	{
+		actor_index[actor] = (PxU32)-1;
+		cloths.push_back((PxCloth*)actor);
+		return;
+	}
+
+	if (!actor->isRigidActor())
+		return;
+
+	PxRigidActor* rigid_actor = (PxRigidActor*)actor;
+	ActorEntry entry = { rigid_actor, (PxU32)proxies.size(), rigid_actor->getNbShapes() };
+	if (!entry.count)
+		return;
+
+	bool hidden = HiddenActor(actor);
+
+	std::vector<PxShape*> shapes(entry.count);
+	rigid_actor->getShapes(&shapes.front(), entry.count);
+
+	PxTransform actor_pose = rigid_actor->getGlobalPose();
+
+	for (PxU32 i = 0; i < entry.count; i++)
+	{
+		RenderProxy proxy;
+		proxy.local = shapes[i]->getLocalPose();
+		proxy.geometry = shapes[i]->getGeometry();
+		proxy.user_data = (const UserData*)shapes[i]->userData;
+		proxy.hidden = hidden;
+		AddProxy(proxy, actor_pose);
+	}
+
+	actor_index[actor] = (PxU32)actors.size();
+	actors.push_back(entry);
+
+	if (actor->isRigidDynamic() && (((PxRigidDynamic*)actor)->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC))
+		kinematics.push_back(actor_index[actor]);
+}
+
+void RenderProxyStore::Remove(const PxActor* actor)
+{
+	std::unordered_map<const PxActor*, PxU32>::iterator index = actor_index.find(actor);
+	if (index == actor_index.end())
+		return;
+
+	PxU32 removed = index->second;
+	actor_index.erase(index);
+
+	if (removed == (PxU32)-1)
+	{
+		cloths.erase(std::find(cloths.begin(), cloths.end(), (const PxCloth*)actor));
+		return;
+	}
+
+	ActorEntry entry = actors[removed];
+	proxies.erase(proxies.begin() + entry.first, proxies.begin() + entry.first + entry.count);
+	actors.erase(actors.begin() + removed);
+
+	//entries after the removed one were added later, their proxies follow its proxies
+	for (PxU32 i = removed; i < actors.size(); i++)
+	{
+		actors[i].first -= entry.count;
+		actor_index[actors[i].actor] = i;
+	}
+
+	kinematics.erase(std::remove(kinematics.begin(), kinematics.end(), removed), kinematics.end());
+	for (PxU32 i = 0; i < kinematics.size(); i++)
+	{
+		if (kinematics[i] > removed)
+			kinematics[i]--;
+	}
+}
+
+void RenderProxyStore::Kinematic(const PxActor* actor, bool value)
+{
+	std::unordered_map<const PxActor*, PxU32>::const_iterator index = actor_index.find(actor);
+	if ((index == actor_index.end()) || (index->second == (PxU32)-1))
+		return;
+
+	std::vector<PxU32>::iterator kinematic = std::find(kinematics.begin(), kinematics.end(), index->second);
+	if (value && (kinematic == kinematics.end()))
+		kinematics.push_back(index->second);
+	else if (!value && (kinematic != kinematics.end()))
+		kinematics.erase(kinematic);
+}
+
+void RenderProxyStore::AddProxy(RenderProxy proxy, const PxTransform& actor_pose)
+{
+	//planes are drawn in the XZ plane and moved slightly down to avoid visual artefacts
+	if (proxy.geometry.getType() == PxGeometryType::ePLANE)
+	{
+		proxy.local.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+		proxy.local.p += actor_pose.q.rotateInv(PxVec3(0.f, -0.01f, 0.f));
+	}
+
+	proxy.world = PxMat44(actor_pose * proxy.local);
+	proxies.push_back(proxy);
+}
+
+PxU32 RenderProxyStore::Add(const std::vector<RenderProxy>& shapes, const PxTransform& actor_pose)
+{
+	PxU32 first = (PxU32)proxies.size();
+	for (PxU32 i = 0; i < shapes.size(); i++)
+		AddProxy(shapes[i], actor_pose);
+	return first;
+}
+
+void RenderProxyStore::Move(PxU32 first, PxU32 count, const PxTransform& actor_pose)
+{
+	ActorEntry entry = { 0, first, count };
+	QueueActor(entry, actor_pose);
+}
+
+void RenderProxyStore::Move(const PxActor* actor, const PxTransform& actor_pose)
+{
+	std::unordered_map<const PxActor*, PxU32>::const_iterator index = actor_index.find(actor);
+	if ((index != actor_index.end()) && (index->second != (PxU32)-1))
+		QueueActor(actors[index->second], actor_pose);
+}
+
+void RenderProxyStore::Refresh()
+{
+	for (PxU32 i = 0; i < actors.size(); i++)
+		QueueActor(actors[i], actors[i].actor->getGlobalPose());
+
+	Flush();
+}
+
+bool HiddenActor(const PxActor* actor)
+{
+	return actor->getName() && (std::string(actor->getName()) == "GOALCOLLISION");
+}
+
+void RenderProxyStore::Clear()
+{
+	proxies.clear();
+	cloths.clear();
+	actors.clear();
+	actor_index.clear();
+	kinematics.clear();
+}
+
+void RenderProxyStore::QueueActor(const ActorEntry& entry, const PxTransform& actor_pose)
+{
+	for (PxU32 i = entry.first; i < entry.first + entry.count; i++)
+	{
+		poses.push_back(actor_pose * proxies[i].local);
+		targets.push_back(&proxies[i].world);
+	}
+}
+
+void RenderProxyStore::Flush()
+{
+	if (poses.size())
+		TransformsToMatrices(&poses.front(), &targets.front(), (PxU32)poses.size());
+	poses.clear();
+	targets.clear();
+}
+
+void RenderProxyStore::Update(const PxActiveTransform* transforms, PxU32 count)
+{
+	for (PxU32 i = 0; i < count; i++)
+	{
+		std::unordered_map<const PxActor*, PxU32>::const_iterator index = actor_index.find(transforms[i].actor);
+		if ((index != actor_index.end()) && (index->second != (PxU32)-1))
+			QueueActor(actors[index->second], transforms[i].actor2World);
+	}
+
+	Flush();
+}
+
+void RenderProxyStore::UpdateKinematics()
+{
+	for (PxU32 i = 0; i < kinematics.size(); i++)
+	{
+		const ActorEntry& entry = actors[kinematics[i]];
+		QueueActor(entry, entry.actor->getGlobalPose());
+	}
+
+	Flush();
+}
+
+void TransformsToMatrices(const PxTransform* poses, PxMat44* const* matrices, PxU32 count)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 two = _mm_set1_ps(2.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	PxU32 i = 0;
+	for (; i+4 <= count; i+=4)
+	{
+		//quaternions of four transforms, transposed to x,y,z,w lanes
+		__m128 x = _mm_loadu_ps(&poses[i].q.x);
+		__m128 y = _mm_loadu_ps(&poses[i+1].q.x);
+		__m128 z = _mm_loadu_ps(&poses[i+2].q.x);
+		__m128 w = _mm_loadu_ps(&poses[i+3].q.x);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 x2 = _mm_mul_ps(x, two);
+		__m128 y2 = _mm_mul_ps(y, two);
+		__m128 z2 = _mm_mul_ps(z, two);
+
+		__m128 xx = _mm_mul_ps(x, x2);
+		__m128 yy = _mm_mul_ps(y, y2);
+		__m128 zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2);
+		__m128 xz = _mm_mul_ps(x, z2);
+		__m128 yz = _mm_mul_ps(y, z2);
+		__m128 xw = _mm_mul_ps(w, x2);
+		__m128 yw = _mm_mul_ps(w, y2);
+		__m128 zw = _mm_mul_ps(w, z2);
+
+		//rotation columns, one lane per transform
+		__m128 c0x = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+		__m128 c0y = _mm_add_ps(xy, zw);
+		__m128 c0z = _mm_sub_ps(xz, yw);
+		__m128 c0w = zero;
+
+		__m128 c1x = _mm_sub_ps(xy, zw);
+		__m128 c1y = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+		__m128 c1z = _mm_add_ps(yz, xw);
+		__m128 c1w = zero;
+
+		__m128 c2x = _mm_add_ps(xz, yw);
+		__m128 c2y = _mm_sub_ps(yz, xw);
+		__m128 c2z = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+		__m128 c2w = zero;
+
+		//back to one column per transform
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+
+		__m128 c0[4] = { c0x, c0y, c0z, c0w };
+		__m128 c1[4] = { c1x, c1y, c1z, c1w };
+		__m128 c2[4] = { c2x, c2y, c2z, c2w };
+
+		for (PxU32 j = 0; j < 4; j++)
+		{
+			PxMat44& m = *matrices[i+j];
+			const PxVec3& p = poses[i+j].p;
+			_mm_storeu_ps(&m.column0.x, c0[j]);
+			_mm_storeu_ps(&m.column1.x, c1[j]);
+			_mm_storeu_ps(&m.column2.x, c2[j]);
+			m.column3 = PxVec4(p, 1.f);
+		}
+	}
+
+	for (; i < count; i++)
+		*matrices[i] = PxMat44(poses[i]);
+}
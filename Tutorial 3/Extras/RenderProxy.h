@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "PxPhysicsAPI.h"
+#include "UserData.h"
+
+///A single shape as seen by the renderer
+struct RenderProxy
+{
+	//cached world matrix
+	physx::PxMat44 world;
+	//shape pose relative to its actor
+	physx::PxTransform local;
+	physx::PxGeometryHolder geometry;
+	//colour slot of the shape
+	const UserData* user_data;
+	//shapes which are not drawn, e.g. collision volumes
+	bool hidden;
+
+	const physx::PxVec3& Color(const physx::PxVec3& default_color) const
+	{
+		if (user_data && user_data->color)
+			return *user_data->color;
+		return default_color;
+	}
+};
+
+///Flat list of render proxies kept in step with the simulation
+class RenderProxyStore
+{
+	///Proxies belonging to a single actor
+	struct ActorEntry
+	{
+		physx::PxRigidActor* actor;
+		physx::PxU32 first;
+		physx::PxU32 count;
+	};
+
+	std::vector<RenderProxy> proxies;
+	std::vector<physx::PxCloth*> cloths;
+	std::vector<ActorEntry> actors;
+	std::unordered_map<const physx::PxActor*, physx::PxU32> actor_index;
+	//entries of the kinematic actors, see Kinematic
+	std::vector<physx::PxU32> kinematics;
+
+	//scratch buffers for the batched matrix update
+	std::vector<physx::PxTransform> poses;
+	std::vector<physx::PxMat44*> targets;
+
+	void QueueActor(const ActorEntry& entry, const physx::PxTransform& actor_pose);
+
+	void AddProxy(RenderProxy proxy, const physx::PxTransform& actor_pose);
+
+public:
+	///Create proxies for all shapes of an actor
+	void Add(physx::PxActor* actor);
+
+	///Drop the proxies of an actor, the proxies added after it move down
+	void Remove(const physx::PxActor* actor);
+
+	///Mark an actor as kinematic or not, e.g. after its flag changed, see UpdateKinematics
+	void Kinematic(const physx::PxActor* actor, bool value);
+
+	///Create proxies for shapes without a PhysX actor (e.g. from a recording), local poses as in PhysX.
+	///Returns the index of the first proxy.
+	physx::PxU32 Add(const std::vector<RenderProxy>& shapes, const physx::PxTransform& actor_pose);
+
+	///Move proxies created without an actor, the matrices change on Flush
+	void Move(physx::PxU32 first, physx::PxU32 count, const physx::PxTransform& actor_pose);
+
+	///Show an actor at another pose than its simulated one (e.g. during a replay), the matrices change on Flush
+	void Move(const physx::PxActor* actor, const physx::PxTransform& actor_pose);
+
+	///Back to the simulated poses of all actors
+	void Refresh();
+
+	///Update the matrices of the proxies moved since the last Flush
+	void Flush();
+
+	///Drop all proxies
+	void Clear();
+
+	///Refresh proxies of actors moved by the last simulation step
+	void Update(const physx::PxActiveTransform* transforms, physx::PxU32 count);
+
+	///Refresh kinematic actors, which can be moved without showing up as active.
+	///Kinematic at Add or marked with Kinematic, the flags are not queried.
+	void UpdateKinematics();
+
+	const std::vector<RenderProxy>& Proxies() const { return proxies; }
+
+	const std::vector<physx::PxCloth*>& Cloths() const { return cloths; }
+};
+
+///Collision volumes with no visual representation
+bool HiddenActor(const physx::PxActor* actor);
+
+///Convert rigid transforms to matrices, four at a time
+void TransformsToMatrices(const physx::PxTransform* poses, physx::PxMat44* const* matrices, physx::PxU32 count);
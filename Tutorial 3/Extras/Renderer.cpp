@@ -1,7 +1,27 @@
 #include "Renderer.h"
+#include "Profiler.h"
 #include <iostream>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <xmmintrin.h>
+#include <stdlib.h>
 #include "UserData.h"
+#include "GLExtensions.h"
+
+//offscreen rendering uses a software context by default where OSMesa is available, so that headless runs
+//need no display; RENDER_WINDOW falls back to a GLUT window (always the case on Windows)
+#if !defined(_WIN32) && !defined(RENDER_WINDOW) && !defined(RENDER_OSMESA)
+#define RENDER_OSMESA
+#endif
+
+#ifdef RENDER_OSMESA
+#include <GL/osmesa.h>
+#endif
 
 using namespace std;
 
@@ -13,6 +33,60 @@ namespace VisualDebugger
 		PxVec3 background_color = PxVec3(0.f,0.f,0.f);
 		int render_detail = 10;
 		bool show_shadows = true;
+		bool shadows_supported = false;
+		ShadowQuality shadow_quality = SHADOW_MEDIUM;
+		PxU32 shadow_resolution = 2048;
+		//half size of the area covered by the shadow map [m]
+		PxReal shadow_extent = 80.f;
+		PxReal shadow_darkness = 0.35f;
+		const PxVec3 shadow_dir = PxVec3(-1.f, -1.f, -1.f).getNormalized();
+		Stats stats;
+
+		PxVec3 camera_eye;
+		PxVec3 camera_dir;
+
+		//offscreen framebuffer size (0 = render into the GLUT window)
+		int offscreen_width = 0;
+		int offscreen_height = 0;
+#ifdef RENDER_OSMESA
+		OSMesaContext offscreen_context = 0;
+		std::vector<GLubyte> offscreen_buffer;
+#endif
+
+		//shared quadric for spheres and cylinders
+		GLUquadric* quadric = 0;
+
+		//shadow map resources
+		GLuint shadow_texture = 0;
+		GLuint shadow_framebuffer = 0;
+		GLuint white_texture = 0;
+		PxU32 shadow_texture_size = 0;
+		bool shadow_framebuffer_failed = false;
+		PxMat44 shadow_matrix = PxMat44(PxIdentity);
+
+		enum RenderPass
+		{
+			PASS_SHADOW,
+			PASS_MAIN
+		};
+
+		///A single draw, ordered by pass, geometry kind, lighting and colour
+		struct DrawCommand
+		{
+			//pass:1 | geometry:4 | unlit:1 | colour:24 | proxy index:32
+			PxU64 key;
+			const RenderProxy* proxy;
+
+			bool operator<(const DrawCommand& other) const { return key < other.key; }
+
+			RenderPass Pass() const { return (RenderPass)(key >> 63); }
+		};
+
+		//draws of the current frame for the shadow and the main pass, sorted by key
+		std::vector<DrawCommand> commands;
+
+		//proxies built on the fly when rendering a plain list of actors
+		RenderProxyStore actor_proxies;
 
 		static float gPlaneData[]={
 			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
@@ -32,16 +106,37 @@ namespace VisualDebugger
 			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
+		static float gCubeData[]={
+			1.f, -1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, -1.f, 1.f, 1.f, 0.f, 0.f,
+			-1.f, -1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -1.f, -1.f, -1.f, -1.f, 0.f, 0.f,
+			-1.f, 1.f, -1.f, 0.f, 1.f, 0.f, -1.f, 1.f, 1.f, 0.f, 1.f, 0.f, 1.f, 1.f, 1.f, 0.f, 1.f, 0.f, 1.f, 1.f, -1.f, 0.f, 1.f, 0.f,
+			-1.f, -1.f, 1.f, 0.f, -1.f, 0.f, -1.f, -1.f, -1.f, 0.f, -1.f, 0.f, 1.f, -1.f, -1.f, 0.f, -1.f, 0.f, 1.f, -1.f, 1.f, 0.f, -1.f, 0.f,
+			-1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, -1.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f, 1.f, 0.f, 0.f, 1.f, -1.f, 1.f, 1.f, 0.f, 0.f, 1.f,
+			-1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, 1.f, -1.f, 0.f, 0.f, -1.f, 1.f, -1.f, -1.f, 0.f, 0.f, -1.f, -1.f, -1.f, -1.f, 0.f, 0.f, -1.f
+		};
+
+		void DrawSphere(PxReal radius)
+		{
+			//same tessellation as glutSolidSphere, without needing GLUT to be initialised
+			gluSphere(quadric, radius, render_detail, render_detail);
+		}
+
 		void DrawSphere(const PxGeometryHolder& geometry)
 		{
-			glutSolidSphere(geometry.sphere().radius, render_detail, render_detail);
+			DrawSphere(geometry.sphere().radius);
 		}
 
 		void DrawBox(const PxGeometryHolder& geometry)
 		{
 			PxVec3 half_size = geometry.box().halfExtents;
 			glScalef(half_size.x, half_size.y, half_size.z);
-			glutSolidCube(2.f);		
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, 2*3*sizeof(float), gCubeData);
+			glNormalPointer(GL_FLOAT, 2*3*sizeof(float), gCubeData+3);
+			glDrawArrays(GL_QUADS, 0, 24);
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
 		void DrawCapsule(const PxGeometryHolder& geometry)
@@ -52,13 +147,13 @@ namespace VisualDebugger
 			//Sphere
 			glPushMatrix();
 			glTranslatef(halfHeight,0.f, 0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
+			DrawSphere(radius);
 			glPopMatrix();
 
 			//Sphere
 			glPushMatrix();
 			glTranslatef(-halfHeight,0.f,0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
+			DrawSphere(radius);
 			glPopMatrix();
 
 			//Cylinder
@@ -66,59 +161,184 @@ namespace VisualDebugger
 			glTranslatef(-halfHeight,0.f,0.f);
 			glRotatef(90.f,0.f,1.f,0.f);
 
-			GLUquadric* qobj = gluNewQuadric();
-			gluQuadricNormals(qobj, GLU_SMOOTH);
-			gluCylinder(qobj, radius, radius, halfHeight*2.f, render_detail, render_detail);
-			gluDeleteQuadric(qobj);
+			gluCylinder(quadric, radius, radius, halfHeight*2.f, render_detail, render_detail);
 			glPopMatrix();
 		}
 
-		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		///Flat shaded vertex, faces do not share vertices
+		struct MeshVertex
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
+			PxVec3 pos;
+			PxVec3 normal;
+		};
+
+		///Convex or triangle mesh triangulated once, kept until the mesh is released
+		struct MeshBuffers
+		{
+			std::vector<MeshVertex> verts;
+			std::vector<PxU32> indices;
+			//16 bit copy of the indices for meshes with less than 64k vertices
+			std::vector<PxU16> indices16;
+			GLuint vertex_buffer;
+			GLuint index_buffer;
+
+			MeshBuffers() : vertex_buffer(0), index_buffer(0) {}
+
+			~MeshBuffers()
+			{
+				if (vertex_buffer)
+					GLExtensions::DeleteBuffers(1, &vertex_buffer);
+				if (index_buffer)
+					GLExtensions::DeleteBuffers(1, &index_buffer);
+			}
+
+			void AddVertex(const PxVec3& pos, const PxVec3& normal)
+			{
+				MeshVertex v = { pos, normal };
+				verts.push_back(v);
+			}
+
+			///Pick the index width and upload everything to the GPU when possible
+			void Finish()
+			{
+				if (verts.size() <= 0xffff)
+				{
+					indices16.assign(indices.begin(), indices.end());
+					std::vector<PxU32>().swap(indices);
+				}
+
+				if (GLExtensions::HasBuffers() && verts.size())
+				{
+					GLExtensions::GenBuffers(1, &vertex_buffer);
+					GLExtensions::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+					GLExtensions::BufferData(GL_ARRAY_BUFFER, verts.size()*sizeof(MeshVertex), &verts.front(), GL_STATIC_DRAW);
+					GLExtensions::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+					GLExtensions::GenBuffers(1, &index_buffer);
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+					if (indices16.size())
+						GLExtensions::BufferData(GL_ELEMENT_ARRAY_BUFFER, indices16.size()*sizeof(PxU16), &indices16.front(), GL_STATIC_DRAW);
+					else
+						GLExtensions::BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(PxU32), &indices.front(), GL_STATIC_DRAW);
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+				}
+			}
+
+			void Draw() const
+			{
+				GLsizei count = (GLsizei)(indices16.size() ? indices16.size() : indices.size());
+				if (!count)
+					return;
+
+				const GLubyte* vertex_data = vertex_buffer ? 0 : (const GLubyte*)&verts.front();
+				const GLvoid* index_data = 0;
+				if (index_buffer)
+				{
+					GLExtensions::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+				}
+				else
+					index_data = indices16.size() ? (const GLvoid*)&indices16.front() : (const GLvoid*)&indices.front();
+
+				glEnableClientState(GL_VERTEX_ARRAY);
+				glEnableClientState(GL_NORMAL_ARRAY);
+				glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), vertex_data + offsetof(MeshVertex, pos));
+				glNormalPointer(GL_FLOAT, sizeof(MeshVertex), vertex_data + offsetof(MeshVertex, normal));
+				glDrawElements(GL_TRIANGLES, count, indices16.size() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, index_data);
+				glDisableClientState(GL_NORMAL_ARRAY);
+				glDisableClientState(GL_VERTEX_ARRAY);
+
+				if (index_buffer)
+				{
+					GLExtensions::BindBuffer(GL_ARRAY_BUFFER, 0);
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+				}
+			}
+		};
+
+		std::map<const PxBase*, MeshBuffers*> mesh_buffers;
+
+		MeshBuffers* CreateConvexMesh(const PxConvexMesh* mesh)
+		{
+			MeshBuffers* buffers = new MeshBuffers();
 			const PxVec3* verts = mesh->getVertices();
 			const PxU8* indicies = mesh->getIndexBuffer();
 
-			for (PxU32 i = 0; i < num_polys; i++)
+			for (PxU32 i = 0; i < mesh->getNbPolygons(); i++)
 			{
 				PxHullPolygon face;
-				if (mesh->getPolygonData(i,face))
+				if (mesh->getPolygonData(i,face) && (face.mNbVerts >= 3))
 				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
+					PxVec3 normal(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
 					const PxU8* faceIdx = indicies + face.mIndexBase;
+					PxU32 base = (PxU32)buffers->verts.size();
 					for (PxU32 j = 0; j < face.mNbVerts; j++)
+						buffers->AddVertex(verts[faceIdx[j]], normal);
+
+					//hull faces are convex, a fan keeps the winding of the polygon
+					for (PxU32 j = 1; j+1 < face.mNbVerts; j++)
 					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x,v.y,v.z);
+						buffers->indices.push_back(base);
+						buffers->indices.push_back(base+j);
+						buffers->indices.push_back(base+j+1);
 					}
-					glEnd();
 				}
 			}
+
+			buffers->Finish();
+			return buffers;
 		}
 
-		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		MeshBuffers* CreateTriangleMesh(const PxTriangleMesh* mesh)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
+			MeshBuffers* buffers = new MeshBuffers();
 			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
 			const PxU32 num_trigs = mesh->getNbTriangles();
+			//the mesh stores either 16 or 32 bit indices
+			bool has_16bit = mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES;
+			const PxU16* trigs16 = (const PxU16*)mesh->getTriangles();
+			const PxU32* trigs32 = (const PxU32*)mesh->getTriangles();
+
+			buffers->verts.reserve(num_trigs*3);
+			buffers->indices.reserve(num_trigs*3);
 
 			for (PxU32 i = 0; i < num_trigs*3; i+=3)
 			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
+				PxVec3 v0 = verts[has_16bit ? trigs16[i] : trigs32[i]];
+				PxVec3 v1 = verts[has_16bit ? trigs16[i+1] : trigs32[i+1]];
+				PxVec3 v2 = verts[has_16bit ? trigs16[i+2] : trigs32[i+2]];
 				PxVec3 n = (v1-v0).cross(v2-v0);
 				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
+
+				PxU32 base = (PxU32)buffers->verts.size();
+				buffers->AddVertex(v0, n);
+				buffers->AddVertex(v1, n);
+				buffers->AddVertex(v2, n);
+				buffers->indices.push_back(base);
+				buffers->indices.push_back(base+1);
+				buffers->indices.push_back(base+2);
 			}
+
+			buffers->Finish();
+			return buffers;
+		}
+
+		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		{
+			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
+			MeshBuffers*& buffers = mesh_buffers[mesh];
+			if (!buffers)
+				buffers = CreateConvexMesh(mesh);
+			buffers->Draw();
+		}
+
+		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		{
+			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
+			MeshBuffers*& buffers = mesh_buffers[mesh];
+			if (!buffers)
+				buffers = CreateTriangleMesh(mesh);
+			buffers->Draw();
 		}
 
 		void DrawHeightField(const PxGeometryHolder& geometry)
@@ -156,6 +376,151 @@ namespace VisualDebugger
 			}
 		}
 
+		///Per-cloth render buffers, kept between frames
+		struct ClothBuffers
+		{
+			//particles are copied as they are (position + inverse weight), so 16 byte strides
+			std::vector<PxVec4> verts;
+			std::vector<PxVec4> norms;
+			const PxU32* quads;
+			GLuint vertex_buffer;
+			GLuint index_buffer;
+			bool valid;
+
+			ClothBuffers() : quads(0), vertex_buffer(0), index_buffer(0), valid(false) {}
+
+			~ClothBuffers()
+			{
+				if (vertex_buffer)
+					GLExtensions::DeleteBuffers(1, &vertex_buffer);
+				if (index_buffer)
+					GLExtensions::DeleteBuffers(1, &index_buffer);
+			}
+		};
+
+		std::map<const PxCloth*, ClothBuffers*> cloth_buffers;
+
+		///Releases renderer resources that belong to PhysX objects going away
+		class DeletionListener : public PxDeletionListener
+		{
+		public:
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				std::map<const PxCloth*, ClothBuffers*>::iterator cloth = cloth_buffers.find((const PxCloth*)observed);
+				if (cloth != cloth_buffers.end())
+				{
+					delete cloth->second;
+					cloth_buffers.erase(cloth);
+				}
+
+				std::map<const PxBase*, MeshBuffers*>::iterator mesh = mesh_buffers.find(observed);
+				if (mesh != mesh_buffers.end())
+				{
+					delete mesh->second;
+					mesh_buffers.erase(mesh);
+				}
+			}
+		};
+
+		DeletionListener deletion_listener;
+
+		inline __m128 Cross(const __m128& a, const __m128& b)
+		{
+			__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		///Accumulate quad normals into vertex normals and normalise them (SSE)
+		void ComputeClothNormals(const PxVec4* verts, PxVec4* norms, PxU32 vert_count, const PxU32* quads, PxU32 quad_count)
+		{
+			memset(norms, 0, vert_count*sizeof(PxVec4));
+
+			//w holds the inverse weight; it cancels out in the cross product so the normals keep w = 0
+			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			{
+				__m128 v0 = _mm_loadu_ps(&verts[quads[i]].x);
+				__m128 e0 = _mm_sub_ps(_mm_loadu_ps(&verts[quads[i+1]].x), v0);
+				__m128 e1 = _mm_sub_ps(_mm_loadu_ps(&verts[quads[i+2]].x), v0);
+				__m128 n = Cross(e1, e0);
+
+				for (PxU32 j = 0; j < 4; j++)
+				{
+					float* norm = &norms[quads[i+j]].x;
+					_mm_storeu_ps(norm, _mm_add_ps(_mm_loadu_ps(norm), n));
+				}
+			}
+
+			//normalise four normals at a time
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 three = _mm_set1_ps(3.f);
+			const __m128 epsilon = _mm_set1_ps(1e-20f);
+			PxU32 i = 0;
+			for (; i+4 <= vert_count; i+=4)
+			{
+				__m128 x = _mm_loadu_ps(&norms[i].x);
+				__m128 y = _mm_loadu_ps(&norms[i+1].x);
+				__m128 z = _mm_loadu_ps(&norms[i+2].x);
+				__m128 w = _mm_loadu_ps(&norms[i+3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				__m128 length2 = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), epsilon);
+				//reciprocal square root estimate refined with one Newton-Raphson step
+				__m128 r = _mm_rsqrt_ps(length2);
+				r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(length2, r), r)));
+				x = _mm_mul_ps(x, r);
+				y = _mm_mul_ps(y, r);
+				z = _mm_mul_ps(z, r);
+
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				_mm_storeu_ps(&norms[i].x, x);
+				_mm_storeu_ps(&norms[i+1].x, y);
+				_mm_storeu_ps(&norms[i+2].x, z);
+				_mm_storeu_ps(&norms[i+3].x, w);
+			}
+
+			for (; i < vert_count; i++)
+			{
+				PxVec3 n = norms[i].getXYZ();
+				n.normalize();
+				norms[i] = PxVec4(n, 0.f);
+			}
+		}
+
+		///Copy the particles and rebuild the normals if the cloth has moved, returns true if anything changed
+		bool UpdateCloth(const PxCloth* cloth, ClothBuffers& buffers, const PxU32* quads, PxU32 quad_count)
+		{
+			//nothing to do for a resting cloth
+			if (buffers.valid && cloth->isSleeping())
+				return false;
+
+			PxClothParticleData* particle_data = cloth->lockParticleData();
+			if (!particle_data)
+				return false;
+
+			PxU32 vert_count = cloth->getNbParticles();
+			bool changed = !buffers.valid || (buffers.verts.size() != vert_count) ||
+				(memcmp(&buffers.verts.front(), particle_data->particles, vert_count*sizeof(PxVec4)) != 0);
+
+			if (changed)
+			{
+				buffers.verts.resize(vert_count);
+				buffers.norms.resize(vert_count);
+				memcpy(&buffers.verts.front(), particle_data->particles, vert_count*sizeof(PxVec4));
+			}
+
+			particle_data->unlock();
+
+			if (changed)
+			{
+				ComputeClothNormals(&buffers.verts.front(), &buffers.norms.front(), vert_count, quads, quad_count);
+				buffers.valid = true;
+			}
+
+			return changed;
+		}
+
 		void RenderCloth(const PxCloth* cloth)
 		{
 			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
@@ -164,36 +529,56 @@ namespace VisualDebugger
 			PxU32 quad_count = mesh_desc->quads.count;
 			PxU32* quads = (PxU32*)mesh_desc->quads.data;
 
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
+			if (!cloth->getNbParticles() || !quad_count)
+				return;
 
-			//get verts data
-			cloth->lockParticleData();
+			ClothBuffers*& buffers = cloth_buffers[cloth];
+			if (!buffers)
+				buffers = new ClothBuffers();
 
-			PxClothParticleData* particle_data = cloth->lockParticleData();
-			if (!particle_data)
+			bool changed = UpdateCloth(cloth, *buffers, quads, quad_count);
+			if (!buffers->valid)
 				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
 
-			particle_data->unlock();
+			PxU32 vert_count = (PxU32)buffers->verts.size();
+			GLsizeiptr verts_size = vert_count*sizeof(PxVec4);
+			const GLvoid* vertex_pointer = &buffers->verts.front();
+			const GLvoid* normal_pointer = &buffers->norms.front();
+			const GLvoid* index_pointer = quads;
 
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			if (GLExtensions::HasBuffers())
 			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
+				if (!buffers->vertex_buffer)
+				{
+					GLExtensions::GenBuffers(1, &buffers->vertex_buffer);
+					changed = true;
+				}
 
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
-			}
+				//the topology never changes, upload the quads once
+				if (!buffers->index_buffer || (buffers->quads != quads))
+				{
+					if (!buffers->index_buffer)
+						GLExtensions::GenBuffers(1, &buffers->index_buffer);
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->index_buffer);
+					GLExtensions::BufferData(GL_ELEMENT_ARRAY_BUFFER, quad_count*4*sizeof(PxU32), quads, GL_STATIC_DRAW);
+					buffers->quads = quads;
+				}
+				else
+					GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->index_buffer);
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+				GLExtensions::BindBuffer(GL_ARRAY_BUFFER, buffers->vertex_buffer);
+				if (changed)
+				{
+					//orphan the old storage so the upload does not wait for the previous frame
+					GLExtensions::BufferData(GL_ARRAY_BUFFER, verts_size*2, 0, GL_STREAM_DRAW);
+					GLExtensions::BufferSubData(GL_ARRAY_BUFFER, 0, verts_size, &buffers->verts.front());
+					GLExtensions::BufferSubData(GL_ARRAY_BUFFER, verts_size, verts_size, &buffers->norms.front());
+				}
+
+				vertex_pointer = 0;
+				normal_pointer = (const GLvoid*)verts_size;
+				index_pointer = 0;
+			}
 
 			PxTransform pose = cloth->getGlobalPose();
 			PxMat44 shapePose(pose);
@@ -206,15 +591,21 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec4), vertex_pointer);
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), normal_pointer);
 
-			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
+			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, index_pointer);
 
 			glDisableClientState(GL_NORMAL_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 
 			glPopMatrix();
+
+			if (GLExtensions::HasBuffers())
+			{
+				GLExtensions::BindBuffer(GL_ARRAY_BUFFER, 0);
+				GLExtensions::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
 		}
 
 		void reshapeCallback(int width, int height)
@@ -250,8 +641,89 @@ namespace VisualDebugger
 			delete[] namestr;
 		}
 
+		bool InitOffscreen(int width, int height)
+		{
+#ifdef RENDER_OSMESA
+			offscreen_context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, 0);
+			if (!offscreen_context)
+				return false;
+
+			offscreen_buffer.resize(width*height*4);
+			if (!OSMesaMakeCurrent(offscreen_context, &offscreen_buffer.front(), GL_UNSIGNED_BYTE, width, height))
+			{
+				OSMesaDestroyContext(offscreen_context);
+				offscreen_context = 0;
+				return false;
+			}
+#else
+			//no software context available, render into a window of the requested size instead;
+			//glutInit would end the process without a display, so check for one first
+#ifdef _WIN32
+			if (!GetSystemMetrics(SM_CMONITORS))
+#else
+			if (!getenv("DISPLAY"))
+#endif
+			{
+				cerr << "Renderer::InitOffscreen, no display available and no software context, build with RENDER_OSMESA to render headless." << endl;
+				return false;
+			}
+
+			char name[] = "Offscreen";
+			int argc = 1;
+			char* argv[1] = { name };
+			glutInit(&argc, argv);
+			glutInitWindowSize(width, height);
+			glutInitDisplayMode(GLUT_RGB|GLUT_DOUBLE|GLUT_DEPTH);
+			glutSetWindow(glutCreateWindow(name));
+#endif
+			offscreen_width = width;
+			offscreen_height = height;
+			glViewport(0, 0, width, height);
+			return true;
+		}
+
+		int WindowWidth()
+		{
+			return offscreen_width ? offscreen_width : glutGet(GLUT_WINDOW_WIDTH);
+		}
+
+		int WindowHeight()
+		{
+			return offscreen_height ? offscreen_height : glutGet(GLUT_WINDOW_HEIGHT);
+		}
+
+		bool SaveFrame(const std::string& filename)
+		{
+			int width = WindowWidth();
+			int height = WindowHeight();
+			std::vector<GLubyte> pixels(width*height*3);
+
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, width, height, GL_BGR, GL_UNSIGNED_BYTE, &pixels.front());
+
+			FILE* file = fopen(filename.c_str(), "wb");
+			if (!file)
+				return false;
+
+			//uncompressed true colour TGA, stored bottom-up like the framebuffer
+			GLubyte header[18] = { 0 };
+			header[2] = 2;
+			header[12] = width & 0xff;
+			header[13] = (width >> 8) & 0xff;
+			header[14] = height & 0xff;
+			header[15] = (height >> 8) & 0xff;
+			header[16] = 24;
+
+			bool result = (fwrite(header, sizeof(header), 1, file) == 1) && (fwrite(&pixels.front(), pixels.size(), 1, file) == 1);
+			fclose(file);
+			return result;
+		}
+
 		void Init()
 		{
+			quadric = gluNewQuadric();
+			gluQuadricNormals(quadric, GLU_SMOOTH);
+
 			// Setup default render states
 			PxReal specular_material[]	= { .1f, .1f, .1f, 1.f };
 			glEnable(GL_DEPTH_TEST);
@@ -269,111 +741,459 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			GLExtensions::Init();
+
+			//free cached buffers together with the PhysX objects they were built for
+			PxGetPhysics().registerDeletionListener(deletion_listener, PxDeletionEventFlag::eMEMORY_RELEASE);
+
+			// Setup shadow mapping
+			shadows_supported = GLExtensions::HasShadowMaps();
+			if (shadows_supported)
+			{
+				GLubyte white[] = { 255, 255, 255, 255 };
+				glGenTextures(1, &white_texture);
+				glBindTexture(GL_TEXTURE_2D, white_texture);
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+			else
+				cerr << "Renderer: depth textures are not supported, shadows disabled." << endl;
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
 		{
+			camera_eye = cameraEye;
+			camera_dir = cameraDir;
+
+			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 			// Setup camera
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			gluPerspective(60.f, (float)WindowWidth()/(float)WindowHeight(), 1.f, 10000.f);
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
 			gluLookAt(cameraEye.x, cameraEye.y, cameraEye.z, cameraEye.x + cameraDir.x, cameraEye.y + cameraDir.y, cameraEye.z + cameraDir.z, 0.f, 1.f, 0.f);
 		}
 
+		PxBounds3 ViewBounds(PxReal distance)
+		{
+			PxVec3 dir = camera_dir.getNormalized();
+			PxVec3 right = dir.cross(PxVec3(0.f, 1.f, 0.f));
+			//looking straight up or down, any side vector will do
+			if (right.magnitudeSquared() < 1e-6f)
+				right = PxVec3(1.f, 0.f, 0.f);
+			right.normalize();
+			PxVec3 up = right.cross(dir);
+
+			//same field of view as the projection in Start
+			PxReal half_height = PxTan(PxPi/6.f);
+			PxReal half_width = half_height*(float)WindowWidth()/(float)WindowHeight();
+
+			//the frustum is a pyramid from the eye to the far rectangle
+			PxBounds3 bounds = PxBounds3::empty();
+			bounds.include(camera_eye);
+			for (int i = 0; i < 4; i++)
+			{
+				PxVec3 corner = dir + right*((i & 1) ? half_width : -half_width) + up*((i & 2) ? half_height : -half_height);
+				bounds.include(camera_eye + corner*distance);
+			}
+			return bounds;
+		}
+
 		void BackgroundColor(const PxVec3& color)
 		{
 			background_color = color;
 		}
 
-		void Render(PxActor** actors, const PxU32 numActors)
+		int ShadowDetail()
+		{
+			switch (shadow_quality)
+			{
+			case SHADOW_LOW:
+				return PxMin(render_detail, 6);
+			case SHADOW_MEDIUM:
+				return PxMin(render_detail, 10);
+			default:
+				return render_detail;
+			}
+		}
+
+		void ReleaseShadowMap()
 		{
-			PxVec3 shadow_color = default_color*0.9;
-			for(PxU32 i=0;i<numActors;i++)
+			if (shadow_framebuffer)
+				GLExtensions::DeleteFramebuffers(1, &shadow_framebuffer);
+			if (shadow_texture)
+				glDeleteTextures(1, &shadow_texture);
+			shadow_framebuffer = 0;
+			shadow_texture = 0;
+			shadow_texture_size = 0;
+		}
+
+		PxU32 ShadowMapSize()
+		{
+			GLint max_size = 0;
+			glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+			PxU32 limit = PxMin(shadow_resolution, (PxU32)max_size);
+
+			//without render-to-texture the map is copied from the back buffer, so it cannot exceed the window
+			if (!GLExtensions::HasFramebufferObjects() || shadow_framebuffer_failed)
+				limit = PxMin(limit, (PxU32)PxMin(WindowWidth(), WindowHeight()));
+
+			PxU32 size = 1;
+			while (size*2 <= limit)
+				size *= 2;
+			return size;
+		}
+
+		bool CreateShadowMap(PxU32 size)
+		{
+			ReleaseShadowMap();
+
+			GLint filter = (shadow_quality == SHADOW_LOW) ? GL_NEAREST : GL_LINEAR;
+			PxReal border[] = { 1.f, 1.f, 1.f, 1.f };
+
+			glGenTextures(1, &shadow_texture);
+			glBindTexture(GL_TEXTURE_2D, shadow_texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			//anything outside of the light frustum is lit
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_LUMINANCE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			if (GLExtensions::HasFramebufferObjects() && !shadow_framebuffer_failed)
 			{
-				// dont render collision shape
-				string actorName = actors[i]->getName();
-				if (actorName == "GOALCOLLISION")
+				GLExtensions::GenFramebuffers(1, &shadow_framebuffer);
+				GLExtensions::BindFramebuffer(GL_FRAMEBUFFER_EXT, shadow_framebuffer);
+				GLExtensions::FramebufferTexture2D(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_TEXTURE_2D, shadow_texture, 0);
+				glDrawBuffer(GL_NONE);
+				glReadBuffer(GL_NONE);
+				bool complete = (GLExtensions::CheckFramebufferStatus(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT);
+				GLExtensions::BindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+
+				if (!complete)
 				{
+					//fall back to copying from the back buffer (sized to the window) next frame
+					cerr << "Renderer: depth-only framebuffer not supported, copying shadow maps from the back buffer." << endl;
+					shadow_framebuffer_failed = true;
+					ReleaseShadowMap();
+					return false;
+				}
+			}
+
+			shadow_texture_size = size;
+			return true;
+		}
+
+		void RenderShadowMap()
+		{
+			PROFILE_ZONE("Renderer::RenderShadowMap");
+			PxU32 size = ShadowMapSize();
+			if (!shadow_texture || (size != shadow_texture_size))
+			{
+				if (!CreateShadowMap(size))
+					return;
+			}
+
+			//an orthographic light frustum around the area in front of the camera
+			PxVec3 center = camera_eye + camera_dir*shadow_extent;
+			PxVec3 light_eye = center - shadow_dir*(shadow_extent*2.f);
+
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(-shadow_extent, shadow_extent, -shadow_extent, shadow_extent, 0.f, shadow_extent*4.f);
+			PxReal light_projection[16];
+			glGetFloatv(GL_PROJECTION_MATRIX, light_projection);
+
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+			gluLookAt(light_eye.x, light_eye.y, light_eye.z, center.x, center.y, center.z, 0.f, 1.f, 0.f);
+			PxReal light_view[16];
+			glGetFloatv(GL_MODELVIEW_MATRIX, light_view);
+
+			//maps world positions to shadow map coordinates in [0,1]
+			PxReal bias[] = { .5f,0.f,0.f,0.f, 0.f,.5f,0.f,0.f, 0.f,0.f,.5f,0.f, .5f,.5f,.5f,1.f };
+			shadow_matrix = PxMat44(bias) * PxMat44(light_projection) * PxMat44(light_view);
+
+			if (shadow_framebuffer)
+				GLExtensions::BindFramebuffer(GL_FRAMEBUFFER_EXT, shadow_framebuffer);
+
+			glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT);
+			glViewport(0, 0, size, size);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDisable(GL_LIGHTING);
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			if (shadow_quality == SHADOW_HIGH)
+				glPolygonOffset(1.1f, 2.f);
+			else
+				glPolygonOffset(2.f, 4.f);
+
+			//casters only need their silhouette, so use a coarser tessellation
+			int detail = render_detail;
+			render_detail = ShadowDetail();
+
+			//shadow commands sort first
+			for (PxU32 i = 0; (i < commands.size()) && (commands[i].Pass() == PASS_SHADOW); i++)
+			{
+				const RenderProxy& item = *commands[i].proxy;
+
+				glPushMatrix();
+				glMultMatrixf((float*)&item.world);
+				RenderGeometry(item.geometry);
+				glPopMatrix();
+
+				stats.shadow_casters++;
+			}
+
+			render_detail = detail;
+
+			if (shadow_framebuffer)
+			{
+				GLExtensions::BindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+			}
+			else
+			{
+				//no render-to-texture: grab the depth from the back buffer and clear it for the main pass
+				glBindTexture(GL_TEXTURE_2D, shadow_texture);
+				glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, size, size);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+
+			glPopAttrib();
+
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+		}
+
+		void BeginShadowReceivers()
+		{
+			//eye planes are transformed by the inverse of the current (camera) modelview,
+			//so the generated coordinates are world positions projected into the light frustum
+			const GLenum coords[] = { GL_S, GL_T, GL_R, GL_Q };
+			const GLenum gen[] = { GL_TEXTURE_GEN_S, GL_TEXTURE_GEN_T, GL_TEXTURE_GEN_R, GL_TEXTURE_GEN_Q };
+			const PxReal* m = shadow_matrix.front();
+
+			GLExtensions::ActiveTexture(GL_TEXTURE0);
+			for (int i = 0; i < 4; i++)
+			{
+				PxReal plane[] = { m[i], m[4+i], m[8+i], m[12+i] };
+				glTexGeni(coords[i], GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+				glTexGenfv(coords[i], GL_EYE_PLANE, plane);
+				glEnable(gen[i]);
+			}
+
+			//unit 0: depth comparison result (0 or 1) plus the ambient term
+			PxReal ambient[] = { 1.f-shadow_darkness, 1.f-shadow_darkness, 1.f-shadow_darkness, 1.f };
+			glBindTexture(GL_TEXTURE_2D, shadow_texture);
+			glEnable(GL_TEXTURE_2D);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+			glTexEnvfv(GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, ambient);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_ADD);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_CONSTANT);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PRIMARY_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+
+			//unit 1: modulate with the lit fragment colour
+			GLExtensions::ActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, white_texture);
+			glEnable(GL_TEXTURE_2D);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_MODULATE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_PRIMARY_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_RGB, GL_SRC_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_REPLACE);
+			glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PRIMARY_COLOR);
+			glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+
+			GLExtensions::ActiveTexture(GL_TEXTURE0);
+		}
+
+		void EndShadowReceivers()
+		{
+			GLExtensions::ActiveTexture(GL_TEXTURE1);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDisable(GL_TEXTURE_2D);
+
+			GLExtensions::ActiveTexture(GL_TEXTURE0);
+			glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDisable(GL_TEXTURE_2D);
+			glDisable(GL_TEXTURE_GEN_S);
+			glDisable(GL_TEXTURE_GEN_T);
+			glDisable(GL_TEXTURE_GEN_R);
+			glDisable(GL_TEXTURE_GEN_Q);
+		}
+
+		void Render(PxActor** actors, const PxU32 numActors)
+		{
+			actor_proxies.Clear();
+			for (PxU32 i = 0; i < numActors; i++)
+				actor_proxies.Add(actors[i]);
+
+			Render(actor_proxies);
+		}
+
+		PxU32 ColorKey(const PxVec3& color)
+		{
+			PxU32 r = (PxU32)(PxClamp(color.x, 0.f, 1.f)*255.f + .5f);
+			PxU32 g = (PxU32)(PxClamp(color.y, 0.f, 1.f)*255.f + .5f);
+			PxU32 b = (PxU32)(PxClamp(color.z, 0.f, 1.f)*255.f + .5f);
+			return (r << 16) | (g << 8) | b;
+		}
+
+		///Collect the draws of both passes and sort them by state
+		void BuildCommands(const RenderProxyStore& store, bool shadows)
+		{
+			commands.clear();
+			stats.state_changes_unsorted = 0;
+
+			bool lit = true;
+			PxVec3 color(-1.f);
+
+			for (PxU32 i = 0; i < store.Proxies().size(); i++)
+			{
+				const RenderProxy& item = store.Proxies()[i];
+				if (item.hidden)
 					continue;
+
+				PxGeometryType::Enum type = item.geometry.getType();
+				bool plane = (type == PxGeometryType::ePLANE);
+				const PxVec3& item_color = item.Color(default_color);
+
+				//planes are unlit and only receive shadows
+				PxU64 key = ((PxU64)type << 59) | ((PxU64)plane << 58) | ((PxU64)ColorKey(item_color) << 34) | i;
+
+				if (shadows && !plane)
+				{
+					DrawCommand command = { ((PxU64)PASS_SHADOW << 63) | key, &item };
+					commands.push_back(command);
 				}
 
-				if (actors[i]->isCloth())
+				DrawCommand command = { ((PxU64)PASS_MAIN << 63) | key, &item };
+				commands.push_back(command);
+
+				//what the main pass would cost in PhysX order
+				if (lit == plane)
 				{
-					RenderCloth((PxCloth*)actors[i]);
+					lit = !plane;
+					stats.state_changes_unsorted++;
 				}
-				else if (actors[i]->isRigidActor())
+				if (item_color != color)
 				{
-					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
-					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
-					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+					color = item_color;
+					stats.state_changes_unsorted++;
+				}
+			}
 
-					for(PxU32 j = 0; j < shapes.size(); j++)
-					{
-						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-						PxGeometryHolder h = shape->getGeometry();
-						//move the plane slightly down to avoid visual artefacts
-						if (h.getType() == PxGeometryType::ePLANE)
-						{
-							pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-							pose.p += PxVec3(0,-0.01,0);
-						}
-
-						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
-
-						PxVec3 shape_color = default_color;
-
-						if (shape->userData)
-						{
-							shape_color = *(((UserData*)shape->userData)->color);
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								shadow_color = shape_color*0.9;
-							}
-						}
-
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
-
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
-
-						RenderGeometry(h);
-
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
-
-						glPopMatrix();
-
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();						
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
-					}
+			std::sort(commands.begin(), commands.end());
+		}
+
+		void Render(const RenderProxyStore& store)
+		{
+			PROFILE_ZONE("Renderer::Render");
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			stats.shapes = 0;
+			stats.shadow_casters = 0;
+			stats.state_changes = 0;
+
+			bool shadows = show_shadows && shadows_supported;
+			BuildCommands(store, shadows);
+
+			std::chrono::high_resolution_clock::time_point shadow_start = std::chrono::high_resolution_clock::now();
+
+			if (shadows)
+				RenderShadowMap();
+
+			std::chrono::high_resolution_clock::time_point shadow_end = std::chrono::high_resolution_clock::now();
+
+			if (shadows && shadow_texture)
+				BeginShadowReceivers();
+
+			//only issue state that differs from the previous draw
+			bool lit = true;
+			PxVec3 color(-1.f);
+
+			for (PxU32 i = 0; i < commands.size(); i++)
+			{
+				if (commands[i].Pass() != PASS_MAIN)
+					continue;
+
+				const RenderProxy& item = *commands[i].proxy;
+				bool plane = (item.geometry.getType() == PxGeometryType::ePLANE);
+				const PxVec3& item_color = item.Color(default_color);
+
+				if (lit == plane)
+				{
+					lit = !plane;
+					if (lit)
+						glEnable(GL_LIGHTING);
+					else
+						glDisable(GL_LIGHTING);
+					stats.state_changes++;
 				}
 
+				if (item_color != color)
+				{
+					color = item_color;
+					glColor4f(color.x, color.y, color.z, 1.f);
+					stats.state_changes++;
+				}
+
+				// render object
+				glPushMatrix();
+				glMultMatrixf((float*)&item.world);
+				RenderGeometry(item.geometry);
+				glPopMatrix();
+
+				stats.shapes++;
 			}
+
+			if (!lit)
+				glEnable(GL_LIGHTING);
+
+			for (PxU32 i = 0; i < store.Cloths().size(); i++)
+				RenderCloth(store.Cloths()[i]);
+
+			if (shadows && shadow_texture)
+				EndShadowReceivers();
+
+			std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+			stats.shadow_map_size = shadows ? shadow_texture_size : 0;
+			stats.shadow_time = (float)std::chrono::duration_cast<std::chrono::microseconds>(shadow_end - shadow_start).count();
+			stats.render_time = (float)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
 		}
 
 		void Finish()
 		{
-			glutSwapBuffers();
+			PROFILE_ZONE("Renderer::Finish");
+			if (offscreen_width)
+				glFinish();
+			else
+				glutSwapBuffers();
 		}
 
 		void SetRenderDetail(int value)
@@ -388,126 +1208,78 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
-		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+		void SetShadowQuality(ShadowQuality value)
 		{
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(3,GL_FLOAT, 0, pVertList);
-			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, pColorList);
-			glDrawArrays(type, 0, num);
-			glDisableClientState(GL_COLOR_ARRAY);
-			glDisableClientState(GL_VERTEX_ARRAY);
+			shadow_quality = value;
+			//filtering is a texture parameter, recreate the map
+			shadow_texture_size = 0;
 		}
 
-		///Render PxRenderBuffer
-		///TODO: support text data
-		void Render(const PxRenderBuffer& data, PxReal line_width)
+		ShadowQuality GetShadowQuality() { return shadow_quality; }
+
+		void SetShadowResolution(PxU32 value)
 		{
-			glLineWidth(line_width);
+			shadow_resolution = value;
+		}
 
-			//render points
+		const Stats& GetStats() { return stats; }
 
-			unsigned int NbPoints = data.getNbPoints();
-			if(NbPoints)
-			{
-				std::vector<float> pVertList(NbPoints*3);
-				std::vector<float> pColorList(NbPoints*4);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const physx::PxDebugPoint* Points = data.getPoints();
-				while(NbPoints--)
-				{
-					pVertList[vertIndex++] = Points->pos.x;
-					pVertList[vertIndex++] = Points->pos.y;
-					pVertList[vertIndex++] = Points->pos.z;
-					pColorList[colorIndex++] = (float)((Points->color>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Points->color>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Points->color&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-					Points++;
-				}
+		///Debug vertex as laid out by PhysX: position followed by a packed colour
+		struct DebugVertex
+		{
+			PxVec3 pos;
+			PxU32 color;
+		};
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_POINTS, data.getNbPoints());
-			}
+		///Swizzled copies of the debug data for drivers that cannot read BGRA colours
+		std::vector<DebugVertex> debug_buffer;
 
-			//render lines
+		///Render debug vertices straight from PhysX memory (points, lines and triangles all have a 16 byte stride)
+		void RenderBuffer(const DebugVertex* vertices, int type, PxU32 num)
+		{
+			GLenum color_format = GL_BGRA;
 
-			unsigned int NbLines = data.getNbLines();
-			if(NbLines)
+			if (!GLExtensions::HasVertexArrayBGRA())
 			{
-				std::vector<float> pVertList(NbLines*3*2);
-				std::vector<float> pColorList(NbLines*4*2);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugLine* Lines = data.getLines();
-				while(NbLines--)
+				//0xAARRGGBB to RGBA byte order
+				if (debug_buffer.size() < num)
+					debug_buffer.resize(num);
+
+				for (PxU32 i = 0; i < num; i++)
 				{
-					pVertList[vertIndex++] = Lines->pos0.x;
-					pVertList[vertIndex++] = Lines->pos0.y;
-					pVertList[vertIndex++] = Lines->pos0.z;
-					pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pVertList[vertIndex++] = Lines->pos1.x;
-					pVertList[vertIndex++] = Lines->pos1.y;
-					pVertList[vertIndex++] = Lines->pos1.z;
-					pColorList[colorIndex++] = (float)((Lines->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Lines++;
+					PxU32 c = vertices[i].color;
+					debug_buffer[i].pos = vertices[i].pos;
+					debug_buffer[i].color = (c & 0xff00ff00) | ((c >> 16) & 0xff) | ((c & 0xff) << 16);
 				}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_LINES, data.getNbLines()*2);
+				vertices = &debug_buffer.front();
+				color_format = 4;
 			}
 
-			//render triangles
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(DebugVertex), &vertices->pos);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(color_format, GL_UNSIGNED_BYTE, sizeof(DebugVertex), &vertices->color);
+			glDrawArrays(type, 0, num);
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+		}
+
+		///Render PxRenderBuffer
+		///TODO: support text data
+		void Render(const PxRenderBuffer& data, PxReal line_width)
+		{
+			PROFILE_ZONE("Renderer::RenderDebug");
+			glLineWidth(line_width);
 
-			unsigned int NbTris = data.getNbTriangles();
-			if(NbTris)
-			{
-				std::vector<float> pVertList(NbTris*3*3);
-				std::vector<float> pColorList(NbTris*4*3);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugTriangle* Triangles = data.getTriangles();
-				while(NbTris--)
-				{
-					pVertList[vertIndex++] = Triangles->pos0.x;
-					pVertList[vertIndex++] = Triangles->pos0.y;
-					pVertList[vertIndex++] = Triangles->pos0.z;
-
-					pVertList[vertIndex++] = Triangles->pos1.x;
-					pVertList[vertIndex++] = Triangles->pos1.y;
-					pVertList[vertIndex++] = Triangles->pos1.z;
-
-					pVertList[vertIndex++] = Triangles->pos2.x;
-					pVertList[vertIndex++] = Triangles->pos2.y;
-					pVertList[vertIndex++] = Triangles->pos2.z;
-
-					pColorList[colorIndex++] = (float)((Triangles->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color2>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color2>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color2&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Triangles++;
-				}
+			if (data.getNbPoints())
+				RenderBuffer((const DebugVertex*)data.getPoints(), GL_POINTS, data.getNbPoints());
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_TRIANGLES, data.getNbTriangles()*3);
-			}
+			if (data.getNbLines())
+				RenderBuffer((const DebugVertex*)data.getLines(), GL_LINES, data.getNbLines()*2);
+
+			if (data.getNbTriangles())
+				RenderBuffer((const DebugVertex*)data.getTriangles(), GL_TRIANGLES, data.getNbTriangles()*3);
 
 			//TODO: render texts ?
 		}
@@ -516,8 +1288,65 @@ namespace VisualDebugger
 			const PxVec3& color, PxReal size)
 		{
 			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+			GLFontRenderer::setScreenResolution(WindowWidth(), WindowHeight());
 			GLFontRenderer::print(location.x, location.y, size, text.c_str());
 		}
+
+		void RenderGraph(const std::vector<PxReal>& values, const PxVec2& location, const PxVec2& size,
+			PxReal max_value, const PxVec3& color, const std::vector<PxReal>& marks)
+		{
+			if ((values.size() < 2) || (max_value <= 0.f))
+				return;
+
+			static std::vector<GLfloat> vertices;
+			vertices.clear();
+
+			//frame, marks, then the graph itself
+			GLfloat x0 = location.x, y0 = location.y, x1 = location.x + size.x, y1 = location.y + size.y;
+			GLfloat frame[] = { x0, y0, x1, y0, x1, y0, x1, y1, x1, y1, x0, y1, x0, y1, x0, y0 };
+			vertices.insert(vertices.end(), frame, frame + 16);
+			for (PxU32 i = 0; i < marks.size(); i++)
+			{
+				GLfloat y = y0 + size.y*PxMin(marks[i]/max_value, 1.f);
+				GLfloat mark[] = { x0, y, x1, y };
+				vertices.insert(vertices.end(), mark, mark + 4);
+			}
+			PxU32 nb_lines = (PxU32)vertices.size()/2;
+
+			for (PxU32 i = 0; i < values.size(); i++)
+			{
+				vertices.push_back(x0 + size.x*i/(values.size() - 1));
+				vertices.push_back(y0 + size.y*PxClamp(values[i]/max_value, 0.f, 1.f));
+			}
+
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(0, 1, 0, 1, -1, 1);
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+
+			glDisable(GL_DEPTH_TEST);
+			glDisable(GL_LIGHTING);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(2, GL_FLOAT, 0, &vertices.front());
+			//frame and marks faded towards the background
+			PxVec3 faded = color*0.4f + background_color*0.6f;
+			glColor4f(faded.x, faded.y, faded.z, 1.f);
+			glDrawArrays(GL_LINES, 0, nb_lines);
+			glColor4f(color.x, color.y, color.z, 1.f);
+			glDrawArrays(GL_LINE_STRIP, nb_lines, (GLsizei)values.size());
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glEnable(GL_LIGHTING);
+			glEnable(GL_DEPTH_TEST);
+
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+		}
 	}
 }
@@ -2,8 +2,10 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
+#include "RenderProxy.h"
 #include <GL/glut.h>
 #include <string>
+#include <vector>
 
 namespace VisualDebugger
 {
@@ -11,18 +13,65 @@ namespace VisualDebugger
 	{
 		using namespace physx;
 
+		///Shadow map quality presets
+		enum ShadowQuality
+		{
+			SHADOW_LOW,		//nearest depth comparison, coarse casters
+			SHADOW_MEDIUM,	//filtered depth comparison
+			SHADOW_HIGH		//filtered depth comparison, full detail casters and a tighter depth bias
+		};
+
+		///Rendering statistics of the last frame
+		struct Stats
+		{
+			//shapes drawn in the main pass
+			PxU32 shapes;
+			//shapes drawn into the shadow map
+			PxU32 shadow_casters;
+			//resolution of the shadow map in use (0 = no shadows)
+			PxU32 shadow_map_size;
+			//CPU time of the shadow pass [micro seconds]
+			float shadow_time;
+			//CPU time of the whole actor pass, shadows included [micro seconds]
+			float render_time;
+			//colour and lighting changes issued in the main pass
+			PxU32 state_changes;
+			//changes the same pass would need in PhysX order
+			PxU32 state_changes_unsorted;
+
+			Stats() : shapes(0), shadow_casters(0), shadow_map_size(0), shadow_time(0.f), render_time(0.f), state_changes(0), state_changes_unsorted(0) {}
+		};
+
 		///Init rendering window
 		void InitWindow(const char *name, int width, int height);
 
 		///Init renderer
 		void Init();
 
+		///Create an offscreen framebuffer instead of a window: a software OSMesa context with RENDER_OSMESA
+		///(the default outside of Windows), otherwise a window, which fails without a display
+		bool InitOffscreen(int width, int height);
+
+		///Size of the window or offscreen framebuffer
+		int WindowWidth();
+
+		int WindowHeight();
+
+		///Save the last rendered frame as an uncompressed TGA file
+		bool SaveFrame(const std::string& filename);
+
 		///Start rendering a single frame
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir);
 
+		///Axis aligned box around the current view frustum, cut off at a given distance
+		PxBounds3 ViewBounds(PxReal distance);
+
 		///Render actors
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Render shapes from a proxy store, without querying PhysX for rigid actors
+		void Render(const RenderProxyStore& store);
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
@@ -30,6 +79,11 @@ namespace VisualDebugger
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
 
+		///Render a line graph in screen space, location and size are in screen fractions.
+		///Values above max_value are clamped, marks are drawn as horizontal lines.
+		void RenderGraph(const std::vector<PxReal>& values, const PxVec2& location, const PxVec2& size,
+			PxReal max_value, const PxVec3& color, const std::vector<PxReal>& marks=std::vector<PxReal>());
+
 		///Set background color
 		void BackgroundColor(const PxVec3& background_color);
 
@@ -44,5 +98,17 @@ namespace VisualDebugger
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Set shadow map quality
+		void SetShadowQuality(ShadowQuality value);
+
+		///Get shadow map quality
+		ShadowQuality GetShadowQuality();
+
+		///Set the requested shadow map resolution (rounded down to a power of two)
+		void SetShadowResolution(PxU32 value);
+
+		///Get rendering statistics of the last frame
+		const Stats& GetStats();
 	}
 }
\ No newline at end of file
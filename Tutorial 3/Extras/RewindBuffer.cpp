@@ -0,0 +1,228 @@
+#include "RewindBuffer.h"
+#include "MatchRecording.h"
+#include <chrono>
+#include <string.h>
+
+namespace PhysicsEngine
+{
+	//id delta, three positions and a rotation at their longest
+	static const PxU32 MAX_POSE_SIZE = 5 + 3*5 + 4;
+
+	///7 bits per byte, the high bit marks that more follow
+	inline void PutNumber(PxU8*& p, PxU32 value)
+	{
+		while (value >= 0x80)
+		{
+			*p++ = (PxU8)(value | 0x80);
+			value >>= 7;
+		}
+		*p++ = (PxU8)value;
+	}
+
+	inline void PutSigned(PxU8*& p, PxI32 value)
+	{
+		PutNumber(p, ((PxU32)value << 1) ^ (PxU32)(value >> 31));
+	}
+
+	///The ring only holds what Record wrote, so there are no bounds to check
+	inline PxU32 GetNumber(const PxU8*& p)
+	{
+		PxU32 value = 0;
+		for (PxU32 shift = 0; ; shift += 7)
+		{
+			PxU8 c = *p++;
+			value |= (PxU32)(c & 0x7f) << shift;
+			if (!(c & 0x80))
+				return value;
+		}
+	}
+
+	inline PxI32 GetSigned(const PxU8*& p)
+	{
+		PxU32 value = GetNumber(p);
+		return (PxI32)(value >> 1) ^ -(PxI32)(value & 1);
+	}
+
+	RewindBuffer::RewindBuffer(PxU32 _frames, PxU32 bytes, PxU32 _keyframe_interval, PxU32 actors)
+		: ring(bytes), head(0), frames(_frames ? _frames : 1), first_frame(0), frame_count(0),
+		keyframe_interval(_keyframe_interval ? _keyframe_interval : 1), frames_since_keyframe(0),
+		current((PxU32)-1), current_actors(0), last_write(0.f), average_write(0.f)
+	{
+		tracked.reserve(actors);
+		positions.reserve(actors*3);
+		rotations.reserve(actors);
+	}
+
+	void RewindBuffer::Add(PxActor* actor)
+	{
+		if (!actor->isRigidDynamic())
+			return;
+
+		Tracked entry = { (PxRigidDynamic*)actor, { 0, 0, 0 }, 0, true };
+		tracked.push_back(entry);
+		positions.resize(tracked.size()*3);
+		rotations.resize(tracked.size());
+	}
+
+	void RewindBuffer::Clear()
+	{
+		//the actors of the history are gone with the old scene
+		tracked.clear();
+		positions.clear();
+		rotations.clear();
+		head = first_frame = frame_count = 0;
+		frames_since_keyframe = 0;
+		current = (PxU32)-1;
+		current_actors = 0;
+	}
+
+	void RewindBuffer::DropOldest()
+	{
+		//the frames up to the next keyframe cannot be decoded without it
+		do
+		{
+			first_frame = (first_frame + 1) % frames.size();
+			frame_count--;
+		} while (frame_count && !GetFrame(0).keyframe);
+	}
+
+	void RewindBuffer::Record()
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point start = Clock::now();
+
+		current = (PxU32)-1;
+
+		//a frame is written in one piece, with room for every actor
+		PxU32 size = (PxU32)tracked.size()*MAX_POSE_SIZE;
+		if (size > ring.size())
+		{
+			//more actors than the ring can hold, there is no history until the next Clear
+			frame_count = 0;
+			return;
+		}
+		if (head + size > ring.size())
+			head = 0;
+
+		//the oldest frame is the first one after the write position
+		while (frame_count)
+		{
+			const Frame& oldest = GetFrame(0);
+			bool overlaps = (oldest.offset >= head) && (oldest.offset < head + size);
+			if (!overlaps && (frame_count < frames.size()))
+				break;
+			DropOldest();
+		}
+
+		bool keyframe = !frame_count || (frames_since_keyframe + 1 >= keyframe_interval);
+
+		PxU8* begin = &ring.front() + head;
+		PxU8* p = begin;
+		PxU32 expected_id = 0;
+		for (PxU32 i = 0; i < tracked.size(); i++)
+		{
+			Tracked& entry = tracked[i];
+			PxRigidDynamic* actor = entry.actor;
+
+			//sleeping actors do not move, kinematic ones can be moved while asleep
+			if (!keyframe && !entry.dirty && actor->isSleeping() && !(actor->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC))
+				continue;
+
+			PxTransform pose = actor->getGlobalPose();
+			PxI32 position[3] = { QuantizePosition(pose.p.x), QuantizePosition(pose.p.y), QuantizePosition(pose.p.z) };
+			PxU32 rotation = PackRotation(pose.q);
+
+			if (!keyframe && !entry.dirty && (rotation == entry.rotation) &&
+				(position[0] == entry.position[0]) && (position[1] == entry.position[1]) && (position[2] == entry.position[2]))
+				continue;
+
+			PutNumber(p, i - expected_id);
+			expected_id = i + 1;
+			for (PxU32 j = 0; j < 3; j++)
+			{
+				PutSigned(p, keyframe ? position[j] : position[j] - entry.position[j]);
+				entry.position[j] = position[j];
+			}
+			memcpy(p, &rotation, sizeof(rotation));
+			p += sizeof(rotation);
+			entry.rotation = rotation;
+			entry.dirty = false;
+		}
+
+		Frame& frame = frames[(first_frame + frame_count) % frames.size()];
+		frame.offset = head;
+		frame.size = (PxU32)(p - begin);
+		frame.actors = (PxU32)tracked.size();
+		frame.keyframe = keyframe;
+		frame_count++;
+		head += frame.size;
+		frames_since_keyframe = keyframe ? 0 : frames_since_keyframe + 1;
+
+		last_write = std::chrono::duration<PxReal, std::micro>(Clock::now() - start).count();
+		average_write += (last_write - average_write)*0.05f;
+	}
+
+	void RewindBuffer::Decode(PxU32 index)
+	{
+		const Frame& frame = GetFrame(index);
+
+		//actors added since the last decoded frame start from the origin, their first position is relative to it
+		for (PxU32 i = frame.keyframe ? frame.actors : current_actors; i < frame.actors; i++)
+		{
+			positions[i*3] = positions[i*3+1] = positions[i*3+2] = 0;
+			rotations[i] = 0;
+		}
+
+		const PxU8* p = &ring.front() + frame.offset;
+		const PxU8* end = p + frame.size;
+		PxU32 id = 0;
+		while (p < end)
+		{
+			id += GetNumber(p);
+			PxI32* position = &positions[id*3];
+			for (PxU32 j = 0; j < 3; j++)
+				position[j] = frame.keyframe ? GetSigned(p) : position[j] + GetSigned(p);
+			memcpy(&rotations[id], p, sizeof(PxU32));
+			p += sizeof(PxU32);
+			id++;
+		}
+
+		current_actors = frame.actors;
+	}
+
+	void RewindBuffer::Seek(PxU32 index)
+	{
+		if (index >= frame_count || (index == current))
+			return;
+
+		PxU32 first = index;
+		if ((current == (PxU32)-1) || (index != current + 1))
+		{
+			while (!GetFrame(first).keyframe)
+				first--;
+		}
+
+		for (PxU32 i = first; i <= index; i++)
+			Decode(i);
+		current = index;
+	}
+
+	PxTransform RewindBuffer::Pose(PxU32 index) const
+	{
+		return PxTransform(DequantizePosition(&positions[index*3]), UnpackRotation(rotations[index]));
+	}
+
+	PxU32 RewindBuffer::BytesUsed() const
+	{
+		PxU32 bytes = 0;
+		for (PxU32 i = 0; i < frame_count; i++)
+			bytes += frames[(first_frame + i) % frames.size()].size;
+		return bytes;
+	}
+
+	size_t RewindBuffer::MemoryCeiling() const
+	{
+		return ring.size() + frames.size()*sizeof(Frame) +
+			tracked.capacity()*sizeof(Tracked) + positions.capacity()*sizeof(PxI32) + rotations.capacity()*sizeof(PxU32);
+	}
+}
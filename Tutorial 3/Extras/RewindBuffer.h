@@ -0,0 +1,99 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Rolling history of the poses of the dynamic actors of a scene, e.g. for instant replays.
+	///Frames are quantised and delta compressed as in MatchRecorder into a byte ring that is allocated once,
+	///the oldest keyframe and its frames are dropped when the ring or the frame index is full.
+	///Recording a step does not allocate, only Add can (beyond the reserved actor count).
+	class RewindBuffer
+	{
+		///A dynamic actor and the pose last written for it
+		struct Tracked
+		{
+			PxRigidDynamic* actor;
+			PxI32 position[3];
+			PxU32 rotation;
+			//not written since it was added
+			bool dirty;
+		};
+
+		///A recorded step in the ring
+		struct Frame
+		{
+			PxU32 offset, size;
+			//actors that existed at this step
+			PxU32 actors;
+			bool keyframe;
+		};
+
+		std::vector<Tracked> tracked;
+		std::vector<PxU8> ring;
+		//write position in the ring
+		PxU32 head;
+		//circular index of the frames in the ring, the oldest one is always a keyframe
+		std::vector<Frame> frames;
+		PxU32 first_frame, frame_count;
+		PxU32 keyframe_interval, frames_since_keyframe;
+
+		//poses of the frame of the last Seek
+		std::vector<PxI32> positions;
+		std::vector<PxU32> rotations;
+		PxU32 current, current_actors;
+
+		//time taken by Record [us]
+		PxReal last_write, average_write;
+
+		Frame& GetFrame(PxU32 index) { return frames[(first_frame + index) % frames.size()]; }
+
+		void DropOldest();
+
+		void Decode(PxU32 index);
+
+	public:
+		///frames - length of the history in steps, bytes - size of the ring,
+		///keyframe_interval - steps between frames that store every actor, bounds the cost of a seek,
+		///actors - actors reserved up front
+		RewindBuffer(PxU32 frames=600, PxU32 bytes=4 << 20, PxU32 keyframe_interval=30, PxU32 actors=2048);
+
+		///Start tracking an actor, see Scene::RecordRewind
+		void Add(PxActor* actor);
+
+		///Forget all actors and the history, the scene was reset
+		void Clear();
+
+		///Write the poses after a finished step
+		void Record();
+
+		///Steps in the history, the oldest one is 0
+		PxU32 FrameCount() const { return frame_count; }
+
+		///Decode the poses of a frame, from the last keyframe unless it is the next one.
+		///Recording invalidates the decoded frame.
+		void Seek(PxU32 index);
+
+		///Actors that existed in the frame of the last Seek
+		PxU32 ActorCount() const { return current_actors; }
+
+		PxRigidDynamic* GetActor(PxU32 index) const { return tracked[index].actor; }
+
+		///Pose of an actor in the frame of the last Seek
+		PxTransform Pose(PxU32 index) const;
+
+		///Bytes used by the frames in the ring
+		PxU32 BytesUsed() const;
+
+		///Memory the buffer can take up with its reserved actors
+		size_t MemoryCeiling() const;
+
+		///Time taken by the last Record and its running average [us]
+		PxReal LastWrite() const { return last_write; }
+
+		PxReal AverageWrite() const { return average_write; }
+	};
+}
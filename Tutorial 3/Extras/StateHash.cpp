@@ -0,0 +1,103 @@
+#include "StateHash.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STATE_HASH_SSE2 1
+#else
+#define STATE_HASH_SSE2 0
+#endif
+
+namespace PhysicsEngine
+{
+	static const PxU32 PRIME1 = 2654435761U;
+	static const PxU32 PRIME2 = 2246822519U;
+
+	inline PxU32 Rotl(PxU32 x, PxU32 r)
+	{
+		return (x << r) | (x >> (32 - r));
+	}
+
+#if STATE_HASH_SSE2
+	///32 bit multiply of every lane, SSE2 only has the 32x32->64 bit one
+	inline __m128i Mul32(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+	}
+#endif
+
+	StateHash::StateHash(PxU64 seed) : filled(0), length(0)
+	{
+		lanes[0] = (PxU32)seed + PRIME1 + PRIME2;
+		lanes[1] = (PxU32)seed + PRIME2;
+		lanes[2] = (PxU32)(seed >> 32);
+		lanes[3] = (PxU32)(seed >> 32) - PRIME1;
+	}
+
+	void StateHash::Block(const PxU32* words)
+	{
+		//four rounds of lane = rotl(lane + word*PRIME2, 13)*PRIME1, the same result with and without SSE
+#if STATE_HASH_SSE2
+		__m128i acc = _mm_loadu_si128((const __m128i*)lanes);
+		const __m128i prime1 = _mm_set1_epi32((int)PRIME1);
+		const __m128i prime2 = _mm_set1_epi32((int)PRIME2);
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			__m128i data = _mm_loadu_si128((const __m128i*)(words + i*4));
+			acc = _mm_add_epi32(acc, Mul32(data, prime2));
+			acc = _mm_or_si128(_mm_slli_epi32(acc, 13), _mm_srli_epi32(acc, 19));
+			acc = Mul32(acc, prime1);
+		}
+		_mm_storeu_si128((__m128i*)lanes, acc);
+#else
+		for (PxU32 i = 0; i < 4; i++)
+			for (PxU32 j = 0; j < 4; j++)
+				lanes[j] = Rotl(lanes[j] + words[i*4 + j]*PRIME2, 13)*PRIME1;
+#endif
+	}
+
+	void StateHash::Add(const void* data, PxU32 words)
+	{
+		const PxU32* input = (const PxU32*)data;
+		length += words;
+
+		//top up a partial block first
+		if (filled)
+		{
+			PxU32 count = PxMin(words, 16 - filled);
+			memcpy(block + filled, input, count*sizeof(PxU32));
+			filled += count;
+			input += count;
+			words -= count;
+			if (filled < 16)
+				return;
+			Block(block);
+			filled = 0;
+		}
+
+		for (; words >= 16; words -= 16, input += 16)
+			Block(input);
+
+		memcpy(block, input, words*sizeof(PxU32));
+		filled = words;
+	}
+
+	PxU64 StateHash::Value() const
+	{
+		PxU64 h = ((PxU64)(Rotl(lanes[0], 1) + Rotl(lanes[1], 7)) << 32) | (PxU32)(Rotl(lanes[2], 12) + Rotl(lanes[3], 18));
+		h ^= length*0x9E3779B97F4A7C15ULL;
+
+		for (PxU32 i = 0; i < filled; i++)
+		{
+			h = (h ^ block[i])*0x9E3779B97F4A7C15ULL;
+			h ^= h >> 29;
+		}
+
+		//final avalanche (splitmix64)
+		h = (h ^ (h >> 30))*0xBF58476D1CE4E5B9ULL;
+		h = (h ^ (h >> 27))*0x94D049BB133111EBULL;
+		return h ^ (h >> 31);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Hash of raw 32 bit words, processed in blocks of 16 with SSE2 where available.
+	///Floats are hashed by their bits, so runs only match if they are bitwise identical.
+	class StateHash
+	{
+		//four 32 bit lanes of the block hash
+		PxU32 lanes[4];
+		//words waiting for a full block
+		PxU32 block[16];
+		PxU32 filled;
+		PxU64 length;
+
+		void Block(const PxU32* words);
+
+	public:
+		StateHash(PxU64 seed=0);
+
+		void Add(const void* data, PxU32 words);
+
+		void Add(PxU32 value) { Add(&value, 1); }
+
+		void Add(PxReal value) { Add(&value, 1); }
+
+		void Add(bool value) { Add((PxU32)value); }
+
+		void Add(PxU64 value) { Add(&value, 2); }
+
+		void Add(const PxVec3& value) { Add(&value, 3); }
+
+		void Add(const PxTransform& value) { Add(&value, 7); }
+
+		///Hash of everything added so far, adding can continue afterwards
+		PxU64 Value() const;
+	};
+}
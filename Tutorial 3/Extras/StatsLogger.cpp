@@ -0,0 +1,191 @@
+#include "StatsLogger.h"
+#include "Profiler.h"
+#include <iostream>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const char* geometry_names[STATS_GEOMETRY_TYPES] = { "sphere", "plane", "capsule", "box", "convex", "mesh" };
+
+	StatsLogger::StatsLogger(size_t capacity)
+		: ring(capacity < 2 ? 2 : capacity), head(0), tail(0), stop(false), file(0), format(CSV), active(false),
+		steps_logged(0), steps_dropped(0)
+	{
+	}
+
+	StatsLogger::~StatsLogger()
+	{
+		Stop();
+	}
+
+	bool StatsLogger::Start(const string& filename, Format _format)
+	{
+		if (active)
+			return true;
+
+		format = _format;
+		file = fopen(filename.c_str(), format == BINARY ? "wb" : "w");
+		if (!file)
+		{
+			cerr << "StatsLogger: could not open " << filename << endl;
+			return false;
+		}
+
+		if (format == BINARY)
+		{
+			PxU32 header[3] = { 0x54535850, 1, sizeof(StepStatistics) };
+			fwrite(header, sizeof(header), 1, file);
+		}
+		else
+		{
+			fprintf(file, "step,gameplay_ms,simulate_ms,fetch_ms,active_dynamic,sleeping_dynamic,active_kinematic,statics,"
+				"active_constraints,axis_constraints,partitions,broadphase_adds,broadphase_removes,new_pairs,lost_pairs,"
+				"pairs_total,pairs_cache_hits,pairs_with_contacts,new_touches,lost_touches,ccd_pairs,trigger_pairs");
+			for (PxU32 i = 0; i < STATS_GEOMETRY_PAIRS; i++)
+				fprintf(file, ",%s", PairName(i).c_str());
+			fprintf(file, "\n");
+		}
+
+		head = tail = 0;
+		steps_logged = steps_dropped = 0;
+		stop = false;
+		active = true;
+		writer = thread(&StatsLogger::WriterLoop, this);
+		return true;
+	}
+
+	void StatsLogger::Stop()
+	{
+		if (!active)
+			return;
+
+		{
+			lock_guard<mutex> guard(lock);
+			stop = true;
+		}
+		wake.notify_one();
+		writer.join();
+
+		fclose(file);
+		file = 0;
+		active = false;
+	}
+
+	void StatsLogger::Record(PxU32 step, const PxSimulationStatistics& statistics, PxReal gameplay, PxReal simulate, PxReal fetch)
+	{
+		if (!active)
+			return;
+
+		StepStatistics record;
+		record.step = step;
+		record.gameplay = gameplay;
+		record.simulate = simulate;
+		record.fetch = fetch;
+
+		record.active_dynamic = statistics.nbActiveDynamicBodies;
+		record.sleeping_dynamic = statistics.nbDynamicBodies - statistics.nbActiveDynamicBodies;
+		record.active_kinematic = statistics.nbActiveKinematicBodies;
+		record.statics = statistics.nbStaticBodies;
+
+		record.active_constraints = statistics.nbActiveConstraints;
+		record.axis_constraints = statistics.nbAxisSolverConstraints;
+		record.partitions = statistics.nbPartitions;
+
+		record.broadphase_adds = statistics.getNbBroadPhaseAdds(PxSimulationStatistics::eRIGID_BODY) + statistics.getNbBroadPhaseAdds(PxSimulationStatistics::eCLOTH);
+		record.broadphase_removes = statistics.getNbBroadPhaseRemoves(PxSimulationStatistics::eRIGID_BODY) + statistics.getNbBroadPhaseRemoves(PxSimulationStatistics::eCLOTH);
+		record.new_pairs = statistics.nbNewPairs;
+		record.lost_pairs = statistics.nbLostPairs;
+
+		record.pairs_total = statistics.nbDiscreteContactPairsTotal;
+		record.pairs_cache_hits = statistics.nbDiscreteContactPairsWithCacheHits;
+		record.pairs_with_contacts = statistics.nbDiscreteContactPairsWithContacts;
+		record.new_touches = statistics.nbNewTouches;
+		record.lost_touches = statistics.nbLostTouches;
+
+		record.ccd_pairs = 0;
+		record.trigger_pairs = 0;
+		PxU32 pair = 0;
+		for (PxU32 i = 0; i < STATS_GEOMETRY_TYPES; i++)
+		{
+			for (PxU32 j = i; j < STATS_GEOMETRY_TYPES; j++, pair++)
+			{
+				PxGeometryType::Enum type0 = (PxGeometryType::Enum)i, type1 = (PxGeometryType::Enum)j;
+				record.pairs[pair] = statistics.getRbPairStats(PxSimulationStatistics::eDISCRETE_CONTACT_PAIRS, type0, type1);
+				record.ccd_pairs += statistics.getRbPairStats(PxSimulationStatistics::eCCD_PAIRS, type0, type1);
+				record.trigger_pairs += statistics.getRbPairStats(PxSimulationStatistics::eTRIGGER_PAIRS, type0, type1);
+			}
+		}
+
+		{
+			lock_guard<mutex> guard(lock);
+			size_t next = (head + 1) % ring.size();
+			//the disk cannot keep up, skip this step
+			if (next == tail)
+			{
+				steps_dropped++;
+				return;
+			}
+			ring[head] = record;
+			head = next;
+		}
+		wake.notify_one();
+	}
+
+	void StatsLogger::WriterLoop()
+	{
+		Profiler::ThreadName("StatsLogger writer");
+
+		unique_lock<mutex> guard(lock);
+		while (true)
+		{
+			wake.wait(guard, [this] { return stop || (head != tail); });
+			if (head == tail)
+				break;
+
+			//only the writer moves the tail, the records behind it stay put
+			size_t end = head;
+			guard.unlock();
+			{
+				PROFILE_ZONE("StatsLogger::Write");
+				for (size_t i = tail; i != end; i = (i + 1) % ring.size())
+					Write(ring[i]);
+				fflush(file);
+			}
+			guard.lock();
+
+			steps_logged += (PxU32)((end + ring.size() - tail) % ring.size());
+			tail = end;
+		}
+	}
+
+	void StatsLogger::Write(const StepStatistics& r)
+	{
+		if (format == BINARY)
+		{
+			fwrite(&r, sizeof(r), 1, file);
+			return;
+		}
+
+		fprintf(file, "%u,%.4f,%.4f,%.4f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u",
+			r.step, r.gameplay, r.simulate, r.fetch, r.active_dynamic, r.sleeping_dynamic, r.active_kinematic, r.statics,
+			r.active_constraints, r.axis_constraints, r.partitions, r.broadphase_adds, r.broadphase_removes, r.new_pairs, r.lost_pairs,
+			r.pairs_total, r.pairs_cache_hits, r.pairs_with_contacts, r.new_touches, r.lost_touches, r.ccd_pairs, r.trigger_pairs);
+		for (PxU32 i = 0; i < STATS_GEOMETRY_PAIRS; i++)
+			fprintf(file, ",%u", r.pairs[i]);
+		fprintf(file, "\n");
+	}
+
+	string StatsLogger::PairName(PxU32 index)
+	{
+		for (PxU32 i = 0; i < STATS_GEOMETRY_TYPES; i++)
+		{
+			for (PxU32 j = i; j < STATS_GEOMETRY_TYPES; j++)
+			{
+				if (index-- == 0)
+					return string(geometry_names[i]) + "_" + geometry_names[j];
+			}
+		}
+		return "";
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Geometry types counted in the per pair statistics (height fields are not used by the game)
+	static const PxU32 STATS_GEOMETRY_TYPES = 6;
+	//pairs of the types above, order does not matter
+	static const PxU32 STATS_GEOMETRY_PAIRS = STATS_GEOMETRY_TYPES*(STATS_GEOMETRY_TYPES+1)/2;
+
+	///Statistics of a single simulation step, written as is by the binary format
+	struct StepStatistics
+	{
+		PxU32 step;
+		//timings of the step [ms]
+		PxReal gameplay, simulate, fetch;
+		//bodies
+		PxU32 active_dynamic, sleeping_dynamic, active_kinematic, statics;
+		//solver
+		PxU32 active_constraints, axis_constraints, partitions;
+		//broadphase
+		PxU32 broadphase_adds, broadphase_removes, new_pairs, lost_pairs;
+		//narrowphase
+		PxU32 pairs_total, pairs_cache_hits, pairs_with_contacts, new_touches, lost_touches;
+		PxU32 ccd_pairs, trigger_pairs;
+		//discrete contact pairs per geometry type pair, see StatsLogger::PairName
+		PxU32 pairs[STATS_GEOMETRY_PAIRS];
+	};
+
+	///Logs the statistics of every simulation step.
+	///Records go into a preallocated ring and a background thread writes them to disk.
+	class StatsLogger
+	{
+	public:
+		enum Format
+		{
+			CSV,	//one line per step with a header
+			BINARY	//"PXST", version, record size, then raw StepStatistics records
+		};
+
+	private:
+		std::vector<StepStatistics> ring;
+		//written by Record, read by the writer thread
+		size_t head, tail;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::thread writer;
+		bool stop;
+
+		FILE* file;
+		Format format;
+		bool active;
+		PxU32 steps_logged, steps_dropped;
+
+		void WriterLoop();
+		void Write(const StepStatistics& record);
+
+	public:
+		///capacity - steps waiting for the disk before new ones are dropped
+		StatsLogger(size_t capacity=4096);
+
+		~StatsLogger();
+
+		///Start logging into a new file
+		bool Start(const std::string& filename, Format format=CSV);
+
+		///Stop logging, waits for all steps to be written
+		void Stop();
+
+		bool Active() const { return active; }
+
+		///Add the statistics of a step
+		void Record(PxU32 step, const PxSimulationStatistics& statistics, PxReal gameplay, PxReal simulate, PxReal fetch);
+
+		PxU32 StepsLogged() const { return steps_logged; }
+
+		PxU32 StepsDropped() const { return steps_dropped; }
+
+		///Name of an entry of StepStatistics::pairs, e.g. "sphere_box"
+		static std::string PairName(PxU32 index);
+	};
+}
@@ -0,0 +1,256 @@
+#include "TrackingAllocator.h"
+#include "MemoryPools.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const char* tag_names[MEMORY_TAG_COUNT] = { "sdk", "scene", "actors", "userdata", "cloth", "hud" };
+
+	//the SDK expects 16 byte aligned memory
+	static const size_t ALIGNMENT = 16;
+
+	///Stored in front of every SDK allocation
+	struct AllocationHeader
+	{
+		void* raw;
+		PxU32 size;
+		PxU16 type;
+		PxU8 tag;
+		//size class of the block, NO_POOL for the heap
+		PxU8 pool;
+	};
+
+	static const PxU8 NO_POOL = 0xff;
+
+	//entry of the type table for the names that do not fit into it
+	static const PxU16 OTHER_TYPE = 0;
+
+	static_assert(sizeof(AllocationHeader) <= ALIGNMENT, "the allocation header has to fit into the alignment");
+
+	thread_local MemoryTag current_tag = MEMORY_SDK;
+
+	//type indices the calling thread has seen, so only new names take the lock of the type table
+	thread_local map<string, PxU16, less<>> thread_type_index;
+
+	void MemoryStats::Add(size_t bytes)
+	{
+		live_bytes += bytes;
+		peak_bytes = max(peak_bytes, live_bytes);
+		live_count++;
+		allocations++;
+	}
+
+	void MemoryStats::Remove(size_t bytes)
+	{
+		live_bytes -= bytes;
+		live_count--;
+	}
+
+	void AtomicMemoryStats::Add(size_t bytes)
+	{
+		size_t live = live_bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+		size_t peak = peak_bytes.load(memory_order_relaxed);
+		while ((live > peak) && !peak_bytes.compare_exchange_weak(peak, live, memory_order_relaxed))
+			;
+		live_count.fetch_add(1, memory_order_relaxed);
+		allocations.fetch_add(1, memory_order_relaxed);
+	}
+
+	void AtomicMemoryStats::Remove(size_t bytes)
+	{
+		live_bytes.fetch_sub(bytes, memory_order_relaxed);
+		live_count.fetch_sub(1, memory_order_relaxed);
+	}
+
+	MemoryStats AtomicMemoryStats::Read(const string& name) const
+	{
+		MemoryStats stats(name);
+		stats.live_bytes = live_bytes.load(memory_order_relaxed);
+		stats.peak_bytes = peak_bytes.load(memory_order_relaxed);
+		stats.live_count = live_count.load(memory_order_relaxed);
+		stats.allocations = allocations.load(memory_order_relaxed);
+		return stats;
+	}
+
+	TrackingAllocator::TrackingAllocator() : pools(0)
+	{
+		for (PxU32 i = 0; i < 0x10000 / TYPE_CHUNK; i++)
+			type_chunks[i] = 0;
+		type_chunks[0] = new AtomicMemoryStats[TYPE_CHUNK];
+		type_names.push_back("other");
+	}
+
+	void TrackingAllocator::Backend(MemoryBackend backend)
+	{
+		//blocks that are still allocated would be freed to the wrong place
+		if (total.live_bytes.load() || (backend == Backend()))
+			return;
+
+		delete pools;
+		pools = (backend == MEMORY_POOLS) ? new PoolAllocator() : 0;
+	}
+
+	PxU16 TrackingAllocator::TypeIndex(const char* type_name)
+	{
+		if (!type_name)
+			type_name = "unknown";
+
+		map<string, PxU16, less<>>::iterator cached = thread_type_index.find(type_name);
+		if (cached != thread_type_index.end())
+			return cached->second;
+
+		lock_guard<mutex> guard(lock);
+		PxU16 index;
+		map<string, PxU16, less<>>::iterator it = type_index.find(type_name);
+		if (it != type_index.end())
+			index = it->second;
+		//header->type is 16 bits
+		else if (type_names.size() >= 0xffff)
+			return OTHER_TYPE;
+		else
+		{
+			index = (PxU16)type_names.size();
+			if (!type_chunks[index / TYPE_CHUNK])
+				type_chunks[index / TYPE_CHUNK] = new AtomicMemoryStats[TYPE_CHUNK];
+			type_names.push_back(type_name);
+			type_index[type_name] = index;
+		}
+
+		thread_type_index[type_name] = index;
+		return index;
+	}
+
+	void* TrackingAllocator::allocate(size_t size, const char* type_name, const char* filename, int line)
+	{
+		//pool blocks are aligned already, heap memory needs room to align
+		PxU8 pool = NO_POOL;
+		char* raw = pools ? (char*)pools->Allocate(size + ALIGNMENT, pool) : 0;
+		char* memory;
+		if (raw)
+			memory = raw + ALIGNMENT;
+		else
+		{
+			pool = NO_POOL;
+			raw = (char*)malloc(size + 2*ALIGNMENT);
+			if (!raw)
+				return 0;
+			memory = (char*)(((size_t)raw + 2*ALIGNMENT) & ~(ALIGNMENT-1));
+		}
+
+		AllocationHeader* header = (AllocationHeader*)(memory - ALIGNMENT);
+		header->raw = raw;
+		header->pool = pool;
+		header->size = (PxU32)size;
+		header->tag = (PxU8)current_tag;
+
+		header->type = TypeIndex(type_name);
+		total.Add(size);
+		tags[header->tag].Add(size);
+		TypeStats(header->type).Add(size);
+		return memory;
+	}
+
+	void TrackingAllocator::deallocate(void* memory)
+	{
+		if (!memory)
+			return;
+
+		AllocationHeader* header = (AllocationHeader*)((char*)memory - ALIGNMENT);
+		total.Remove(header->size);
+		tags[header->tag].Remove(header->size);
+		TypeStats(header->type).Remove(header->size);
+		if (header->pool == NO_POOL)
+			free(header->raw);
+		else
+			pools->Free(header->raw, header->pool);
+	}
+
+	void TrackingAllocator::Track(MemoryTag tag, size_t bytes)
+	{
+		total.Add(bytes);
+		tags[tag].Add(bytes);
+	}
+
+	void TrackingAllocator::Untrack(MemoryTag tag, size_t bytes)
+	{
+		total.Remove(bytes);
+		tags[tag].Remove(bytes);
+	}
+
+	MemoryStats TrackingAllocator::Total()
+	{
+		return total.Read("total");
+	}
+
+	MemoryStats TrackingAllocator::Tag(MemoryTag tag)
+	{
+		return tags[tag].Read(tag_names[tag]);
+	}
+
+	vector<MemoryStats> TrackingAllocator::Types()
+	{
+		lock_guard<mutex> guard(lock);
+		vector<MemoryStats> stats;
+		stats.reserve(type_names.size());
+		for (size_t i = 0; i < type_names.size(); i++)
+			stats.push_back(TypeStats((PxU16)i).Read(type_names[i]));
+		return stats;
+	}
+
+	bool TrackingAllocator::Dump(const string& filename)
+	{
+		FILE* file = fopen(filename.c_str(), "w");
+		if (!file)
+			return false;
+
+		vector<MemoryStats> type_stats = Types();
+		sort(type_stats.begin(), type_stats.end(), [](const MemoryStats& a, const MemoryStats& b) { return a.live_bytes > b.live_bytes; });
+
+		MemoryStats all = Total();
+		fprintf(file, "kind,name,live_bytes,peak_bytes,live_count,allocations\n");
+		fprintf(file, "total,%s,%zu,%zu,%llu,%llu\n", all.name.c_str(), all.live_bytes, all.peak_bytes,
+			(unsigned long long)all.live_count, (unsigned long long)all.allocations);
+		for (int i = 0; i < MEMORY_TAG_COUNT; i++)
+		{
+			MemoryStats t = Tag((MemoryTag)i);
+			fprintf(file, "tag,%s,%zu,%zu,%llu,%llu\n", t.name.c_str(), t.live_bytes, t.peak_bytes,
+				(unsigned long long)t.live_count, (unsigned long long)t.allocations);
+		}
+		for (size_t i = 0; i < type_stats.size(); i++)
+		{
+			const MemoryStats& t = type_stats[i];
+			//type names can contain commas (templates)
+			fprintf(file, "type,\"%s\",%zu,%zu,%llu,%llu\n", t.name.c_str(), t.live_bytes, t.peak_bytes,
+				(unsigned long long)t.live_count, (unsigned long long)t.allocations);
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	const char* TrackingAllocator::TagName(MemoryTag tag)
+	{
+		return (tag < MEMORY_TAG_COUNT) ? tag_names[tag] : "";
+	}
+
+	TrackingAllocator& GetTrackingAllocator()
+	{
+		//never destroyed, the SDK may free memory during the static destruction
+		static TrackingAllocator* allocator = new TrackingAllocator();
+		return *allocator;
+	}
+
+	MemoryScope::MemoryScope(MemoryTag tag) : previous(current_tag)
+	{
+		current_tag = tag;
+	}
+
+	MemoryScope::~MemoryScope()
+	{
+		current_tag = previous;
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Game subsystems memory is attributed to
+	enum MemoryTag
+	{
+		MEMORY_SDK,			//SDK allocations outside of any MemoryScope
+		MEMORY_SCENE,
+		MEMORY_ACTORS,
+		MEMORY_USERDATA,
+		MEMORY_CLOTH,
+		MEMORY_HUD,
+		MEMORY_TAG_COUNT
+	};
+
+	///Where the memory of the SDK and the wrapper objects comes from
+	enum MemoryBackend
+	{
+		MEMORY_HEAP,	//malloc for the SDK, operator new for the wrappers
+		MEMORY_POOLS	//size class pools for small SDK allocations, an arena per scene for the wrappers
+	};
+
+	class PoolAllocator;
+
+	///Allocation counts and sizes of a type or tag [bytes]
+	struct MemoryStats
+	{
+		std::string name;
+		size_t live_bytes, peak_bytes;
+		PxU64 live_count, allocations;
+
+		MemoryStats(const std::string& _name="") : name(_name), live_bytes(0), peak_bytes(0), live_count(0), allocations(0) {}
+
+		void Add(size_t bytes);
+		void Remove(size_t bytes);
+	};
+
+	///MemoryStats updated by several threads without a lock
+	struct AtomicMemoryStats
+	{
+		std::atomic<size_t> live_bytes, peak_bytes;
+		std::atomic<PxU64> live_count, allocations;
+
+		AtomicMemoryStats() : live_bytes(0), peak_bytes(0), live_count(0), allocations(0) {}
+
+		void Add(size_t bytes);
+		void Remove(size_t bytes);
+
+		///Copy of the counters, not a consistent snapshot while other threads allocate
+		MemoryStats Read(const std::string& name) const;
+	};
+
+	///Allocator callback of the SDK that keeps statistics per allocation type and per game subsystem.
+	///SDK allocations are attributed to the tag of the innermost MemoryScope on the calling thread,
+	///game side allocations are reported with Track/Untrack.
+	class TrackingAllocator : public PxAllocatorCallback
+	{
+		//the counters are atomic, the SDK worker threads allocate without taking a lock
+		AtomicMemoryStats total;
+		AtomicMemoryStats tags[MEMORY_TAG_COUNT];
+		//per type name in chunks that never move, so a type added by one thread does not block the others
+		static const PxU32 TYPE_CHUNK = 256;
+		AtomicMemoryStats* type_chunks[0x10000 / TYPE_CHUNK];
+		//guards the type table below, taken only for a name the calling thread has not seen yet
+		std::mutex lock;
+		std::vector<std::string> type_names;
+		//by name, not by pointer, a dynamic string can reuse the address of another name;
+		//less<> finds a const char* without building a string
+		std::map<std::string, PxU16, std::less<>> type_index;
+		//0 = heap only
+		PoolAllocator* pools;
+
+		AtomicMemoryStats& TypeStats(PxU16 index) { return type_chunks[index / TYPE_CHUNK][index % TYPE_CHUNK]; }
+
+		///Index of a type name in the type table, entry 0 takes the names that no longer fit into it
+		PxU16 TypeIndex(const char* type_name);
+
+	public:
+		TrackingAllocator();
+
+		///Select the backend, before the first allocation
+		void Backend(MemoryBackend backend);
+
+		MemoryBackend Backend() const { return pools ? MEMORY_POOLS : MEMORY_HEAP; }
+
+		//PxAllocatorCallback
+		virtual void* allocate(size_t size, const char* type_name, const char* filename, int line);
+		virtual void deallocate(void* memory);
+
+		///Report a game side allocation
+		void Track(MemoryTag tag, size_t bytes);
+
+		///Report the release of a game side allocation
+		void Untrack(MemoryTag tag, size_t bytes);
+
+		///SDK and game allocations together
+		MemoryStats Total();
+
+		MemoryStats Tag(MemoryTag tag);
+
+		///SDK allocations per type name
+		std::vector<MemoryStats> Types();
+
+		///Write the totals, tags and types sorted by live bytes as CSV
+		bool Dump(const std::string& filename);
+
+		static const char* TagName(MemoryTag tag);
+	};
+
+	///The allocator passed to the SDK foundation
+	TrackingAllocator& GetTrackingAllocator();
+
+	///Attribute the SDK allocations of the calling thread to a tag for the lifetime of the object
+	class MemoryScope
+	{
+		MemoryTag previous;
+
+	public:
+		MemoryScope(MemoryTag tag);
+
+		~MemoryScope();
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PxPhysicsAPI.h"
+#include "MemoryPools.h"
 
 //add here any other structures that you want to pass from your simulation to the renderer
 class UserData
@@ -11,4 +12,15 @@ public:
 
 	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
 		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
+
+	//counted by the memory tracker, kept in the scene arena with the pool backend
+	static void* operator new(size_t size)
+	{
+		return PhysicsEngine::ArenaNew(size, PhysicsEngine::MEMORY_USERDATA);
+	}
+
+	static void operator delete(void* memory)
+	{
+		PhysicsEngine::ArenaDelete(memory);
+	}
 };
\ No newline at end of file
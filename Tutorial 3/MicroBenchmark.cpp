@@ -0,0 +1,292 @@
+#include "MicroBenchmark.h"
+#include "MyPhysicsEngine.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <stdlib.h>
+
+//built into its own executable (Micro Benchmark.vcxproj), the game keeps the allocator of the CRT
+
+///Heap allocations made through operator new, counted for the whole benchmark
+static std::atomic<unsigned long long> allocation_count(0);
+
+void* operator new(size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	///Objects shared by the benchmarks
+	struct MicroContext
+	{
+		MyScene* scene;
+		//a ball spawned like the game does, for the wrapper calls
+		compoundRugbyBall* ball;
+		//results are summed here so the calls are not optimised away
+		size_t sink;
+	};
+
+	///A named benchmark: run makes n calls, cleanup undoes them outside of the timed part
+	struct MicroBench
+	{
+		const char* name;
+		void (*run)(MicroContext& context, PxU32 n);
+		void (*cleanup)(MicroContext& context);
+		//iterations are divided by this for slow benchmarks
+		PxU32 divisor;
+	};
+
+	void NoCleanup(MicroContext& context) {}
+
+	///Spawn the ball of the wrapper benchmarks into the current scene, see MyScene::spawnBalls
+	void SpawnBall(MicroContext& context)
+	{
+		context.ball = new compoundRugbyBall(PxTransform(PxVec3(0.f, 20.f, -10.f)));
+		context.scene->Add(context.ball);
+	}
+
+	void GetShapeBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.sink += (size_t)context.ball->GetShape(i & 3);
+	}
+
+	void GetShapesBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.sink += context.ball->GetShapes().size();
+	}
+
+	void SetColorBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.ball->Color(PxVec3((PxReal)(i & 1), 0.f, 0.f));
+	}
+
+	void GetColorBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.sink += (size_t)context.ball->Color(i & 3);
+	}
+
+	void MaterialBench(MicroContext& context, PxU32 n)
+	{
+		PxMaterial* material = GetMaterial();
+		for (PxU32 i = 0; i < n; i++)
+			context.ball->Material(material);
+	}
+
+	void SetupFilteringBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.ball->SetupFiltering(FilterGroup::ACTOR0, i & FilterGroup::ACTOR1);
+	}
+
+	void SetTriggerBench(MicroContext& context, PxU32 n)
+	{
+		//only one direction, turning a trigger back into a simulation shape is rejected by the SDK,
+		//so the cleanup replaces the ball for the benchmarks after this one
+		for (PxU32 i = 0; i < n; i++)
+			context.ball->SetTrigger(true);
+	}
+
+	void GetMaterialBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.sink += (size_t)GetMaterial();
+	}
+
+	void GetAllActorsBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.sink += context.scene->GetAllActors().size();
+	}
+
+	void SelectNextActorBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.scene->SelectNextActor();
+	}
+
+	//the constructor benchmarks spawn like the game: into the arena of the scene and added to it,
+	//they are released with the scene by Reset (ResetScene)
+	template<class T> void SpawnBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.scene->Add(new T(PxTransform(PxVec3(0.f, 5.f, 0.f))));
+	}
+
+	void SpawnBurstBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.scene->spawn100Balls();
+	}
+
+	void ResetBench(MicroContext& context, PxU32 n)
+	{
+		for (PxU32 i = 0; i < n; i++)
+			context.scene->Reset();
+	}
+
+	void ResetScene(MicroContext& context)
+	{
+		context.scene->Reset();
+		SpawnBall(context);
+	}
+
+	const MicroBench benchmarks[] =
+	{
+		{ "Actor::GetShape", GetShapeBench, NoCleanup, 1 },
+		{ "Actor::GetShapes", GetShapesBench, NoCleanup, 1 },
+		{ "Actor::Color(set)", SetColorBench, NoCleanup, 1 },
+		{ "Actor::Color(get)", GetColorBench, NoCleanup, 1 },
+		{ "Actor::Material", MaterialBench, NoCleanup, 1 },
+		{ "Actor::SetupFiltering", SetupFilteringBench, NoCleanup, 1 },
+		{ "Actor::SetTrigger", SetTriggerBench, ResetScene, 1 },
+		{ "GetMaterial", GetMaterialBench, NoCleanup, 1 },
+		{ "Scene::GetAllActors", GetAllActorsBench, NoCleanup, 10 },
+		{ "Scene::SelectNextActor", SelectNextActorBench, NoCleanup, 10 },
+		{ "compoundRugbyBall()", SpawnBench<compoundRugbyBall>, ResetScene, 100 },
+		{ "CompoundJoust()", SpawnBench<CompoundJoust>, ResetScene, 100 },
+		{ "CompoundWall()", SpawnBench<CompoundWall>, ResetScene, 100 },
+		{ "CompoundGun()", SpawnBench<CompoundGun>, ResetScene, 100 },
+		{ "spawn100Balls", SpawnBurstBench, ResetScene, 10000 },
+		{ "Scene::Reset", ResetBench, ResetScene, 10000 },
+	};
+
+	///Result of the fastest run of a benchmark
+	struct MicroResult
+	{
+		PxU32 ops;
+		double ns_per_op, allocations_per_op;
+	};
+
+	MicroResult RunMicroBench(MicroContext& context, const MicroBench& bench, const MicroBenchmarkSettings& settings)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		MicroResult result;
+		result.ops = settings.iterations/bench.divisor ? settings.iterations/bench.divisor : 1;
+		result.ns_per_op = 0.;
+		result.allocations_per_op = 0.;
+
+		//warm up caches and the SDK pools once
+		bench.run(context, result.ops < 100 ? result.ops : 100);
+		bench.cleanup(context);
+
+		for (PxU32 r = 0; r < settings.repeats; r++)
+		{
+			unsigned long long allocations = allocation_count.load(std::memory_order_relaxed);
+			Clock::time_point start = Clock::now();
+			bench.run(context, result.ops);
+			double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count()/result.ops;
+			allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+
+			bench.cleanup(context);
+
+			if ((r == 0) || (ns < result.ns_per_op))
+				result.ns_per_op = ns;
+			//allocations do not depend on timing, every run counts the same
+			result.allocations_per_op = (double)allocations/result.ops;
+		}
+		return result;
+	}
+
+	int MicroBenchmark(const MicroBenchmarkSettings& settings)
+	{
+		MicroContext context;
+		context.sink = 0;
+
+		try
+		{
+			PxInit(settings.backend);
+			context.scene = new MyScene();
+			context.scene->Init();
+			SpawnBall(context);
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		cout << "Micro benchmark, " << (settings.backend == MEMORY_POOLS ? "pool" : "heap") << " backend, "
+			<< settings.iterations << " iterations, best of " << settings.repeats << ", "
+			<< context.scene->GetAllActors().size() << " actors in the scene" << endl;
+		cout << left << setw(26) << "benchmark" << right << setw(10) << "ops" << setw(12) << "ns/op" << setw(12) << "allocs/op" << endl;
+
+		PxU32 count = 0;
+		for (size_t i = 0; i < sizeof(benchmarks)/sizeof(benchmarks[0]); i++)
+		{
+			if (settings.filter.size() && (string(benchmarks[i].name).find(settings.filter) == string::npos))
+				continue;
+
+			MicroResult r = RunMicroBench(context, benchmarks[i], settings);
+			count++;
+
+			cout << left << setw(26) << benchmarks[i].name << right << setw(10) << r.ops << fixed << setprecision(1)
+				<< setw(12) << r.ns_per_op << setprecision(2) << setw(12) << r.allocations_per_op << endl;
+		}
+
+		delete context.scene;
+		PxRelease();
+
+		if (!count)
+		{
+			cerr << "MicroBenchmark: no benchmark matches " << settings.filter << endl;
+			return 1;
+		}
+
+		//printed so the sink is used
+		cout << "(checksum " << (context.sink & 0xffff) << ")" << endl;
+		return 0;
+	}
+}
+
+///Parse a --memory option
+PhysicsEngine::MemoryBackend MemoryBackend(const std::string& value)
+{
+	if (value == "pools")
+		return PhysicsEngine::MEMORY_POOLS;
+	if (value != "heap")
+		std::cerr << "Unknown memory backend " << value << ", using heap" << std::endl;
+	return PhysicsEngine::MEMORY_HEAP;
+}
+
+//wrapper micro benchmarks: [--filter text] [--iterations N] [--repeats N] [--memory heap|pools]
+int main(int argc, char* argv[])
+{
+	PhysicsEngine::MicroBenchmarkSettings settings;
+	for (int i = 1; i+1 < argc; i+=2)
+	{
+		std::string option = argv[i];
+		if (option == "--filter")
+			settings.filter = argv[i+1];
+		else if (option == "--iterations")
+			settings.iterations = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+		else if (option == "--repeats")
+			settings.repeats = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+		else if (option == "--memory")
+			settings.backend = MemoryBackend(argv[i+1]);
+		else
+			std::cerr << "Unknown option " << option << std::endl;
+	}
+	return PhysicsEngine::MicroBenchmark(settings);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+#include "Extras\TrackingAllocator.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Micro benchmark options
+	struct MicroBenchmarkSettings
+	{
+		//run only the benchmarks whose name contains this text (empty = all)
+		std::string filter;
+		//calls of each wrapper benchmark, compound constructors run a hundredth of that
+		PxU32 iterations;
+		//timed runs per benchmark, the fastest one is reported
+		PxU32 repeats;
+		//memory of the SDK and the wrappers
+		MemoryBackend backend;
+
+		MicroBenchmarkSettings() : iterations(100000), repeats(5), backend(MEMORY_HEAP) {}
+	};
+
+	///Time the Actor/Scene wrapper calls and the compound actor constructors in isolation.
+	///Reports ns/op and heap allocations/op (operator new only, the SDK allocates through its own callback).
+	///Built as its own executable, Micro Benchmark.vcxproj, as it replaces the global operator new.
+	///Returns 1 on errors, 0 otherwise.
+	int MicroBenchmark(const MicroBenchmarkSettings& settings);
+}
@@ -5,6 +5,8 @@
 #include "HighResTimer.h"
 #include <iostream>
 #include <iomanip>
+#include <random>
+#include <sstream>
 
 namespace PhysicsEngine
 {
@@ -52,6 +54,26 @@ namespace PhysicsEngine
 		};
 	};
 
+	///Gameplay actions, queued by the input handlers and stored in recordings.
+	///Only add new ones at the end, recordings store the numbers.
+	struct GameAction
+	{
+		enum Enum
+		{
+			FIELD_GOAL,
+			CATAPULT_LEFT,
+			CATAPULT_RIGHT,
+			FORCE_UP,		//applied to the selected actor
+			FORCE_DOWN,
+			SPAWN_BALL,
+			SPAWN_100_BALLS,
+			SPAWN_1000_BALLS,
+			SPAWN_JOUST,
+			SELECT_NEXT,
+			RESET
+		};
+	};
+
 	///An example class showing the use of springs (distance joints).
 	class Trampoline
 	{
@@ -78,12 +100,30 @@ namespace PhysicsEngine
 			}
 		}
 
+		///A trampoline saved with Save, Scene::Load adds its boxes
+		Trampoline(CheckpointReader& reader)
+		{
+			bottom = reader.Adopt<Box>();
+			top = reader.Adopt<Box>();
+			springs.resize(4);
+			for (unsigned int i = 0; i < springs.size(); i++)
+				springs[i] = reader.AdoptJoint<DistanceJoint>();
+		}
+
 		void AddToScene(Scene* scene)
 		{
 			scene->Add(bottom);
 			scene->Add(top);
 		}
 
+		void Save(CheckpointWriter& writer)
+		{
+			writer.PutId(bottom);
+			writer.PutId(top);
+			for (unsigned int i = 0; i < springs.size(); i++)
+				writer.PutId(springs[i]);
+		}
+
 		~Trampoline()
 		{
 			for (unsigned int i = 0; i < springs.size(); i++)
@@ -106,6 +146,7 @@ namespace PhysicsEngine
 		///Method called when the contact with the trigger object is detected.
 		virtual void onTrigger(PxTriggerPair* pairs, PxU32 count) 
 		{
+			PROFILE_ZONE("onTrigger");
 			//you can read the trigger information here
 			for (PxU32 i = 0; i < count; i++)
 			{
@@ -144,6 +185,7 @@ namespace PhysicsEngine
 		///Method called when the contact by the filter shader is detected.
 		virtual void onContact(const PxContactPairHeader &pairHeader, const PxContactPair *pairs, PxU32 nbPairs) 
 		{
+			PROFILE_ZONE("onContact");
 			cerr << "Contact found between " << pairHeader.actors[0]->getName() << " " << pairHeader.actors[1]->getName() << endl;
 
 			string actor0 = pairHeader.actors[0]->getName();
@@ -225,14 +267,10 @@ namespace PhysicsEngine
 		MySimulationEventCallback* my_callback;
 		Plane* plane;
 
-		// timers
-		SecTimer fgTimer;
-		SecTimer ballTimer;
-		SecTimer doorTimer;
-		SecTimer cannonTimer;
-		SecTimer goalEventTimer;
-		SecTimer joustTimer;
-		SecTimer dropTimer;
+		// timed events, see CustomInit
+		TimerWheel::Id catapultTimer;
+		TimerWheel::Id goalEventTimer;
+		bool cannonFiring = false;
 
 		// player
 		CompoundPlayer* player;
@@ -295,6 +333,16 @@ namespace PhysicsEngine
 		PxMaterial* trampMat = CreateMaterial(0.1f, 0.1f, 1.0f);
 		PxMaterial* wallMat = CreateMaterial(0.1f, 0.1f, 0.2f);
 
+		//random numbers for the game, seeded so runs can be repeated
+		std::mt19937 rng;
+
+		//force of the up/down actions on the selected actor
+		PxReal forceStrength = 20.f;
+
+		//goals and wall hits so far, kept across resets, e.g. to start a replay
+		PxU32 highlights = 0;
+		//the ball was in the goal in the last step, a goal counts once
+		bool goalLast = false;
 
 	public:
 		//specify your custom filter shader here
@@ -304,26 +352,110 @@ namespace PhysicsEngine
 
 		};
 
+		///Goals and wall hits so far, see MySimulationEventCallback
+		PxU32 Highlights()
+		{
+			return highlights;
+		}
+
+		///Seed the random numbers used by the game (e.g. field goal speed)
+		void Seed(unsigned int seed)
+		{
+			rng.seed(seed);
+		}
+
+		///Run a queued action, see GameAction
+		virtual void CustomAction(PxU32 action)
+		{
+			switch (action)
+			{
+			case GameAction::FIELD_GOAL:
+				fieldGoal();
+				break;
+			case GameAction::CATAPULT_LEFT:
+				moveCatapultLeft();
+				break;
+			case GameAction::CATAPULT_RIGHT:
+				moveCatapultRight();
+				break;
+			case GameAction::FORCE_UP:
+				if (GetSelectedActor())
+					GetSelectedActor()->addForce(PxVec3(0,1,0)*forceStrength);
+				break;
+			case GameAction::FORCE_DOWN:
+				if (GetSelectedActor())
+					GetSelectedActor()->addForce(PxVec3(0,-1,0)*forceStrength);
+				break;
+			case GameAction::SPAWN_BALL:
+				spawnBalls();
+				break;
+			case GameAction::SPAWN_100_BALLS:
+				spawn100Balls();
+				break;
+			case GameAction::SPAWN_1000_BALLS:
+				spawn1000Balls();
+				break;
+			case GameAction::SPAWN_JOUST:
+				spawnJoust();
+				break;
+			case GameAction::SELECT_NEXT:
+				SelectNextActor();
+				break;
+			case GameAction::RESET:
+				Reset();
+				break;
+			default:
+				break;
+			}
+		}
+
+		///Gameplay state that decides what happens next, the score is only shown so it is left out
+		virtual void CustomHash(StateHash& hash)
+		{
+			hash.Add(doorHinge->DriveVelocity());
+			hash.Add(catapultJoint->DriveVelocity());
+			hash.Add(cannonFiring);
+			hash.Add(ballIsThere);
+			hash.Add(fieldGoalBool);
+			hash.Add(my_callback->goal);
+			hash.Add(my_callback->wallHit);
+			hash.Add(timers.Time());
+			hash.Add(timers.Pending());
+			//the next random number, without using it up
+			std::mt19937 next = rng;
+			hash.Add((PxU32)next());
+		}
+
 		///A custom scene class
+		//debug categories shown in the debug render modes (generation itself is switched by Scene::Visualisation)
 		void SetVisualisation()
 		{
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, 1.0f);
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES, 1.0f);
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES, 1.0f);
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LIMITS, 1.0f);
 		}
 
+		// gameplay events, on simulation time so they do not depend on the frame rate or run while paused
+		// (at their phase from the start of the game, also after a Load)
+		void ScheduleEvents()
+		{
+			timers.ScheduleAt(3.0f, [this] { resetDropBox(); }, 3.0f);
+			timers.ScheduleAt(5.0f, [this] { doorHinge->DriveVelocity(-1.0f); }, 8.0f); // open door
+			timers.ScheduleAt(8.0f, [this] { doorHinge->DriveVelocity(1.0f); }, 8.0f); // close door
+			timers.ScheduleAt(3.0f, [this] { resetJousters(); }, 3.0f);
+			timers.ScheduleAt(1.0f, [this] { cannonFiring = true; }, 6.0f);
+			timers.ScheduleAt(2.0f, [this] { cannonFiring = false; }, 6.0f);
+			timers.ScheduleAt(6.0f, [this] { cannonReset(); }, 6.0f);
+		}
+
 		//Custom scene initialisation
 		virtual void CustomInit()
 		{
-			fgTimer.resetChronoTimer();
-			ballTimer.resetChronoTimer();
-			cannonTimer.resetChronoTimer();
-			joustTimer.resetChronoTimer();
-			doorTimer.resetChronoTimer();
-			goalEventTimer.resetChronoTimer();
-			dropTimer.resetChronoTimer();
-			// resetting timers
+			ScheduleEvents();
+			catapultTimer = timers.Schedule(2.0f, [this] { resetCatapult(); }, 2.0f);
+			goalEventTimer = 0;
+			cannonFiring = false;
+			goalLast = false;
 
 			SetVisualisation();
 
@@ -604,6 +736,124 @@ namespace PhysicsEngine
 			}
 		}
 
+		///The actors of the game by their ids and the gameplay state, see CustomLoad
+		virtual void CustomSave(CheckpointWriter& writer)
+		{
+			writer.PutId(plane);
+			writer.PutId(player);
+			writer.PutId(gameField);
+			writer.PutId(goal);
+			writer.PutId(goalCollision);
+			writer.PutId(rugbyBall);
+			writer.PutId(catapultBase);
+			writer.PutId(catapultThrow);
+			writer.PutId(catapultJoint);
+			writer.PutId(cannon1);
+			writer.PutId(cannon1proj);
+			writer.PutId(cannon2);
+			writer.PutId(cannon2proj);
+			writer.PutId(cannon3);
+			writer.PutId(cannon3proj);
+			for (int i = 0; i < teamSize; i++)
+			{
+				writer.PutId(joustTeam1[i]);
+				writer.PutId(joustTeam2[i]);
+			}
+			writer.PutId(wall);
+			writer.PutId(door);
+			writer.PutId(doorHinge);
+			writer.PutId(flag);
+			writer.PutId(flagPole);
+			for (int i = 0; i < 5; i++)
+			{
+				writer.PutId(goalEventObjects1[i]);
+				writer.PutId(goalEventObjects2[i]);
+			}
+			tramp->Save(writer);
+			writer.PutId(drop);
+
+			writer.Put(cannonFiring);
+			writer.Put(ballIsThere);
+			writer.Put(fieldGoalBool);
+			writer.Put(goalLast);
+			writer.Put(highlights);
+			writer.Put(my_callback->goal);
+			writer.Put(my_callback->wallHit);
+			writer.Put(my_callback->trigger);
+			writer.Put(score);
+
+			std::ostringstream random_state;
+			random_state << rng;
+			writer.Put(random_state.str());
+
+			//the callbacks cannot be saved, only the time and when the one-off timers are due
+			writer.Put(timers.Time());
+			writer.Put(timers.Remaining(catapultTimer));
+			writer.Put(timers.Remaining(goalEventTimer));
+		}
+
+		///Restore a scene written by CustomSave, instead of CustomInit
+		virtual void CustomLoad(CheckpointReader& reader)
+		{
+			SetVisualisation();
+
+			my_callback = new MySimulationEventCallback();
+			px_scene->setSimulationEventCallback(my_callback);
+
+			plane = reader.Adopt<Plane>();
+			player = reader.Adopt<CompoundPlayer>();
+			gameField = reader.Adopt<CompoundField>();
+			goal = reader.Adopt<CompoundGoal>();
+			goalCollision = reader.Adopt<Box>();
+			rugbyBall = reader.Adopt<compoundRugbyBall>();
+			catapultBase = reader.Adopt<CompoundCatapult>();
+			catapultThrow = reader.Adopt<CompoundCatapultThrow>();
+			catapultJoint = reader.AdoptJoint<RevoluteJoint>();
+			cannon1 = reader.Adopt<CompoundGun>();
+			cannon1proj = reader.Adopt<Sphere>();
+			cannon2 = reader.Adopt<CompoundGun>();
+			cannon2proj = reader.Adopt<Sphere>();
+			cannon3 = reader.Adopt<CompoundGun>();
+			cannon3proj = reader.Adopt<Sphere>();
+			for (int i = 0; i < teamSize; i++)
+			{
+				joustTeam1[i] = reader.Adopt<CompoundJoust>();
+				joustTeam2[i] = reader.Adopt<CompoundJoust>();
+			}
+			wall = reader.Adopt<CompoundWall>();
+			door = reader.Adopt<Box>();
+			doorHinge = reader.AdoptJoint<RevoluteJoint>();
+			flag = reader.Adopt<Cloth>();
+			flagPole = reader.Adopt<Box>();
+			for (int i = 0; i < 5; i++)
+			{
+				goalEventObjects1[i] = reader.Adopt<Box>();
+				goalEventObjects2[i] = reader.Adopt<Box>();
+			}
+			tramp = new Trampoline(reader);
+			drop = reader.Adopt<Box>();
+
+			cannonFiring = reader.Get<bool>();
+			ballIsThere = reader.Get<bool>();
+			fieldGoalBool = reader.Get<bool>();
+			goalLast = reader.Get<bool>();
+			highlights = reader.Get<PxU32>();
+			my_callback->goal = reader.Get<bool>();
+			my_callback->wallHit = reader.Get<bool>();
+			my_callback->trigger = reader.Get<bool>();
+			score = reader.Get<int>();
+
+			std::istringstream random_state(reader.GetString());
+			random_state >> rng;
+
+			timers.Clear(reader.Get<PxReal>());
+			ScheduleEvents();
+			PxReal catapult = reader.Get<PxReal>();
+			catapultTimer = (catapult >= 0.f) ? timers.Schedule(catapult, [this] { resetCatapult(); }, 2.0f) : 0;
+			PxReal goal_event = reader.Get<PxReal>();
+			goalEventTimer = (goal_event >= 0.f) ? timers.Schedule(goal_event, [this] { resetGoalEventObjects(); }) : 0;
+		}
+
 		// ****************************
 
 		// ********** UPDATE ********** 
@@ -614,26 +864,6 @@ namespace PhysicsEngine
 		//Custom udpate function
 		virtual void CustomUpdate() 
 		{
-			// ********** RESETTING DROP BOX **********
-			if (dropTimer.getChronoTime() > 2)
-			{
-				((PxRigidBody*)drop->Get())->setGlobalPose(PxTransform(PxVec3(-35.0f, 15.5f, -75.0f)));
-				((PxRigidBody*)drop->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
-				dropTimer.resetChronoTimer();
-			}
-
-			// ********** OPEN AND CLOSE DOOR **********
-			if (doorTimer.getChronoTime() > 4)
-			{
-				doorHinge->DriveVelocity(-1.0f);
-			}
-
-			if (doorTimer.getChronoTime() > 7)
-			{
-				doorHinge->DriveVelocity(1.0f);
-				doorTimer.resetChronoTimer();
-			}
-
 			// ********** MOVING JOUSTERS **********
 			for (int i = 0; i < teamSize; i++)
 			{
@@ -647,77 +877,11 @@ namespace PhysicsEngine
 			}
 			// adding force to red team
 
-			if (joustTimer.getChronoTime() > 2)
-			{
-				float xPos1 = -15.0f; float yPos1 = 1.0f; float zPos1 = -10.0f;
-
-				for (int i = 0; i < teamSize; i++)
-				{
-					((PxRigidBody*)joustTeam1[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPos1, yPos1, zPos1), PxQuat(0, PxVec3(0.0f, 1.0f, 0.0f))));
-					((PxRigidBody*)joustTeam1[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
-
-					xPos1 += 10.0f;
-				}
-				// resetting blue team
-
-				float xPos2 = -15.0f; float yPos2 = 1.0f; float zPos2 = -30.0f;
-
-				for (int i = 0; i < teamSize; i++)
-				{
-					((PxRigidBody*)joustTeam2[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPos2, yPos2, zPos2), PxQuat(PxPi, PxVec3(0.0f, 1.0f, 0.0f))));
-					((PxRigidBody*)joustTeam2[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
-					
-					xPos2 += 10.0f;
-				}
-				// resetting blue team
-
-				joustTimer.resetChronoTimer();
-			}
-
 			// ********** FIRING CANNONS **********
-			if (cannonTimer.getChronoTime() == 1)
+			if (cannonFiring)
 			{
 				cannonForce();
 			}
-			else if (cannonTimer.getChronoTime() > 5)
-			{
-				cannonReset();
-				cannonTimer.resetChronoTimer();
-			}
-
-			// ********** RESETING CATAPULT *********
-			if (fgTimer.getChronoTime() > 1)
-			{
-				PxTransform basePos = ((PxRigidActor*)catapultBase->Get())->getGlobalPose();
-				PxVec3 newThrowPos = basePos.p - PxVec3(0.0f, 0.0f, -4.0f);
-				((PxRigidBody*)catapultThrow->Get())->setGlobalPose(PxTransform(newThrowPos));
-				// resetting the catapult position
-				catapultJoint->DriveVelocity(0.0f);
-				// stopping the catapult
-
-				catapultThrow->SetKinematic(true);
-
-				//if (fieldGoalBool == true)
-				{
-					fieldGoalBool = false;
-					fgTimer.resetChronoTimer();
-				}
-
-				if (ballIsThere == false)
-				{
-					// spawning in a new ball only if there is not a ball there
-					PxTransform throwPos = ((PxRigidActor*)catapultThrow->Get())->getGlobalPose();
-					PxVec3 newBallPos = throwPos.p + PxVec3(0.0f, 0.0f, 1.0f);
-					rugbyBall = new compoundRugbyBall(PxTransform(PxVec3(0.0f, 6.5f, -1.0f)));
-					rugbyBall->Color(PxVec3(0.7f, 0.0f, 0.7f));
-					rugbyBall->Material(rugbyBallMat);
-					rugbyBall->Name("BALL");
-					rugbyBall->SetupFiltering(FilterGroup::ACTOR1, FilterGroup::ACTOR0);
-					rugbyBall->SetKinematic(true);
-					ballIsThere = true;
-					Add(rugbyBall);
-				}
-			}
 
 			// ********** BALL FOLLOW CATAPULT **********
 			if (fieldGoalBool == false)
@@ -730,6 +894,11 @@ namespace PhysicsEngine
 			}
 
 			// ********** COLLISION EVENTS **********
+			// the ball stays in the trigger for a few steps
+			if (my_callback->goal && !goalLast)
+				highlights++;
+			goalLast = my_callback->goal;
+
 			// if the player scores a goal
 			if (my_callback->goal == true)
 			{
@@ -755,41 +924,105 @@ namespace PhysicsEngine
 
 					((PxRigidBody*)goalEventObjects1[i]->Get())->addForce(GEforce1);
 					((PxRigidBody*)goalEventObjects2[i]->Get())->addForce(GEforce1);
-					goalEventTimer.resetChronoTimer();
 				}
+
+				// put the objects back 3 seconds after the ball left the goal
+				timers.Cancel(goalEventTimer);
+				goalEventTimer = timers.Schedule(3.0f, [this] { resetGoalEventObjects(); });
 			}
 
 			// if ball hits wall
 			if (my_callback->wallHit == true)
 			{
 				my_callback->wallHit = false;
+				highlights++;
 				PxVec3 wallBoxPos = my_callback->ballPos.p + PxVec3(0.0f, -2.0f, 0.0f);
 
 				wallBox = new Box(PxTransform(wallBoxPos), PxVec3(0.4f, 0.4f, 0.4f));
 				Add(wallBox);// spawn new ball to act as wall being chipped away
 			}
 
-			
+		}
+
+		// *************************************
+
+		// ********** OTHER FUNCTIONS **********
+
+		// *************************************
+
+		void resetDropBox()
+		{
+			((PxRigidBody*)drop->Get())->setGlobalPose(PxTransform(PxVec3(-35.0f, 15.5f, -75.0f)));
+			((PxRigidBody*)drop->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
+		}
+
+		void resetJousters()
+		{
+			float xPos1 = -15.0f; float yPos1 = 1.0f; float zPos1 = -10.0f;
 
-			// ********** RESETTING GOAL EVENT OBJECTS **********
-			if (goalEventTimer.getChronoTime() > 2)
+			for (int i = 0; i < teamSize; i++)
 			{
-				float xPosGE = -45.0f; float yPosGE = 1.0f; float zPosGE = -95.0f;
-				for (int i = 0; i < 5; i++)
-				{
-					((PxRigidBody*)goalEventObjects1[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPosGE, yPosGE, zPosGE)));
-					((PxRigidBody*)goalEventObjects2[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPosGE + 90.0f, yPosGE, zPosGE)));
+				((PxRigidBody*)joustTeam1[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPos1, yPos1, zPos1), PxQuat(0, PxVec3(0.0f, 1.0f, 0.0f))));
+				((PxRigidBody*)joustTeam1[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
 
-					yPosGE += 2.0f;
-				}
+				xPos1 += 10.0f;
+			}
+			// resetting blue team
+
+			float xPos2 = -15.0f; float yPos2 = 1.0f; float zPos2 = -30.0f;
+
+			for (int i = 0; i < teamSize; i++)
+			{
+				((PxRigidBody*)joustTeam2[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPos2, yPos2, zPos2), PxQuat(PxPi, PxVec3(0.0f, 1.0f, 0.0f))));
+				((PxRigidBody*)joustTeam2[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
+				
+				xPos2 += 10.0f;
 			}
+			// resetting blue team
 		}
 
-		// *************************************
+		void resetCatapult()
+		{
+			PxTransform basePos = ((PxRigidActor*)catapultBase->Get())->getGlobalPose();
+			PxVec3 newThrowPos = basePos.p - PxVec3(0.0f, 0.0f, -4.0f);
+			((PxRigidBody*)catapultThrow->Get())->setGlobalPose(PxTransform(newThrowPos));
+			// resetting the catapult position
+			catapultJoint->DriveVelocity(0.0f);
+			// stopping the catapult
 
-		// ********** OTHER FUNCTIONS **********
+			catapultThrow->SetKinematic(true);
 
-		// *************************************
+			fieldGoalBool = false;
+
+			if (ballIsThere == false)
+			{
+				// spawning in a new ball only if there is not a ball there
+				PxTransform throwPos = ((PxRigidActor*)catapultThrow->Get())->getGlobalPose();
+				PxVec3 newBallPos = throwPos.p + PxVec3(0.0f, 0.0f, 1.0f);
+				rugbyBall = new compoundRugbyBall(PxTransform(PxVec3(0.0f, 6.5f, -1.0f)));
+				rugbyBall->Color(PxVec3(0.7f, 0.0f, 0.7f));
+				rugbyBall->Material(rugbyBallMat);
+				rugbyBall->Name("BALL");
+				rugbyBall->SetupFiltering(FilterGroup::ACTOR1, FilterGroup::ACTOR0);
+				rugbyBall->SetKinematic(true);
+				ballIsThere = true;
+				Add(rugbyBall);
+			}
+		}
+
+		void resetGoalEventObjects()
+		{
+			float xPosGE = -45.0f; float yPosGE = 1.0f; float zPosGE = -95.0f;
+			for (int i = 0; i < 5; i++)
+			{
+				((PxRigidBody*)goalEventObjects1[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPosGE, yPosGE, zPosGE)));
+				((PxRigidBody*)goalEventObjects2[i]->Get())->setGlobalPose(PxTransform(PxVec3(xPosGE + 90.0f, yPosGE, zPosGE)));
+				((PxRigidBody*)goalEventObjects1[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
+				((PxRigidBody*)goalEventObjects2[i]->Get())->setLinearVelocity(PxVec3(0.0f, 0.0f, 0.0f));
+
+				yPosGE += 2.0f;
+			}
+		}
 
 		void moveCatapultLeft() // on J key
 		{
@@ -809,9 +1042,9 @@ namespace PhysicsEngine
 		{
 			if (fieldGoalBool == false)
 			{
-				fgTimer.resetChronoTimer();
-				ballTimer.resetChronoTimer();
-				// resetting timers
+				timers.Cancel(catapultTimer);
+				catapultTimer = timers.Schedule(2.0f, [this] { resetCatapult(); }, 2.0f);
+				// the catapult resets 2 seconds after the kick
 
 				fieldGoalBool = true;
 				catapultBase->SetKinematic(true);
@@ -819,7 +1052,7 @@ namespace PhysicsEngine
 				rugbyBall->SetKinematic(false);
 				ballIsThere = false;
 
-				int speed = rand() % (28 - 19) + 19;
+				int speed = (int)(rng() % (28 - 19)) + 19;
 				// generate random number between 19 and 28
 				catapultJoint->DriveVelocity(-speed);
 				//catapultJoint->DriveVelocity(-23.0f);
@@ -912,5 +1145,21 @@ namespace PhysicsEngine
 			}
 			// creating jouters
 		}
+
+		void spawnFlags(int count)
+		{
+			float xPos = -50.0f;
+
+			for (int i = 0; i < count; i++)
+			{
+				Cloth* testFlag = new Cloth(PxTransform(PxVec3(xPos, 20.0f, -60.0f), PxQuat(PxPi / 2, PxVec3(0.0f, 0.0f, 1.0f))), PxVec2(10.0f, 10.0f), 10, 10);
+				testFlag->Color(color_palette[2]);
+				testFlag->Name("FLAG");
+				Add(testFlag);
+
+				xPos += 100.0f / count;
+			}
+			// creating flags along the field
+		}
 	};
 }
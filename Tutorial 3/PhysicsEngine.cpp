@@ -1,5 +1,8 @@
 #include "PhysicsEngine.h"
+#include "BasicActors.h"
+#include "Extras\PhysXProfiler.h"
 #include <iostream>
+#include <chrono>
 
 namespace PhysicsEngine
 {
@@ -8,27 +11,43 @@ namespace PhysicsEngine
 
 	//default error and allocator callbacks
 	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
 
 	//PhysX objects
 	PxFoundation* foundation = 0;
 	debugger::comm::PvdConnection* vd_connection = 0;
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
+	PxProfileZoneManager* profile_zone_manager = 0;
+	//SDK profile events for the game's traces
+	Profiler::PhysXEvents physx_events;
 
 	///PhysX functions
-	void PxInit()
+	void PxInit(MemoryBackend backend)
 	{
 		//foundation
 		if (!foundation)
-			foundation = PxCreateFoundation(PX_PHYSICS_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+		{
+			GetTrackingAllocator().Backend(backend);
+			foundation = PxCreateFoundation(PX_PHYSICS_VERSION, GetTrackingAllocator(), gDefaultErrorCallback);
+			//pass the type names of allocations to the tracker
+			if (foundation)
+				foundation->setReportAllocationNames(true);
+		}
 
 		if(!foundation)
 			throw new Exception("PhysicsEngine::PxInit, Could not create the PhysX SDK foundation.");
 
+		//profile zones of the SDK, read locally by the profiler
+		if (!profile_zone_manager)
+		{
+			profile_zone_manager = &PxProfileZoneManager::createProfileZoneManager(foundation);
+			physx_events.Attach(*profile_zone_manager);
+			Profiler::AddSource(&physx_events);
+		}
+
 		//physics
 		if (!physics)
-			physics = PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, PxTolerancesScale());
+			physics = PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, PxTolerancesScale(), false, profile_zone_manager);
 
 		if(!physics)
 			throw new Exception("PhysicsEngine::PxInit, Could not initialise the PhysX SDK.");
@@ -56,6 +75,14 @@ namespace PhysicsEngine
 			cooking->release();
 		if (physics)
 			physics->release();
+		//loaded objects live in the checkpoint mappings
+		ReleaseCheckpoints();
+		if (profile_zone_manager)
+		{
+			Profiler::RemoveSource(&physx_events);
+			physx_events.Detach();
+			profile_zone_manager->release();
+		}
 		if (foundation)
 			foundation->release();
 	}
@@ -86,6 +113,26 @@ namespace PhysicsEngine
 
 	///Actor methods
 
+	Actor::Actor(CheckpointActor& state)
+		: actor(state.actor)
+	{
+		MemoryScope scope(MEMORY_ACTORS);
+		state.wrapper = this;
+		Name(state.name);
+
+		for (unsigned int i = 0; i < state.colors.size(); i++)
+			colors.push_back((state.colors[i].x < 0.f) ? default_color : state.colors[i]);
+
+		//the user data of the saved shapes is gone, pass the colour pointers to the renderer again
+		if (actor->isRigidActor())
+		{
+			std::vector<PxShape*> shapes = GetShapes();
+			colors.resize(shapes.size(), default_color);
+			for (unsigned int i = 0; i < shapes.size(); i++)
+				shapes[i]->userData = new UserData(&colors[i]);
+		}
+	}
+
 	///Constructor
 	PxActor* Actor::Get()
 	{
@@ -184,6 +231,7 @@ namespace PhysicsEngine
 
 	DynamicActor::DynamicActor(const PxTransform& pose) : Actor()
 	{
+		MemoryScope scope(MEMORY_ACTORS);
 		actor = (PxActor*)GetPhysics()->createRigidDynamic(pose);
 		Name("");
 	}
@@ -196,6 +244,7 @@ namespace PhysicsEngine
 
 	void DynamicActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
+		MemoryScope scope(MEMORY_ACTORS);
 		PxShape* shape = ((PxRigidDynamic*)actor)->createShape(geometry,*GetMaterial());
 		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
 		colors.push_back(default_color);
@@ -208,10 +257,15 @@ namespace PhysicsEngine
 	void DynamicActor::SetKinematic(bool value, PxU32 index)
 	{
 		((PxRigidDynamic*)actor)->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, value);
+		//actors not added yet are picked up by Scene::Add
+		PxScene* scene = actor->getScene();
+		if (scene && scene->userData)
+			((Scene*)scene->userData)->Kinematic(this, value);
 	}
 
 	StaticActor::StaticActor(const PxTransform& pose)
 	{
+		MemoryScope scope(MEMORY_ACTORS);
 		actor = (PxActor*)GetPhysics()->createRigidStatic(pose);
 		Name("");
 	}
@@ -224,6 +278,7 @@ namespace PhysicsEngine
 
 	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
+		MemoryScope scope(MEMORY_ACTORS);
 		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry,*GetMaterial());
 		colors.push_back(default_color);
 		//pass the color pointers to the renderer
@@ -233,30 +288,76 @@ namespace PhysicsEngine
 	}
 
 	///Scene methods
+	Scene::~Scene()
+	{
+		if (px_scene)
+			Release();
+		if (dispatcher)
+			dispatcher->release();
+	}
+
 	void Scene::Init()
 	{
+		Create();
+		CustomInit();
+		Start();
+	}
+
+	void Scene::Create()
+	{
+		MemoryScope scope(MEMORY_SCENE);
+
 		//scene
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
-		if(!sceneDesc.cpuDispatcher)
+		//the previous scene is released by now, so its dispatcher can go
+		if (dispatcher && (dispatcher->getWorkerCount() != threads))
 		{
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
+			dispatcher->release();
+			dispatcher = 0;
 		}
+		if (!dispatcher)
+			dispatcher = PxDefaultCpuDispatcherCreate(threads);
+		sceneDesc.cpuDispatcher = dispatcher;
 
 		sceneDesc.filterShader = filter_shader;
 		
 		//sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
 
+		//report moved actors so that only their render proxies are updated
+		sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVETRANSFORMS;
+
 		px_scene = GetPhysics()->createScene(sceneDesc);
 
+		//wrappers created from now on belong to this scene, bump allocated only with the pool backend
+		arena.Pooled(GetTrackingAllocator().Backend() == MEMORY_POOLS);
+		ActiveArena(&arena);
+
 		if (!px_scene)
 			throw new Exception("PhysicsEngine::Scene::Init, Could not initialise the scene.");
 
+		//for the actors to find their scene wrapper, see DynamicActor::SetKinematic
+		px_scene->userData = this;
+
 		//default gravity
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
 
-		CustomInit();
+		if (match_recorder)
+			match_recorder->Clear();
+
+		if (rewind_buffer)
+			rewind_buffer->Clear();
+
+		timers.Clear();
+	}
+
+	void Scene::Start()
+	{
+		//categories are set up by the user, the scale decides if anything is generated
+		Visualisation(visualisation);
+		//toggles win over the categories set by CustomInit or CustomLoad
+		for (unsigned int i = 0; i < visualisation_toggles.size(); i++)
+			px_scene->setVisualizationParameter(visualisation_toggles[i].first, visualisation_toggles[i].second);
 
 		pause = false;
 
@@ -267,18 +368,147 @@ namespace PhysicsEngine
 
 	void Scene::Update(PxReal dt)
 	{
+		PROFILE_ZONE("Scene::Update");
+		typedef std::chrono::high_resolution_clock Clock;
+
+		step_times = StepTimes();
+
+		{
+			//before the pause check, so that actions like a reset are not held back
+			PROFILE_ZONE("Actions");
+			for (unsigned int i = 0; i < actions.size(); i++)
+			{
+				if (action_recorder)
+					action_recorder->Record(step_count, actions[i]);
+				CustomAction(actions[i]);
+			}
+			actions.clear();
+		}
+
 		if (pause)
 			return;
 
-		CustomUpdate();
+		Clock::time_point start = Clock::now();
+		{
+			PROFILE_ZONE("Timers");
+			timers.Advance(dt);
+		}
+		{
+			PROFILE_ZONE("CustomUpdate");
+			CustomUpdate();
+		}
+		Clock::time_point simulate = Clock::now();
+		{
+			PROFILE_ZONE("simulate");
+			px_scene->simulate(dt);
+		}
+		Clock::time_point fetch = Clock::now();
+		{
+			//event callbacks run in here
+			PROFILE_ZONE("fetchResults");
+			px_scene->fetchResults(true);
+		}
+		Clock::time_point end = Clock::now();
+
+		step_times.gameplay = std::chrono::duration<PxReal, std::milli>(simulate - start).count();
+		step_times.simulate = std::chrono::duration<PxReal, std::milli>(fetch - simulate).count();
+		step_times.fetch = std::chrono::duration<PxReal, std::milli>(end - fetch).count();
+
+		if (stats_logger)
+		{
+			PxSimulationStatistics statistics;
+			px_scene->getSimulationStatistics(statistics);
+			stats_logger->Record(step_count, statistics, step_times.gameplay, step_times.simulate, step_times.fetch);
+		}
+		if (match_recorder)
+		{
+			PROFILE_ZONE("RecordMatch");
+			match_recorder->Record(step_count, step_times.gameplay + step_times.simulate + step_times.fetch);
+		}
+		if (rewind_buffer)
+		{
+			PROFILE_ZONE("RecordRewind");
+			rewind_buffer->Record();
+		}
+		step_count++;
+
+		PROFILE_ZONE("UpdateRenderProxies");
+		PxU32 nb_active = 0;
+		const PxActiveTransform* active = px_scene->getActiveTransforms(nb_active);
+		render_proxies.Update(active, nb_active);
+		render_proxies.UpdateKinematics();
+	}
+
+	void Scene::Queue(PxU32 action)
+	{
+		actions.push_back(action);
+	}
+
+	void Scene::RecordActions(ActionRecorder* recorder)
+	{
+		action_recorder = recorder;
+	}
+
+	void Scene::RecordMatch(MatchRecorder* recorder)
+	{
+		match_recorder = recorder;
+		if (!recorder)
+			return;
+
+		std::vector<PxActor*> actors = GetAllActors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+			recorder->Add(actors[i]);
+	}
+
+	void Scene::RecordRewind(RewindBuffer* buffer)
+	{
+		rewind_buffer = buffer;
+		if (!buffer)
+			return;
 
-		px_scene->simulate(dt);
-		px_scene->fetchResults(true);
+		buffer->Clear();
+		std::vector<PxActor*> actors = GetAllActors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+			buffer->Add(actors[i]);
+	}
+
+	void Scene::ShowRewind(RewindBuffer& buffer, PxU32 frame)
+	{
+		buffer.Seek(frame);
+		for (PxU32 i = 0; i < buffer.ActorCount(); i++)
+			render_proxies.Move(buffer.GetActor(i), buffer.Pose(i));
+		render_proxies.Flush();
+	}
+
+	void Scene::ShowSimulated()
+	{
+		render_proxies.Refresh();
+	}
+
+	PxU32 Scene::StepCount()
+	{
+		return step_count;
 	}
 
 	void Scene::Add(Actor* actor)
 	{
 		px_scene->addActor(*actor->Get());
+		render_proxies.Add(actor->Get());
+		if (match_recorder)
+			match_recorder->Add(actor->Get());
+		if (rewind_buffer)
+			rewind_buffer->Add(actor->Get());
+	}
+
+	void Scene::Remove(Actor* actor)
+	{
+		px_scene->removeActor(*actor->Get());
+		render_proxies.Remove(actor->Get());
+	}
+
+	void Scene::Kinematic(Actor* actor, bool value)
+	{
+		render_proxies.Kinematic(actor->Get(), value);
 	}
 
 	PxScene* Scene::Get() 
@@ -286,12 +516,229 @@ namespace PhysicsEngine
 		return px_scene; 
 	}
 
+	const RenderProxyStore& Scene::GetRenderProxies()
+	{
+		return render_proxies;
+	}
+
+	const StepTimes& Scene::GetStepTimes()
+	{
+		return step_times;
+	}
+
+	void Scene::LogStatistics(StatsLogger* logger)
+	{
+		stats_logger = logger;
+	}
+
+	void Scene::Threads(PxU32 value)
+	{
+		threads = value;
+	}
+
+	PxU64 Scene::Hash(std::vector<PxU64>* actor_hashes)
+	{
+		StateHash hash;
+		std::vector<PxActor*> actors = GetAllActors();
+		if (actor_hashes)
+			actor_hashes->resize(actors.size());
+
+		for (unsigned int i = 0; i < actors.size(); i++)
+		{
+			StateHash actor_hash(i);
+			switch (actors[i]->getType())
+			{
+			case PxActorType::eRIGID_DYNAMIC:
+				{
+					PxRigidDynamic* actor = (PxRigidDynamic*)actors[i];
+					actor_hash.Add(actor->getGlobalPose());
+					actor_hash.Add(actor->getLinearVelocity());
+					actor_hash.Add(actor->getAngularVelocity());
+					actor_hash.Add(actor->isSleeping());
+				}
+				break;
+			case PxActorType::eRIGID_STATIC:
+				actor_hash.Add(((PxRigidStatic*)actors[i])->getGlobalPose());
+				break;
+			case PxActorType::eCLOTH:
+				actor_hash.Add(((PxCloth*)actors[i])->getGlobalPose());
+				break;
+			default:
+				break;
+			}
+
+			PxU64 value = actor_hash.Value();
+			hash.Add(value);
+			if (actor_hashes)
+				(*actor_hashes)[i] = value;
+		}
+
+		CustomHash(hash);
+		return hash.Value();
+	}
+
 	void Scene::Reset()
 	{
-		px_scene->release();
+		Release();
 		Init();
 	}
 
+	void Scene::Release()
+	{
+		//wrappers first, their destructors still read the shapes
+		arena.Release();
+		if (ActiveArena() == &arena)
+			ActiveArena(0);
+
+		std::vector<PxActor*> actors = GetAllActors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+			actors[i]->release();
+		px_scene->release();
+		px_scene = 0;
+
+		//what the wrappers left of the loaded checkpoints, and the memory it lives in
+		for (unsigned int i = 0; i < checkpoints.size(); i++)
+			ReleaseCheckpoint(checkpoints[i]);
+		checkpoints.clear();
+
+		//the proxies point to the shapes and colours of the released actors
+		render_proxies.Clear();
+	}
+
+	bool Scene::Save(const string& filename)
+	{
+		//the saved colours are the original ones
+		if (selected_actor)
+			HighlightOff(selected_actor);
+
+		CheckpointWriter writer;
+		std::vector<PxActor*> actors = GetAllActors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+			writer.Add(*actors[i]);
+
+		std::vector<PxConstraint*> constraints(px_scene->getNbConstraints());
+		if (constraints.size())
+			px_scene->getConstraints(&constraints.front(), (PxU32)constraints.size());
+		for (unsigned int i = 0; i < constraints.size(); i++)
+		{
+			PxU32 type;
+			void* external = constraints[i]->getExternalReference(type);
+			if (type == PxConstraintExtIDs::eJOINT)
+				writer.Add(*(PxJoint*)external);
+		}
+
+		CustomSave(writer);
+		bool written = writer.Write(filename);
+
+		if (selected_actor)
+			HighlightOn(selected_actor);
+		return written;
+	}
+
+	bool Scene::Load(const string& filename)
+	{
+		PROFILE_ZONE("Scene::Load");
+
+		//read and check everything before the current scene goes
+		CheckpointReader reader;
+		if (!reader.Open(filename) || !reader.Deserialize())
+			return false;
+
+		Release();
+		Create();
+
+		bool loaded = true;
+		try
+		{
+			CustomLoad(reader);
+		}
+		catch (Exception* exc)
+		{
+			//the game reads the checkpoint back differently than it wrote it, e.g. another version
+			cerr << exc->what() << endl;
+			delete exc;
+			loaded = false;
+		}
+
+		//wrap what the game did not adopt, e.g. spawned balls
+		std::vector<CheckpointActor>& actors = reader.Actors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+		{
+			if (actors[i].wrapper)
+				continue;
+			if (actors[i].actor->isRigidDynamic())
+				new DynamicActor(actors[i]);
+			else if (actors[i].actor->isRigidStatic())
+				new StaticActor(actors[i]);
+			else if (actors[i].actor->isCloth())
+				new Cloth(actors[i]);
+		}
+
+		std::vector<CheckpointJoint>& joints = reader.Joints();
+		for (unsigned int i = 0; i < joints.size(); i++)
+		{
+			if (!joints[i].wrapper)
+				new Joint(joints[i]);
+		}
+
+		//in the saved order, which is the order of GetAllActors and Hash
+		for (unsigned int i = 0; i < actors.size(); i++)
+		{
+			if (actors[i].wrapper)
+				Add(actors[i].wrapper);
+		}
+
+		//the objects now belong to the scene, as with Release
+		checkpoints.push_back(reader.Keep());
+
+		//the gameplay state is partial, start over
+		if (!loaded)
+		{
+			Reset();
+			return false;
+		}
+
+		Start();
+		return true;
+	}
+
+	void Scene::Visualisation(bool value)
+	{
+		visualisation = value;
+		px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, visualisation ? 1.f : 0.f);
+	}
+
+	bool Scene::Visualisation()
+	{
+		return visualisation;
+	}
+
+	void Scene::ToggleVisualisation(PxVisualizationParameter::Enum parameter)
+	{
+		PxReal value = Visualisation(parameter) ? 0.f : 1.f;
+		px_scene->setVisualizationParameter(parameter, value);
+
+		for (unsigned int i = 0; i < visualisation_toggles.size(); i++)
+		{
+			if (visualisation_toggles[i].first == parameter)
+			{
+				visualisation_toggles[i].second = value;
+				return;
+			}
+		}
+		visualisation_toggles.push_back(std::make_pair(parameter, value));
+	}
+
+	bool Scene::Visualisation(PxVisualizationParameter::Enum parameter)
+	{
+		return px_scene->getVisualizationParameter(parameter) != 0.f;
+	}
+
+	void Scene::VisualisationCullingBox(const PxBounds3& box)
+	{
+		px_scene->setVisualizationCullingBox(box);
+	}
+
 	void Scene::Pause(bool value)
 	{
 		pause = value;
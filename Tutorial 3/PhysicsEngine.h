@@ -4,6 +4,17 @@
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
 #include "Extras\UserData.h"
+#include "Extras\RenderProxy.h"
+#include "Extras\Profiler.h"
+#include "Extras\StatsLogger.h"
+#include "Extras\TrackingAllocator.h"
+#include "Extras\MemoryPools.h"
+#include "TimerWheel.h"
+#include "Extras\StateHash.h"
+#include "Extras\ActionLog.h"
+#include "Extras\MatchRecording.h"
+#include "Extras\RewindBuffer.h"
+#include "Checkpoint.h"
 #include <string>
 
 namespace PhysicsEngine
@@ -11,8 +22,8 @@ namespace PhysicsEngine
 	using namespace physx;
 	using namespace std;
 	
-	///Initialise PhysX framework
-	void PxInit();
+	///Initialise PhysX framework, the memory backend is fixed by the first call
+	void PxInit(MemoryBackend backend=MEMORY_HEAP);
 
 	///Release PhysX resources
 	void PxRelease();
@@ -40,13 +51,23 @@ namespace PhysicsEngine
 		std::vector<PxVec3> colors;
 		std::string name;
 
+		static void Destroy(void* object) { ((Actor*)object)->~Actor(); }
+
 	public:
+		//wrappers live in the arena of the active scene, bump allocated with the pool backend
+		static void* operator new(size_t size) { return ArenaNew(size, MEMORY_ACTORS, Destroy); }
+		static void operator delete(void* memory) { ArenaDelete(memory); }
 		///Constructor
 		Actor()
 			: actor(0)
 		{
 		}
 
+		///Take over an actor loaded from a checkpoint, with its name and colours
+		Actor(CheckpointActor& state);
+
+		virtual ~Actor() {}
+
 		PxActor* Get();
 
 		void Color(PxVec3 new_color, PxU32 shape_index=-1);
@@ -75,6 +96,8 @@ namespace PhysicsEngine
 	public:
 		DynamicActor(const PxTransform& pose);
 
+		DynamicActor(CheckpointActor& state) : Actor(state) {}
+
 		~DynamicActor();
 
 		void CreateShape(const PxGeometry& geometry, PxReal density);
@@ -87,11 +110,21 @@ namespace PhysicsEngine
 	public:
 		StaticActor(const PxTransform& pose);
 
+		StaticActor(CheckpointActor& state) : Actor(state) {}
+
 		~StaticActor();
 
 		void CreateShape(const PxGeometry& geometry, PxReal density=0.f);
 	};
 
+	///Time spent in the parts of a simulation step [ms]
+	struct StepTimes
+	{
+		PxReal gameplay, simulate, fetch;
+
+		StepTimes() : gameplay(0.f), simulate(0.f), fetch(0.f) {}
+	};
+
 	///Generic scene class
 	class Scene
 	{
@@ -106,13 +139,54 @@ namespace PhysicsEngine
 		std::vector<PxVec3> sactor_color_orig;
 		//custom filter shader
 		PxSimulationFilterShader filter_shader;
+		//generate debug visualisation data
+		bool visualisation;
+		//debug categories toggled by the user and their values, kept across Reset and Load
+		std::vector<std::pair<PxVisualizationParameter::Enum, PxReal> > visualisation_toggles;
+		//shapes prepared for the renderer
+		RenderProxyStore render_proxies;
+		//timings of the last step
+		StepTimes step_times;
+		//steps simulated by this scene, kept across resets
+		PxU32 step_count;
+		//receives the statistics of every step if set
+		StatsLogger* stats_logger;
+		//wrapper objects of the scene, released with it
+		Arena arena;
+		//gameplay events on simulation time, advanced before CustomUpdate and cleared by Init
+		TimerWheel timers;
+		//worker threads of the SDK and their dispatcher, recreated by Init if the count changed
+		PxU32 threads;
+		PxDefaultCpuDispatcher* dispatcher;
+		//gameplay actions waiting for the next Update
+		std::vector<PxU32> actions;
+		//receives every applied action if set
+		ActionRecorder* action_recorder;
+		//receives the actors and their poses after every step if set
+		MatchRecorder* match_recorder;
+		//receives the poses of the dynamic actors after every step if set
+		RewindBuffer* rewind_buffer;
+		//loaded checkpoints the actors of the scene live in, released with the scene
+		std::vector<CheckpointMemory*> checkpoints;
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
+		///Release the PhysX scene with its actors and wrappers, and the loaded checkpoints
+		void Release();
+
+		///Create an empty PhysX scene, the part of Init shared with Load
+		void Create();
+
+		///Select an actor and set up visualisation, after CustomInit or CustomLoad
+		void Start();
+
 	public:
-		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader) {}
+		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : px_scene(0), filter_shader(custom_filter_shader), visualisation(false), step_count(0), stats_logger(0), threads(1), dispatcher(0), action_recorder(0), match_recorder(0), rewind_buffer(0) {}
+
+		///Release the scene and its dispatcher, before PxRelease
+		virtual ~Scene();
 
 		///Init the scene
 		void Init();
@@ -126,21 +200,101 @@ namespace PhysicsEngine
 		///User defined update step
 		virtual void CustomUpdate() {}
 
+		///Queue a gameplay action, applied at the start of the next Update (also while paused).
+		///Input goes through here so every action belongs to a simulation step and can be replayed.
+		void Queue(PxU32 action);
+
+		///User defined actions, see Queue
+		virtual void CustomAction(PxU32 action) {}
+
+		///Write every applied action into a recorder (0 = off)
+		void RecordActions(ActionRecorder* recorder);
+
+		///Write the poses of all actors into a recorder after every step (0 = off)
+		void RecordMatch(MatchRecorder* recorder);
+
+		///Keep the recent poses of all dynamic actors in a rewind buffer after every step (0 = off)
+		void RecordRewind(RewindBuffer* buffer);
+
+		///Show a frame of a rewind buffer instead of the simulated poses, e.g. for a replay
+		void ShowRewind(RewindBuffer& buffer, PxU32 frame);
+
+		///Back to the simulated poses after ShowRewind
+		void ShowSimulated();
+
+		///Steps simulated by this scene, kept across resets
+		PxU32 StepCount();
+
 		///Add actors
 		void Add(Actor* actor);
 
+		///Take an actor out of the scene and its render proxies, before it is released.
+		///Match and rewind recordings keep tracking it until they are cleared.
+		void Remove(Actor* actor);
+
+		///Keep the render proxies of a kinematic actor in step, see DynamicActor::SetKinematic
+		void Kinematic(Actor* actor, bool value);
+
 		///Get the PxScene object
 		PxScene* Get();
 
-		///Reset the scene
+		///Get the shapes to render, updated after every step
+		const RenderProxyStore& GetRenderProxies();
+
+		///Get the timings of the last step
+		const StepTimes& GetStepTimes();
+
+		///Collect the simulation statistics of every step into a logger (0 = off)
+		void LogStatistics(StatsLogger* logger);
+
+		///Set the number of SDK worker threads, used from the next Init or Reset
+		void Threads(PxU32 value);
+
+		///Hash of the simulation state: poses and velocities of all actors and CustomHash.
+		///Optionally returns the hash of every actor, in the order of GetAllActors.
+		PxU64 Hash(std::vector<PxU64>* actor_hashes=0);
+
+		///User defined state for Hash (joint drives, gameplay flags, ...)
+		virtual void CustomHash(StateHash& hash) {}
+
+		///Reset the scene, this destroys all wrappers created since Init
 		void Reset();
 
+		///Write all actors, joints and CustomSave into a checkpoint file
+		bool Save(const string& filename);
+
+		///Replace the scene with a checkpoint written by Save, the current scene is kept if the file cannot be read.
+		///Actors not adopted by CustomLoad get generic wrappers.
+		///If CustomLoad reads the file back differently than CustomSave wrote it, the scene starts over and this fails.
+		bool Load(const string& filename);
+
+		///User defined state for Save, e.g. the ids of the wrappers and the gameplay flags
+		virtual void CustomSave(CheckpointWriter& writer) {}
+
+		///Read back the state of CustomSave in the same order, instead of CustomInit
+		virtual void CustomLoad(CheckpointReader& reader) {}
+
 		///Set pause
 		void Pause(bool value);
 
 		///Get pause
 		bool Pause();
 
+		///Turn generation of debug visualisation data on/off
+		void Visualisation(bool value);
+
+		///Check if debug visualisation data is generated
+		bool Visualisation();
+
+		///Toggle a single debug visualisation category, it stays so after Reset and Load
+		void ToggleVisualisation(PxVisualizationParameter::Enum parameter);
+
+		///Check if a debug visualisation category is on
+		bool Visualisation(PxVisualizationParameter::Enum parameter);
+
+		///Limit debug visualisation to a box, e.g. around the view frustum
+		void VisualisationCullingBox(const PxBounds3& box);
+
 		///Get the selected dynamic actor on the scene
 		PxRigidDynamic* GetSelectedActor();
 
@@ -157,9 +311,22 @@ namespace PhysicsEngine
 	protected:
 		PxJoint* joint;
 
+		static void Destroy(void* object)
+		{
+			if (((Joint*)object)->joint)
+				((Joint*)object)->joint->release();
+		}
+
 	public:
+		//see Actor
+		static void* operator new(size_t size) { return ArenaNew(size, MEMORY_ACTORS, Destroy); }
+		static void operator delete(void* memory) { ArenaDelete(memory); }
+
 		Joint() : joint(0) {}
 
+		///Take over a joint loaded from a checkpoint
+		Joint(CheckpointJoint& state) : joint(state.joint) { state.wrapper = this; }
+
 		PxJoint* Get() { return joint; }
 	};
 
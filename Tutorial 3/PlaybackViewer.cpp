@@ -0,0 +1,343 @@
+#include "PlaybackViewer.h"
+#include "PhysicsEngine.h"
+#include "Extras\Camera.h"
+#include "Extras\Renderer.h"
+#include "Extras\HUD.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+namespace VisualDebugger
+{
+	using namespace std;
+	typedef std::chrono::high_resolution_clock Clock;
+
+	///Playback speeds selected with +/-
+	static const PxReal playback_speeds[] = { -8.f, -4.f, -2.f, -1.f, -0.5f, -0.25f, 0.25f, 0.5f, 1.f, 2.f, 4.f, 8.f };
+	static const int playback_speed_count = sizeof(playback_speeds)/sizeof(playback_speeds[0]);
+	static const int playback_normal_speed = 8;
+
+	///State of the playback window
+	struct PlaybackView
+	{
+		PhysicsEngine::MatchRecording recording;
+		RenderProxyStore store;
+		//first proxy of every actor in the store
+		vector<PxU32> actor_proxies;
+		//actors currently in the store
+		PxU32 first_actor, end_actor;
+		PxU32 frame;
+		//playback position in frames, between two frames while slowed down
+		double position;
+		int speed;
+		bool pause;
+		Clock::time_point last_time;
+		//cost of the last Show [ms]
+		PxReal decode_time;
+
+		Camera* camera;
+		HUD hud;
+		unsigned int status_line, speed_line, time_line;
+		int mouse_x, mouse_y;
+		bool scrubbing;
+		string filename;
+	};
+
+	static PlaybackView* view = 0;
+
+	///Decode a frame and move the proxies there
+	void ShowFrame(PlaybackView& v, PxU32 frame)
+	{
+		Clock::time_point start = Clock::now();
+
+		PhysicsEngine::MatchRecording& recording = v.recording;
+		recording.Seek(frame);
+		const PhysicsEngine::MatchRecording::Frame& info = recording.GetFrame(frame);
+
+		//the set of actors only changes when actors are spawned or the scene was reset
+		if ((info.first_actor != v.first_actor) || (info.end_actor != v.end_actor))
+		{
+			v.store.Clear();
+			v.actor_proxies.resize(recording.ActorCount());
+			for (PxU32 i = info.first_actor; i < info.end_actor; i++)
+			{
+				const PhysicsEngine::MatchRecording::Actor& actor = recording.GetActor(i);
+				vector<RenderProxy> shapes(recording.Shapes().begin() + actor.first_shape, recording.Shapes().begin() + actor.first_shape + actor.shape_count);
+				v.actor_proxies[i] = v.store.Add(shapes, recording.Pose(i));
+			}
+			v.first_actor = info.first_actor;
+			v.end_actor = info.end_actor;
+		}
+		else
+		{
+			for (PxU32 i = info.first_actor; i < info.end_actor; i++)
+			{
+				const PhysicsEngine::MatchRecording::Actor& actor = recording.GetActor(i);
+				if (actor.dynamic && actor.shape_count)
+					v.store.Move(v.actor_proxies[i], actor.shape_count, recording.Pose(i));
+			}
+			v.store.Flush();
+		}
+
+		v.frame = frame;
+		v.decode_time = std::chrono::duration<PxReal, std::milli>(Clock::now() - start).count();
+	}
+
+	///Decode every frame in order and a set of seeks without a window
+	int PlaybackBench(PlaybackView& v)
+	{
+		PxU32 count = v.recording.FrameCount();
+
+		Clock::time_point start = Clock::now();
+		for (PxU32 i = 0; i < count; i++)
+			ShowFrame(v, i);
+		double sequential = std::chrono::duration<double, std::milli>(Clock::now() - start).count()/count;
+
+		//backwards, so every seek starts again from a keyframe
+		start = Clock::now();
+		PxU32 seeks = 0;
+		for (PxU32 i = count; i > 0; i -= (i > 37) ? 37 : i, seeks++)
+			ShowFrame(v, i - 1);
+		double seek = std::chrono::duration<double, std::milli>(Clock::now() - start).count()/seeks;
+
+		double recorded = 0.;
+		for (PxU32 i = 0; i < count; i++)
+			recorded += v.recording.GetFrame(i).step_time;
+		recorded /= count;
+
+		cout << fixed << setprecision(4);
+		cout << "Playback of " << v.filename << ": " << count << " frames, " << v.recording.ActorCount() << " actors" << endl;
+		cout << "  playback " << sequential << " ms/frame, seek " << seek << " ms, recorded step " << recorded << " ms" << endl;
+		return 0;
+	}
+
+	void PlaybackStatus(PlaybackView& v)
+	{
+		const PhysicsEngine::MatchRecording::Frame& info = v.recording.GetFrame(v.frame);
+		v.hud.SetLine(0, v.status_line, "FRAME " + to_string(v.frame + 1) + " / " + to_string(v.recording.FrameCount()) +
+			" (step " + to_string(info.step) + "), " + to_string(info.end_actor - info.first_actor) + " actors");
+
+		char line[128];
+		snprintf(line, sizeof(line), "SPEED %.2fx%s", playback_speeds[v.speed], v.pause ? ", paused" : "");
+		v.hud.SetLine(0, v.speed_line, line);
+		snprintf(line, sizeof(line), "RECORDED STEP %.2f ms, PLAYBACK %.2f ms", info.step_time, v.decode_time);
+		v.hud.SetLine(0, v.time_line, line);
+	}
+
+	void PlaybackRender()
+	{
+		PlaybackView& v = *view;
+		PxU32 count = v.recording.FrameCount();
+
+		Clock::time_point now = Clock::now();
+		PxReal elapsed = std::chrono::duration<PxReal>(now - v.last_time).count();
+		v.last_time = now;
+
+		if (!v.pause && !v.scrubbing)
+		{
+			v.position += playback_speeds[v.speed]*elapsed/v.recording.DeltaTime();
+			//stop at either end
+			if ((v.position <= 0.) || (v.position >= count - 1))
+			{
+				v.position = PxClamp(v.position, 0., (double)(count - 1));
+				v.pause = true;
+			}
+		}
+
+		PxU32 frame = (PxU32)v.position;
+		if (frame != v.frame)
+			ShowFrame(v, frame);
+		PlaybackStatus(v);
+
+		Renderer::Start(v.camera->getEye(), v.camera->getDir());
+		Renderer::Render(v.store);
+		v.hud.Render();
+		Renderer::Finish();
+	}
+
+	void PlaybackKeyPress(unsigned char key, int x, int y)
+	{
+		PlaybackView& v = *view;
+		PxReal step = 1.f/60.f;
+
+		switch (toupper(key))
+		{
+		case 27:
+			exit(0);
+			break;
+		case ' ':
+			v.pause = !v.pause;
+			break;
+		case '+':
+		case '=':
+			v.speed = PxMin(v.speed + 1, playback_speed_count - 1);
+			v.pause = false;
+			break;
+		case '-':
+			v.speed = PxMax(v.speed - 1, 0);
+			v.pause = false;
+			break;
+		case '1':
+			v.speed = playback_normal_speed;
+			break;
+		case 'W':
+			v.camera->MoveForward(step);
+			break;
+		case 'S':
+			v.camera->MoveBackward(step);
+			break;
+		case 'A':
+			v.camera->MoveLeft(step);
+			break;
+		case 'D':
+			v.camera->MoveRight(step);
+			break;
+		case 'Q':
+			v.camera->MoveUp(step);
+			break;
+		case 'Z':
+			v.camera->MoveDown(step);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void PlaybackKeySpecial(int key, int x, int y)
+	{
+		PlaybackView& v = *view;
+		double last = v.recording.FrameCount() - 1;
+		//ten seconds
+		double jump = 10./v.recording.DeltaTime();
+
+		switch (key)
+		{
+		case GLUT_KEY_RIGHT:
+			v.position = PxMin(floor(v.position) + 1., last);
+			v.pause = true;
+			break;
+		case GLUT_KEY_LEFT:
+			v.position = PxMax(floor(v.position) - 1., 0.);
+			v.pause = true;
+			break;
+		case GLUT_KEY_PAGE_UP:
+			v.position = PxMin(v.position + jump, last);
+			break;
+		case GLUT_KEY_PAGE_DOWN:
+			v.position = PxMax(v.position - jump, 0.);
+			break;
+		case GLUT_KEY_HOME:
+			v.position = 0.;
+			break;
+		case GLUT_KEY_END:
+			v.position = last;
+			break;
+		case GLUT_KEY_F8:
+			v.camera->Reset();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void PlaybackMouse(int button, int state, int x, int y)
+	{
+		PlaybackView& v = *view;
+		v.mouse_x = x;
+		v.mouse_y = y;
+		//the right button scrubs: the window width is the whole recording
+		v.scrubbing = (button == GLUT_RIGHT_BUTTON) && (state == GLUT_DOWN);
+	}
+
+	void PlaybackMotion(int x, int y)
+	{
+		PlaybackView& v = *view;
+		if (v.scrubbing)
+			v.position = PxClamp((double)x/PxMax(Renderer::WindowWidth(), 1), 0., 1.)*(v.recording.FrameCount() - 1);
+		else
+			v.camera->Motion(v.mouse_x - x, v.mouse_y - y, 1.f/60.f);
+
+		v.mouse_x = x;
+		v.mouse_y = y;
+	}
+
+	void PlaybackExit()
+	{
+		delete view->camera;
+		delete view;
+		view = 0;
+		PhysicsEngine::PxRelease();
+	}
+
+	int Playback(const PlaybackSettings& settings)
+	{
+		view = new PlaybackView();
+		PlaybackView& v = *view;
+		v.filename = settings.filename;
+		if (!v.recording.Open(settings.filename) || !v.recording.FrameCount())
+		{
+			cerr << "Playback: nothing to show in " << settings.filename << endl;
+			return 1;
+		}
+
+		v.first_actor = v.end_actor = (PxU32)-1;
+		v.frame = (PxU32)-1;
+		v.position = 0.;
+		v.speed = playback_normal_speed;
+		v.pause = false;
+		v.decode_time = 0.f;
+		v.mouse_x = v.mouse_y = 0;
+		v.scrubbing = false;
+		v.camera = 0;
+
+		if (settings.bench)
+			return PlaybackBench(v);
+
+		try
+		{
+			//only the SDK, the renderer registers with it, there is no scene
+			PhysicsEngine::PxInit();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
+		Renderer::SetRenderDetail(40);
+		Renderer::InitWindow(("Playback - " + settings.filename).c_str(), 800, 800);
+		Renderer::Init();
+
+		v.camera = new Camera(PxVec3(0.0f, 10.0f, 20.0f), PxVec3(0.f,-.1f,-1.f), 5.f);
+
+		v.hud.AddLine(0, "PLAYBACK " + settings.filename);
+		v.status_line = v.hud.AddLine(0, "");
+		v.speed_line = v.hud.AddLine(0, "");
+		v.time_line = v.hud.AddLine(0, "");
+		v.hud.AddLine(0, " ");
+		v.hud.AddLine(0, "Space: pause, +/-: speed, 1: normal speed");
+		v.hud.AddLine(0, "Left/Right: step, PgUp/PgDn: 10 s, Home/End");
+		v.hud.AddLine(0, "Right mouse button + drag: scrub");
+		v.hud.AddLine(0, "W,S,A,D,Q,Z + mouse: camera, F8: reset view");
+		v.hud.FontSize(0.018f);
+		v.hud.Color(PxVec3(0.f,0.f,0.f));
+		v.hud.ActiveScreen(0);
+
+		glutDisplayFunc(PlaybackRender);
+		glutKeyboardFunc(PlaybackKeyPress);
+		glutSpecialFunc(PlaybackKeySpecial);
+		glutMouseFunc(PlaybackMouse);
+		glutMotionFunc(PlaybackMotion);
+		atexit(PlaybackExit);
+
+		v.last_time = Clock::now();
+		glutMainLoop();
+		return 0;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Playback options
+	struct PlaybackSettings
+	{
+		//match recording written by the game ('E')
+		std::string filename;
+		//decode every frame headless and report the cost instead of opening a window
+		bool bench;
+
+		PlaybackSettings() : bench(false) {}
+	};
+
+	///Show a match recording through the renderer without simulating it: no PxScene is created.
+	///Space pauses, +/- change the speed (negative plays backwards), arrows step, right mouse button drag scrubs.
+	int Playback(const PlaybackSettings& settings);
+}
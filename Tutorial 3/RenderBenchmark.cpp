@@ -0,0 +1,143 @@
+#include "RenderBenchmark.h"
+#include "MyPhysicsEngine.h"
+#include "Extras\Renderer.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <chrono>
+
+namespace VisualDebugger
+{
+	using namespace std;
+
+	///Camera paths, parametrised by t in [0,1]
+	enum CameraPath
+	{
+		PATH_SIDELINE,	//along the touchline, looking across the field
+		PATH_ORBIT,		//a full circle above the field
+		PATH_KICKER,	//from behind the catapult towards the goal
+		PATH_COUNT
+	};
+
+	const char* path_names[PATH_COUNT] = { "sideline", "orbit", "kicker" };
+
+	//extra balls spawned on top of the rugby scene
+	const PxU32 ball_counts[] = { 0, 100, 1000 };
+
+	//simulation steps before measuring, lets spawned actors settle
+	const PxU32 warmup_steps = 120;
+
+	void CameraPose(CameraPath path, PxReal t, PxVec3& eye, PxVec3& dir)
+	{
+		PxVec3 target;
+		switch (path)
+		{
+		case PATH_SIDELINE:
+			eye = PxVec3(-60.f, 15.f, 10.f - 120.f*t);
+			target = PxVec3(0.f, 0.f, eye.z);
+			break;
+		case PATH_ORBIT:
+			eye = PxVec3(90.f*PxSin(PxTwoPi*t), 40.f, -50.f + 90.f*PxCos(PxTwoPi*t));
+			target = PxVec3(0.f, 0.f, -50.f);
+			break;
+		default:
+			eye = PxVec3(0.f, 10.f + 15.f*t, 20.f - 80.f*t);
+			target = PxVec3(0.f, 10.f, -100.f);
+			break;
+		}
+		dir = (target - eye).getNormalized();
+	}
+
+	int RenderBenchmark(const RenderBenchmarkSettings& settings)
+	{
+		PhysicsEngine::MyScene* scene;
+
+		try
+		{
+			PhysicsEngine::PxInit();
+			scene = new PhysicsEngine::MyScene();
+			scene->Init();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		if (!Renderer::InitOffscreen(settings.width, settings.height))
+		{
+			cerr << "RenderBenchmark: could not create an offscreen context." << endl;
+			delete scene;
+			PhysicsEngine::PxRelease();
+			return 1;
+		}
+
+		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
+		Renderer::SetRenderDetail(40);
+		Renderer::ShowShadows(settings.shadows);
+		Renderer::SetShadowQuality(settings.shadow_quality);
+		Renderer::SetShadowResolution(settings.shadow_resolution);
+		Renderer::Init();
+
+		const char* quality_names[] = { "low", "medium", "high" };
+		cout << "Render benchmark " << settings.width << "x" << settings.height << ", " << settings.frames << " frames per path, shadows ";
+		if (settings.shadows)
+			cout << quality_names[settings.shadow_quality] << " " << settings.shadow_resolution << "px" << endl;
+		else
+			cout << "off" << endl;
+		cout << setw(8) << "actors" << setw(10) << "path" << setw(10) << "ms/frame" << setw(10) << "min" << setw(10) << "max" << setw(10) << "shapes" << endl;
+
+		for (PxU32 i = 0; i < sizeof(ball_counts)/sizeof(ball_counts[0]); i++)
+		{
+			scene->Reset();
+			for (PxU32 j = 0; j < ball_counts[i]; j++)
+				scene->spawnBalls();
+
+			for (PxU32 j = 0; j < warmup_steps; j++)
+				scene->Update(1.f/60.f);
+
+			PxU32 nb_actors = scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC | PxActorTypeSelectionFlag::eCLOTH);
+
+			for (int path = 0; path < PATH_COUNT; path++)
+			{
+				double total = 0., min_time = 1e9, max_time = 0.;
+
+				for (PxU32 frame = 0; frame < settings.frames; frame++)
+				{
+					PxVec3 eye, dir;
+					CameraPose((CameraPath)path, (PxReal)frame/(PxReal)PxMax(settings.frames - 1, 1u), eye, dir);
+
+					std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+					Renderer::Start(eye, dir);
+					Renderer::Render(scene->GetRenderProxies());
+					//Finish waits for the GL to complete the frame
+					Renderer::Finish();
+
+					double time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count()/1000.;
+					total += time;
+					min_time = PxMin(min_time, time);
+					max_time = PxMax(max_time, time);
+
+					if (settings.dump_prefix.size())
+					{
+						stringstream filename;
+						filename << settings.dump_prefix << nb_actors << "_" << path_names[path] << "_" << setfill('0') << setw(4) << frame << ".tga";
+						if (!Renderer::SaveFrame(filename.str()))
+							cerr << "RenderBenchmark: could not write " << filename.str() << endl;
+					}
+				}
+
+				cout << setw(8) << nb_actors << setw(10) << path_names[path] << fixed << setprecision(3) << setw(10) << (total/settings.frames)
+					<< setw(10) << min_time << setw(10) << max_time << setw(10) << Renderer::GetStats().shapes << endl;
+			}
+		}
+
+		delete scene;
+		PhysicsEngine::PxRelease();
+
+		return 0;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+#include "Extras\Renderer.h"
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Render benchmark options
+	struct RenderBenchmarkSettings
+	{
+		//framebuffer size
+		int width, height;
+		//frames rendered along each camera path
+		PxU32 frames;
+		//save every frame as <dump_prefix><actors>_<path>_<frame>.tga (empty = no dump)
+		std::string dump_prefix;
+		//shadow pass on/off, its quality and requested map size
+		bool shadows;
+		Renderer::ShadowQuality shadow_quality;
+		PxU32 shadow_resolution;
+
+		RenderBenchmarkSettings() : width(800), height(800), frames(300), shadows(true), shadow_quality(Renderer::SHADOW_MEDIUM), shadow_resolution(2048) {}
+	};
+
+	///Replay fixed camera paths over the rugby scene at several actor counts and report ms/frame.
+	///Renders offscreen, so it runs without a display when built with RENDER_OSMESA (the default outside of Windows).
+	///Without it a display is needed, the benchmark fails with an error if there is none.
+	int RenderBenchmark(const RenderBenchmarkSettings& settings);
+}
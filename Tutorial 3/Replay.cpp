@@ -0,0 +1,88 @@
+#include "Replay.h"
+#include "MyPhysicsEngine.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	int Replay(const ReplaySettings& settings)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		ActionFile recording;
+		if (!recording.Load(settings.filename))
+			return 1;
+
+		MyScene* scene;
+
+		try
+		{
+			PxInit((MemoryBackend)recording.header.backend);
+			scene = new MyScene();
+			scene->Init();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		//the same start as the recording: seed, then a reset
+		scene->Seed(recording.header.seed);
+		scene->Reset();
+
+		cout << "Replay of " << settings.filename << ", seed " << recording.header.seed << ", " << recording.steps << " steps, "
+			<< recording.actions.size() << " actions" << (recording.complete ? "" : " (no end, the recording was not stopped)") << endl;
+
+		if (settings.trace.size())
+			Profiler::BeginCapture();
+
+		vector<pair<double, PxU32> > times(recording.steps);
+		size_t next = 0;
+		for (PxU32 step = 0; step < recording.steps; step++)
+		{
+			while ((next < recording.actions.size()) && (recording.actions[next].step == step))
+				scene->Queue(recording.actions[next++].type);
+
+			Clock::time_point start = Clock::now();
+			scene->Update(recording.header.delta_time);
+			times[step] = make_pair(std::chrono::duration<double, std::milli>(Clock::now() - start).count(), step);
+		}
+
+		if (settings.trace.size())
+		{
+			if (Profiler::EndCapture(settings.trace))
+				cout << "Saved trace to " << settings.trace << endl;
+			else
+				cerr << "Could not write " << settings.trace << endl;
+		}
+
+		PxU64 hash = scene->Hash();
+		delete scene;
+		PxRelease();
+
+		//the slowest steps, e.g. to find a reported spike in the trace
+		sort(times.begin(), times.end(), greater<pair<double, PxU32> >());
+		cout << "Slowest steps [ms]:" << fixed << setprecision(3);
+		for (size_t i = 0; (i < 5) && (i < times.size()); i++)
+			cout << " " << times[i].second << " (" << times[i].first << ")";
+		cout << endl;
+
+		if (!recording.complete)
+			return 0;
+
+		if (hash != recording.hash)
+		{
+			cout << "State after the replay DIFFERS from the recording (" << hex << hash << " vs " << recording.hash << dec << ")" << endl;
+			return 2;
+		}
+		cout << "State after the replay matches the recording" << endl;
+		return 0;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Replay options
+	struct ReplaySettings
+	{
+		//recording written by the game ('N')
+		std::string filename;
+		//write a profiler trace of the whole replay (empty = off)
+		std::string trace;
+	};
+
+	///Replay a recording of gameplay actions headless with its seed and step length, report the slowest steps
+	///and check that it ends in the recorded state. Returns 2 if the state differs, 1 on errors, 0 otherwise.
+	int Replay(const ReplaySettings& settings);
+}
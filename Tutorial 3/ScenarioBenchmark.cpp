@@ -0,0 +1,300 @@
+#include "ScenarioBenchmark.h"
+#include "MyPhysicsEngine.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	void NoSetup(MyScene& scene) {}
+	void NoStep(MyScene& scene, PxU32 step) {}
+
+	void Spawn100Balls(MyScene& scene) { scene.spawn100Balls(); }
+	void Spawn1000Balls(MyScene& scene) { scene.spawn1000Balls(); }
+
+	void SpawnJoust(MyScene& scene)
+	{
+		for (int i = 0; i < 5; i++)
+			scene.spawnJoust();
+	}
+
+	void SpawnFlags(MyScene& scene) { scene.spawnFlags(20); }
+
+	void FieldGoals(MyScene& scene, PxU32 step)
+	{
+		//one kick every two seconds
+		if (step % 120 == 0)
+			scene.fieldGoal();
+	}
+
+	void CannonBarrage(MyScene& scene, PxU32 step)
+	{
+		if (step % 60 == 0)
+			scene.cannonReset();
+		else if (step % 60 == 1)
+			scene.cannonForce();
+	}
+
+	const Scenario scenarios[] =
+	{
+		{ "idle", NoSetup, NoStep },
+		{ "field_goals", NoSetup, FieldGoals },
+		{ "balls_100", Spawn100Balls, NoStep },
+		{ "balls_1000", Spawn1000Balls, NoStep },
+		{ "joust_x5", SpawnJoust, NoStep },
+		{ "cannon_barrage", NoSetup, CannonBarrage },
+		{ "cloth_flags", SpawnFlags, NoStep },
+	};
+
+	const Scenario* Scenarios(PxU32& count)
+	{
+		count = sizeof(scenarios)/sizeof(scenarios[0]);
+		return scenarios;
+	}
+
+	const Scenario* FindScenario(const string& name)
+	{
+		for (size_t i = 0; i < sizeof(scenarios)/sizeof(scenarios[0]); i++)
+			if (name == scenarios[i].name)
+				return &scenarios[i];
+		return 0;
+	}
+
+	///Step time statistics of a scenario [ms]
+	struct ScenarioResult
+	{
+		string name;
+		PxU32 actors;
+		//time to reach the measured state, reset, setup and warmup or loading a checkpoint
+		double start;
+		double mean, p50, p95, p99, max;
+		double gameplay, simulate, fetch;
+	};
+
+	double Percentile(const vector<double>& sorted, PxU32 percent)
+	{
+		return sorted[(sorted.size() - 1)*percent/100];
+	}
+
+	double Mean(const vector<double>& values)
+	{
+		double sum = 0.;
+		for (size_t i = 0; i < values.size(); i++)
+			sum += values[i];
+		return sum/values.size();
+	}
+
+	bool RunScenario(MyScene& scene, const Scenario& scenario, const ScenarioBenchmarkSettings& settings, ScenarioResult& result)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		const PxReal delta_time = 1.f/60.f;
+
+		Clock::time_point start = Clock::now();
+		if (settings.checkpoint.size())
+		{
+			//the settled scene of an earlier run, with its random numbers
+			if (!scene.Load(settings.checkpoint + scenario.name + ".pxck"))
+				return false;
+		}
+		else
+		{
+			//every scenario starts from a fresh scene and the same seed
+			scene.Seed(settings.seed);
+			scene.Reset();
+			scenario.setup(scene);
+
+			for (PxU32 i = 0; i < settings.warmup; i++)
+			{
+				scenario.step(scene, i);
+				scene.Update(delta_time);
+			}
+		}
+		result.start = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		if (settings.save_checkpoint.size() && !scene.Save(settings.save_checkpoint + scenario.name + ".pxck"))
+			return false;
+
+		vector<double> times(settings.steps), gameplay(settings.steps), simulate(settings.steps), fetch(settings.steps);
+		for (PxU32 i = 0; i < settings.steps; i++)
+		{
+			scenario.step(scene, settings.warmup + i);
+
+			Clock::time_point start = Clock::now();
+			scene.Update(delta_time);
+			times[i] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			gameplay[i] = scene.GetStepTimes().gameplay;
+			simulate[i] = scene.GetStepTimes().simulate;
+			fetch[i] = scene.GetStepTimes().fetch;
+		}
+
+		result.name = scenario.name;
+		result.actors = scene.Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC | PxActorTypeSelectionFlag::eCLOTH);
+		result.mean = Mean(times);
+		result.gameplay = Mean(gameplay);
+		result.simulate = Mean(simulate);
+		result.fetch = Mean(fetch);
+
+		sort(times.begin(), times.end());
+		result.p50 = Percentile(times, 50);
+		result.p95 = Percentile(times, 95);
+		result.p99 = Percentile(times, 99);
+		result.max = times.back();
+		return true;
+	}
+
+	void WriteJSON(ostream& out, const ScenarioBenchmarkSettings& settings, const vector<ScenarioResult>& results)
+	{
+		out << fixed << setprecision(4);
+		out << "{\n  \"seed\": " << settings.seed << ",\n  \"warmup\": " << settings.warmup << ",\n  \"steps\": " << settings.steps << ",\n  \"scenarios\": [\n";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const ScenarioResult& r = results[i];
+			out << "    { \"name\": \"" << r.name << "\", \"actors\": " << r.actors
+				<< ", \"mean_ms\": " << r.mean << ", \"p50_ms\": " << r.p50 << ", \"p95_ms\": " << r.p95
+				<< ", \"p99_ms\": " << r.p99 << ", \"max_ms\": " << r.max << ", \"start_ms\": " << r.start
+				<< ", \"gameplay_ms\": " << r.gameplay << ", \"simulate_ms\": " << r.simulate << ", \"fetch_ms\": " << r.fetch
+				<< " }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n}\n";
+	}
+
+	///Find a number field of a scenario object written by WriteJSON
+	bool ReadField(const string& object, const string& field, double& value)
+	{
+		size_t pos = object.find("\"" + field + "\":");
+		if (pos == string::npos)
+			return false;
+		return sscanf(object.c_str() + pos + field.size() + 3, "%lf", &value) == 1;
+	}
+
+	///Read the mean and p95 step times of every scenario in a results file
+	bool ReadBaseline(const string& filename, map<string, pair<double, double> >& baseline)
+	{
+		ifstream file(filename.c_str());
+		if (!file)
+			return false;
+
+		stringstream text;
+		text << file.rdbuf();
+		string json = text.str();
+
+		//one scenario object per brace pair after the list starts
+		size_t pos = json.find("\"scenarios\"");
+		while ((pos != string::npos) && ((pos = json.find('{', pos)) != string::npos))
+		{
+			size_t end = json.find('}', pos);
+			if (end == string::npos)
+				break;
+			string object = json.substr(pos, end - pos);
+			pos = end;
+
+			size_t name = object.find("\"name\": \"");
+			double mean, p95;
+			if ((name == string::npos) || !ReadField(object, "mean_ms", mean) || !ReadField(object, "p95_ms", p95))
+				continue;
+			name += 9;
+			baseline[object.substr(name, object.find('"', name) - name)] = make_pair(mean, p95);
+		}
+		return true;
+	}
+
+	int ScenarioBenchmark(const ScenarioBenchmarkSettings& settings)
+	{
+		MyScene* scene;
+
+		try
+		{
+			PxInit(settings.backend);
+			scene = new MyScene();
+			scene->Init();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+
+		cout << "Scenario benchmark, seed " << settings.seed << ", " << settings.warmup << " warmup + " << settings.steps << " measured steps" << endl;
+		cout << setw(16) << "scenario" << setw(8) << "actors" << setw(10) << "mean" << setw(10) << "p50" << setw(10) << "p95" << setw(10) << "p99" << setw(10) << "max"
+			<< setw(10) << "start" << endl;
+
+		vector<ScenarioResult> results;
+		for (size_t i = 0; i < sizeof(scenarios)/sizeof(scenarios[0]); i++)
+		{
+			if (settings.scenario.size() && (settings.scenario != scenarios[i].name))
+				continue;
+
+			ScenarioResult r;
+			if (!RunScenario(*scene, scenarios[i], settings, r))
+			{
+				delete scene;
+				PxRelease();
+				return 1;
+			}
+			results.push_back(r);
+
+			cout << setw(16) << r.name << setw(8) << r.actors << fixed << setprecision(3) << setw(10) << r.mean << setw(10) << r.p50
+				<< setw(10) << r.p95 << setw(10) << r.p99 << setw(10) << r.max << setw(10) << r.start << endl;
+		}
+
+		delete scene;
+		PxRelease();
+
+		if (results.empty())
+		{
+			cerr << "ScenarioBenchmark: unknown scenario " << settings.scenario << endl;
+			return 1;
+		}
+
+		if (settings.json.size())
+		{
+			ofstream file(settings.json.c_str());
+			if (!file)
+			{
+				cerr << "ScenarioBenchmark: could not write " << settings.json << endl;
+				return 1;
+			}
+			WriteJSON(file, settings, results);
+		}
+
+		if (settings.baseline.empty())
+			return 0;
+
+		map<string, pair<double, double> > baseline;
+		if (!ReadBaseline(settings.baseline, baseline))
+		{
+			cerr << "ScenarioBenchmark: could not read " << settings.baseline << endl;
+			return 1;
+		}
+
+		//a scenario regresses if its mean or p95 step time grew beyond the tolerance
+		int regressions = 0;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			map<string, pair<double, double> >::const_iterator it = baseline.find(results[i].name);
+			if (it == baseline.end())
+			{
+				cout << results[i].name << ": not in the baseline" << endl;
+				continue;
+			}
+
+			double limit = 1. + settings.tolerance;
+			bool regressed = (results[i].mean > it->second.first*limit) || (results[i].p95 > it->second.second*limit);
+			cout << results[i].name << ": mean " << results[i].mean << " ms (baseline " << it->second.first << "), p95 "
+				<< results[i].p95 << " ms (baseline " << it->second.second << ")" << (regressed ? " REGRESSION" : "") << endl;
+			regressions += regressed;
+		}
+
+		return regressions ? 2 : 0;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+#include "Extras\TrackingAllocator.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	class MyScene;
+
+	///A named workload: setup runs once after the scene is created, step before every simulation step
+	struct Scenario
+	{
+		const char* name;
+		void (*setup)(MyScene& scene);
+		void (*step)(MyScene& scene, PxU32 step);
+	};
+
+	///The scenarios of the benchmark, also used by the determinism check
+	const Scenario* Scenarios(PxU32& count);
+
+	///Find a scenario by name, 0 if there is none
+	const Scenario* FindScenario(const std::string& name);
+
+	///Scenario benchmark options
+	struct ScenarioBenchmarkSettings
+	{
+		//run only the scenario with this name (empty = all)
+		std::string scenario;
+		//steps simulated before and while measuring
+		PxU32 warmup, steps;
+		//seed of the game's random numbers
+		unsigned int seed;
+		//write the results as JSON (empty = stdout only)
+		std::string json;
+		//compare with the JSON of an earlier run (empty = no comparison)
+		std::string baseline;
+		//allowed slowdown against the baseline, 0.1 = 10%
+		double tolerance;
+		//memory of the SDK and the wrappers
+		MemoryBackend backend;
+		//write the scene after the warmup to <prefix><scenario>.pxck (empty = off)
+		std::string save_checkpoint;
+		//start from <prefix><scenario>.pxck instead of a reset and the warmup (empty = off)
+		std::string checkpoint;
+
+		ScenarioBenchmarkSettings() : warmup(120), steps(600), seed(1), tolerance(0.1), backend(MEMORY_HEAP) {}
+	};
+
+	///Run named scenarios of the rugby scene headless with fixed seeds and step counts and report step times.
+	///Returns 2 if a scenario regressed against the baseline, 1 on errors, 0 otherwise.
+	int ScenarioBenchmark(const ScenarioBenchmarkSettings& settings);
+}
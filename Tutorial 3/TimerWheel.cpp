@@ -0,0 +1,197 @@
+#include "TimerWheel.h"
+
+namespace PhysicsEngine
+{
+	TimerWheel::TimerWheel(PxReal _tick_length) : tick_length(_tick_length)
+	{
+		Clear();
+	}
+
+	void TimerWheel::Clear(PxReal time)
+	{
+		events.clear();
+		free_list = NONE;
+		for (PxU32 i = 0; i < LEVELS*SLOTS; i++)
+			slots[i] = NONE;
+		next_tick = (PxU64)(time/tick_length + 0.5f) + 1;
+		pending = 0.;
+		count = 0;
+	}
+
+	void TimerWheel::Insert(PxU32 index)
+	{
+		Event& e = events[index];
+		if (e.expires < next_tick)
+			e.expires = next_tick;
+
+		//the level is chosen by the distance, the slot by the expiry tick at that level
+		PxU64 delta = e.expires - next_tick;
+		PxU32 level = 0;
+		while ((level < LEVELS-1) && (delta >= ((PxU64)1 << (SLOT_BITS*(level+1)))))
+			level++;
+		//delays are capped to the range of the wheel (2^24 ticks, ~77 hours at 60Hz)
+		if (delta >= ((PxU64)1 << (SLOT_BITS*LEVELS)))
+			e.expires = next_tick + ((PxU64)1 << (SLOT_BITS*LEVELS)) - 1;
+
+		e.slot = level*SLOTS + (PxU32)((e.expires >> (SLOT_BITS*level)) & SLOT_MASK);
+		e.prev = NONE;
+		e.next = slots[e.slot];
+		if (e.next != NONE)
+			events[e.next].prev = index;
+		slots[e.slot] = index;
+	}
+
+	void TimerWheel::Unlink(PxU32 index)
+	{
+		Event& e = events[index];
+		if (e.slot == NONE)
+			return;
+
+		if (e.prev != NONE)
+			events[e.prev].next = e.next;
+		else
+			slots[e.slot] = e.next;
+		if (e.next != NONE)
+			events[e.next].prev = e.prev;
+		e.slot = NONE;
+	}
+
+	void TimerWheel::Release(PxU32 index)
+	{
+		Event& e = events[index];
+		e.callback = nullptr;
+		e.active = false;
+		e.generation++;
+		e.next = free_list;
+		free_list = index;
+		count--;
+	}
+
+	void TimerWheel::Cascade(PxU32 level)
+	{
+		PxU32 slot = level*SLOTS + (PxU32)((next_tick >> (SLOT_BITS*level)) & SLOT_MASK);
+		PxU32 index = slots[slot];
+		slots[slot] = NONE;
+		while (index != NONE)
+		{
+			PxU32 next = events[index].next;
+			Insert(index);
+			index = next;
+		}
+	}
+
+	TimerWheel::Id TimerWheel::Schedule(PxReal delay, std::function<void()> callback, PxReal period)
+	{
+		PxU32 index = free_list;
+		if (index != NONE)
+			free_list = events[index].next;
+		else
+		{
+			index = (PxU32)events.size();
+			events.push_back(Event());
+			events[index].generation = 1;
+		}
+
+		Event& e = events[index];
+		e.callback = callback;
+		//at least one tick, an event never runs in the tick it was scheduled in
+		PxU64 ticks = (PxU64)(delay/tick_length + 0.5f);
+		e.expires = (next_tick - 1) + (ticks ? ticks : 1);
+		e.period = (period > 0.f) ? PxMax((PxU32)(period/tick_length + 0.5f), (PxU32)1) : 0;
+		e.active = true;
+		e.slot = NONE;
+		Insert(index);
+		count++;
+
+		return ((Id)e.generation << 32) | index;
+	}
+
+	TimerWheel::Id TimerWheel::ScheduleAt(PxReal first, std::function<void()> callback, PxReal period)
+	{
+		//in ticks, so that the phase of a restarted wheel does not drift
+		PxU64 now = next_tick - 1;
+		PxU64 expires = (PxU64)(first/tick_length + 0.5f);
+		PxU64 ticks = (period > 0.f) ? PxMax((PxU64)(period/tick_length + 0.5f), (PxU64)1) : 0;
+		if ((expires <= now) && ticks)
+			expires += ((now - expires)/ticks + 1)*ticks;
+
+		return Schedule((expires > now) ? (expires - now)*tick_length : 0.f, callback, period);
+	}
+
+	PxReal TimerWheel::Remaining(Id id) const
+	{
+		PxU32 index = (PxU32)(id & 0xffffffff);
+		if (!id || (index >= events.size()) || (events[index].generation != (PxU32)(id >> 32)) || !events[index].active)
+			return -1.f;
+
+		return (PxReal)(events[index].expires - (next_tick - 1))*tick_length;
+	}
+
+	bool TimerWheel::Cancel(Id id)
+	{
+		PxU32 index = (PxU32)(id & 0xffffffff);
+		if (!id || (index >= events.size()) || (events[index].generation != (PxU32)(id >> 32)) || !events[index].active)
+			return false;
+
+		//a running event is released by Advance once its callback returns
+		events[index].active = false;
+		if (events[index].slot != NONE)
+		{
+			Unlink(index);
+			Release(index);
+		}
+		return true;
+	}
+
+	void TimerWheel::Advance(PxReal dt)
+	{
+		pending += dt/tick_length;
+		//steps of exactly one tick should not drift into an extra or a missing tick
+		while (pending > 1. - 1e-4)
+		{
+			pending -= 1.;
+
+			//bring the events of the next 64 ticks down to the first level
+			for (PxU32 level = 1; level < LEVELS; level++)
+			{
+				if ((next_tick >> (SLOT_BITS*(level-1))) & SLOT_MASK)
+					break;
+				Cascade(level);
+			}
+
+			PxU32 slot = (PxU32)(next_tick & SLOT_MASK);
+			PxU32 index = slots[slot];
+			slots[slot] = NONE;
+			PxU64 tick = next_tick++;
+
+			//detached, so cancelling them from a callback only marks them inactive
+			for (PxU32 i = index; i != NONE; i = events[i].next)
+				events[i].slot = NONE;
+
+			while (index != NONE)
+			{
+				PxU32 next = events[index].next;
+
+				if (events[index].active)
+				{
+					//callbacks may schedule events and grow the event list
+					std::function<void()> callback = std::move(events[index].callback);
+					callback();
+
+					Event& e = events[index];
+					if (e.active && e.period)
+					{
+						e.callback = std::move(callback);
+						e.expires = tick + e.period;
+						Insert(index);
+						index = next;
+						continue;
+					}
+				}
+
+				Release(index);
+				index = next;
+			}
+		}
+	}
+}
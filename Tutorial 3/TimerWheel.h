@@ -0,0 +1,86 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+#include <functional>
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Schedules callbacks on simulation time.
+	///A hierarchical timer wheel: 4 levels of 64 slots, O(1) schedule and cancel,
+	///events further away are moved down a level whenever the level below wraps around.
+	class TimerWheel
+	{
+	public:
+		///Identifies a scheduled event, 0 is never used
+		typedef PxU64 Id;
+
+	private:
+		static const PxU32 LEVELS = 4;
+		static const PxU32 SLOT_BITS = 6;
+		static const PxU32 SLOTS = 1 << SLOT_BITS;
+		static const PxU32 SLOT_MASK = SLOTS - 1;
+		static const PxU32 NONE = 0xffffffff;
+
+		struct Event
+		{
+			std::function<void()> callback;
+			PxU64 expires;
+			//0 = one shot
+			PxU32 period;
+			//links of the slot list or the free list
+			PxU32 next, prev;
+			//slot list the event is in, NONE while it runs or is free
+			PxU32 slot;
+			//bumped on reuse so stale ids do not cancel other events
+			PxU32 generation;
+			bool active;
+		};
+
+		std::vector<Event> events;
+		PxU32 free_list;
+		PxU32 slots[LEVELS*SLOTS];
+		//next tick to be processed
+		PxU64 next_tick;
+		PxReal tick_length;
+		//fraction of a tick carried over between Advance calls
+		PxF64 pending;
+		PxU32 count;
+
+		void Insert(PxU32 index);
+		void Unlink(PxU32 index);
+		void Release(PxU32 index);
+		void Cascade(PxU32 level);
+
+	public:
+		///tick_length - resolution of the wheel [s], use the simulation step
+		TimerWheel(PxReal tick_length=1.f/60.f);
+
+		///Call callback after delay seconds of simulation time, then every period seconds if period > 0
+		Id Schedule(PxReal delay, std::function<void()> callback, PxReal period=0.f);
+
+		///Call callback at time first, then every period seconds if period > 0.
+		///Runs of a periodic event that are already past are skipped, e.g. when the wheel was restarted later.
+		Id ScheduleAt(PxReal first, std::function<void()> callback, PxReal period=0.f);
+
+		///Remove a pending event, returns false if it already ran or was cancelled
+		bool Cancel(Id id);
+
+		///Move simulation time forward and run the events that became due, in order
+		void Advance(PxReal dt);
+
+		///Remove all events and restart the time, e.g. at the time of a checkpoint
+		void Clear(PxReal time=0.f);
+
+		///Time until a pending event runs [s], -1 if it already ran or was cancelled
+		PxReal Remaining(Id id) const;
+
+		///Simulation time of the last processed tick [s]
+		PxReal Time() const { return (PxReal)((next_tick - 1)*tick_length); }
+
+		///Number of pending events
+		PxU32 Pending() const { return count; }
+	};
+}
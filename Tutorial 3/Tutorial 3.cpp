@@ -1,13 +1,168 @@
 #include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <stdio.h>
 #include "VisualDebugger.h"
+#include "RenderBenchmark.h"
+#include "ScenarioBenchmark.h"
+#include "DeterminismCheck.h"
+#include "Replay.h"
+#include "PlaybackViewer.h"
 
 using namespace std;
 
-int main()
+///Parse a --memory option
+PhysicsEngine::MemoryBackend MemoryBackend(const string& value)
 {
+	if (value == "pools")
+		return PhysicsEngine::MEMORY_POOLS;
+	if (value != "heap")
+		cerr << "Unknown memory backend " << value << ", using heap" << endl;
+	return PhysicsEngine::MEMORY_HEAP;
+}
+
+///Parse a --shadows option, off leaves the quality as it is
+void ShadowOption(const string& value, VisualDebugger::RenderBenchmarkSettings& settings)
+{
+	settings.shadows = (value != "off");
+	if (value == "low")
+		settings.shadow_quality = VisualDebugger::Renderer::SHADOW_LOW;
+	else if (value == "medium")
+		settings.shadow_quality = VisualDebugger::Renderer::SHADOW_MEDIUM;
+	else if (value == "high")
+		settings.shadow_quality = VisualDebugger::Renderer::SHADOW_HIGH;
+	else if (value != "off")
+		cerr << "Unknown shadow quality " << value << ", using medium" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	//headless render benchmark: --render-bench [--frames N] [--size WxH] [--dump prefix] [--shadows off|low|medium|high] [--shadow-size N]
+	if ((argc > 1) && (string(argv[1]) == "--render-bench"))
+	{
+		VisualDebugger::RenderBenchmarkSettings settings;
+		for (int i = 2; i+1 < argc; i+=2)
+		{
+			string option = argv[i];
+			if (option == "--frames")
+				settings.frames = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+			else if (option == "--size")
+				sscanf(argv[i+1], "%dx%d", &settings.width, &settings.height);
+			else if (option == "--dump")
+				settings.dump_prefix = argv[i+1];
+			else if (option == "--shadows")
+				ShadowOption(argv[i+1], settings);
+			else if (option == "--shadow-size")
+				settings.shadow_resolution = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+			else
+				cerr << "Unknown option " << option << endl;
+		}
+		return VisualDebugger::RenderBenchmark(settings);
+	}
+
+	//headless physics benchmark: --scenario-bench [--scenario name] [--warmup N] [--steps N] [--seed S]
+	//[--json file] [--baseline file] [--tolerance fraction] [--memory heap|pools] [--save-checkpoint prefix] [--checkpoint prefix]
+	if ((argc > 1) && (string(argv[1]) == "--scenario-bench"))
+	{
+		PhysicsEngine::ScenarioBenchmarkSettings settings;
+		for (int i = 2; i+1 < argc; i+=2)
+		{
+			string option = argv[i];
+			if (option == "--scenario")
+				settings.scenario = argv[i+1];
+			else if (option == "--warmup")
+				settings.warmup = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 0;
+			else if (option == "--steps")
+				settings.steps = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+			else if (option == "--seed")
+				settings.seed = (unsigned int)strtoul(argv[i+1], 0, 10);
+			else if (option == "--json")
+				settings.json = argv[i+1];
+			else if (option == "--baseline")
+				settings.baseline = argv[i+1];
+			else if (option == "--tolerance")
+				settings.tolerance = atof(argv[i+1]);
+			else if (option == "--memory")
+				settings.backend = MemoryBackend(argv[i+1]);
+			else if (option == "--save-checkpoint")
+				settings.save_checkpoint = argv[i+1];
+			else if (option == "--checkpoint")
+				settings.checkpoint = argv[i+1];
+			else
+				cerr << "Unknown option " << option << endl;
+		}
+		return PhysicsEngine::ScenarioBenchmark(settings);
+	}
+
+	//determinism check: --determinism-check [--scenario name] [--steps N] [--seed S] [--threads A,B] [--memory heap|pools]
+	if ((argc > 1) && (string(argv[1]) == "--determinism-check"))
+	{
+		PhysicsEngine::DeterminismCheckSettings settings;
+		for (int i = 2; i+1 < argc; i+=2)
+		{
+			string option = argv[i];
+			if (option == "--scenario")
+				settings.scenario = argv[i+1];
+			else if (option == "--steps")
+				settings.steps = (atoi(argv[i+1]) > 0) ? atoi(argv[i+1]) : 1;
+			else if (option == "--seed")
+				settings.seed = (unsigned int)strtoul(argv[i+1], 0, 10);
+			else if (option == "--threads")
+			{
+				//one count runs both with it, two compare them
+				int a = 1, b = 1;
+				int n = sscanf(argv[i+1], "%d,%d", &a, &b);
+				settings.threads_a = (a > 0) ? a : 1;
+				settings.threads_b = (n == 2) ? ((b > 0) ? b : 1) : settings.threads_a;
+			}
+			else if (option == "--memory")
+				settings.backend = MemoryBackend(argv[i+1]);
+			else
+				cerr << "Unknown option " << option << endl;
+		}
+		return PhysicsEngine::DeterminismCheck(settings);
+	}
+
+	//headless replay of a recording made with 'N': --replay file [--trace file]
+	if ((argc > 2) && (string(argv[1]) == "--replay"))
+	{
+		PhysicsEngine::ReplaySettings settings;
+		settings.filename = argv[2];
+		for (int i = 3; i+1 < argc; i+=2)
+		{
+			string option = argv[i];
+			if (option == "--trace")
+				settings.trace = argv[i+1];
+			else
+				cerr << "Unknown option " << option << endl;
+		}
+		return PhysicsEngine::Replay(settings);
+	}
+
+	//match playback without simulation: --playback file [--bench]
+	if ((argc > 2) && (string(argv[1]) == "--playback"))
+	{
+		VisualDebugger::PlaybackSettings settings;
+		settings.filename = argv[2];
+		for (int i = 3; i < argc; i++)
+		{
+			string option = argv[i];
+			if (option == "--bench")
+				settings.bench = true;
+			else
+				cerr << "Unknown option " << option << endl;
+		}
+		return VisualDebugger::Playback(settings);
+	}
+
+	//game: [--memory heap|pools]
+	PhysicsEngine::MemoryBackend memory_backend = PhysicsEngine::MEMORY_HEAP;
+	if ((argc > 2) && (string(argv[1]) == "--memory"))
+		memory_backend = MemoryBackend(argv[2]);
+
 	try 
 	{ 
-		VisualDebugger::Init("Ross Mills 14589844 - Medieval Rugby", 800, 800); 
+		VisualDebugger::Init("Ross Mills 14589844 - Medieval Rugby", 800, 800, memory_backend); 
 	}
 	catch (Exception exc) 
 	{ 
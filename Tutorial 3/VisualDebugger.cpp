@@ -3,6 +3,10 @@
 #include "Extras\Camera.h"
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
+#include "Extras\FrameCapture.h"
+#include "Extras\FrameStats.h"
+#include <chrono>
+#include <stdio.h>
 
 
 namespace VisualDebugger
@@ -21,7 +25,8 @@ namespace VisualDebugger
 		EMPTY = 0,
 		HELP = 1,
 		PAUSE = 2,
-		SCORE = 3
+		SCORE = 3,
+		REPLAY = 4
 	};
 
 	//function declarations
@@ -35,38 +40,89 @@ namespace VisualDebugger
 	void exitCallback(void);
 
 	void RenderScene();
+	void EndTrace();
 	void ToggleRenderMode();
 	void HUDInit();
+	void StartReplay();
+	void StopReplay();
 
 	///simulation objects
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
 	PxReal delta_time = 1.f/60.f;
-	PxReal gForceStrength = 20;
 	RenderMode render_mode = NORMAL;
+	//debug data is only generated within this distance from the camera
+	PxReal debug_distance = 100.f;
 	const int MAX_KEYS = 256;
 	bool key_state[MAX_KEYS];
 	bool hud_show = true;
 	HUD hud;
 
-	// performance analysis 
-	HighResTimer renderTimer;
-	int renderTime;
+	///Lines of the score screen that show changing values
+	struct ScoreLines
+	{
+		unsigned int score, frame_times[FrameStats::PHASE_COUNT], shadow_time, state_changes;
+		unsigned int debug_view, debug_lines, fps, capture, actors, memory, memory_tags, rewind;
+	} score_lines;
 
-	HighResTimer updateTimer;
-	int updateTime;
+	// performance analysis 
+	typedef std::chrono::high_resolution_clock Clock;
+	FrameStats frame_stats;
+	Clock::time_point last_frame_end;
+	int frame_dump_count = 0;
+
+	//simulation statistics log, toggled with 'P'
+	PhysicsEngine::StatsLogger stats_logger;
+	int stats_log_count = 0;
+
+	//memory statistics, saved with 'G'
+	int memory_dump_count = 0;
+
+	//gameplay action recording, toggled with 'N'
+	PhysicsEngine::ActionRecorder action_recorder;
+	int action_record_count = 0;
+
+	//match recording for the playback viewer, toggled with 'E'
+	PhysicsEngine::MatchRecorder match_recorder;
+	int match_record_count = 0;
+
+	//the last 10 s of the match for instant replays, 'Y' replays, 'O' toggles replays of goals and wall hits
+	PhysicsEngine::RewindBuffer rewind_buffer(600);
+	const PxU32 replay_length = 240;
+	//frames of the rewind buffer still to show, the simulation waits during a replay
+	PxU32 replay_frame = 0;
+	PxU32 replay_end = 0;
+	bool auto_replay = true;
+	//goals and wall hits already replayed
+	PxU32 highlights_seen = 0;
+
+	//checkpoints of the scene, '1' saves and '2' goes back to the last one
+	int checkpoint_count = 0;
+	string last_checkpoint;
+
+	//profiler trace, started with 'T'
+	const int trace_length = 120;
+	int trace_frames_left = 0;
+	int trace_count = 0;
+
+	//video capture, toggled with F11
+	FrameCapture capture;
+	int capture_count = 0;
 
 	SecTimer fpsTimer;
 	int numOfFrames = 0;
 	int fps;
 
 	//Init the debugger
-	void Init(const char *window_name, int width, int height)
+	void Init(const char *window_name, int width, int height, PhysicsEngine::MemoryBackend memory_backend)
 	{
+		Profiler::ThreadName("Main");
+
 		///Init PhysX
-		PhysicsEngine::PxInit();
+		PhysicsEngine::PxInit(memory_backend);
 		scene = new PhysicsEngine::MyScene();
 		scene->Init();
+		scene->RecordRewind(&rewind_buffer);
 
 		///Init renderer
 		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
@@ -117,14 +173,21 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Display");
 		hud.AddLine(HELP, "    F5 - show score/performance");
-		hud.AddLine(HELP, "    F6 - shadows on/off");
+		hud.AddLine(HELP, "    F6 - shadows off/low/medium/high");
 		hud.AddLine(HELP, "    F7 - render mode");
+		hud.AddLine(HELP, "    F11 - video capture on/off");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Camera");
 		hud.AddLine(HELP, "    W,S,A,D,Q,Z - forward,backward,left,right,up,down");
 		hud.AddLine(HELP, "    mouse + click - change orientation");
 		hud.AddLine(HELP, "    F8 - reset view");
 		hud.AddLine(HELP, "");
+		hud.AddLine(HELP, " Debug view");
+		hud.AddLine(HELP, "    F1 - collision shapes on/off");
+		hud.AddLine(HELP, "    F2 - joint frames on/off");
+		hud.AddLine(HELP, "    F3 - joint limits on/off");
+		hud.AddLine(HELP, "    F4 - contact points on/off");
+		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Force (applied to the selected actor)");
 		hud.AddLine(HELP, "    I,K,J,L,U,M - forward,backward,left,right,up,down");
 		//add a pause screen
@@ -132,6 +195,53 @@ namespace VisualDebugger
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "   Simulation paused. Press F10 to continue.");
+		//add a replay screen
+		hud.AddLine(REPLAY, "");
+		hud.AddLine(REPLAY, "");
+		hud.AddLine(REPLAY, "");
+		hud.AddLine(REPLAY, "   Replay. Press Y to continue.");
+		//add a score screen, the value lines are filled in by RenderScene
+		hud.AddLine(SCORE, "MEDIEVAL RUGBY");
+		hud.AddLine(SCORE, " ");
+		score_lines.score = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		hud.AddLine(SCORE, "FRAME TIMES [ms]      p50      p95      p99      max");
+		for (int i = 0; i < FrameStats::PHASE_COUNT; i++)
+			score_lines.frame_times[i] = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		score_lines.shadow_time = hud.AddLine(SCORE, "");
+		score_lines.state_changes = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		score_lines.debug_view = hud.AddLine(SCORE, "");
+		score_lines.debug_lines = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		score_lines.fps = hud.AddLine(SCORE, "");
+		score_lines.capture = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		score_lines.actors = hud.AddLine(SCORE, "");
+		score_lines.memory = hud.AddLine(SCORE, "");
+		score_lines.memory_tags = hud.AddLine(SCORE, "");
+		score_lines.rewind = hud.AddLine(SCORE, "");
+		hud.AddLine(SCORE, " ");
+		hud.AddLine(SCORE, "B: spawn a ball");
+		hud.AddLine(SCORE, "V: spawn 1000 balls");
+		hud.AddLine(SCORE, "C: spawn 100 balls");
+		hud.AddLine(SCORE, "X: spawn 20 jousters");
+		hud.AddLine(SCORE, " ");
+		hud.AddLine(SCORE, "F: fire field goal");
+		hud.AddLine(SCORE, "J: move catapult left");
+		hud.AddLine(SCORE, "L: move catapult right");
+		hud.AddLine(SCORE, " ");
+		hud.AddLine(SCORE, "E: record match on/off");
+		hud.AddLine(SCORE, "G: save memory statistics");
+		hud.AddLine(SCORE, "H: save frame times");
+		hud.AddLine(SCORE, "N: record actions on/off");
+		hud.AddLine(SCORE, "O: replay goals and wall hits on/off");
+		hud.AddLine(SCORE, "P: log step statistics on/off");
+		hud.AddLine(SCORE, "T: record a trace (" + std::to_string(trace_length) + " frames)");
+		hud.AddLine(SCORE, "Y: replay the last " + std::to_string(replay_length/60) + " s");
+		hud.AddLine(SCORE, "1: save a checkpoint");
+		hud.AddLine(SCORE, "2: load the last checkpoint");
 		//set font size for all screens
 		hud.FontSize(0.018f);
 		//set font color for all screens
@@ -147,31 +257,45 @@ namespace VisualDebugger
 	//Render the scene and perform a single simulation step
 	void RenderScene()
 	{
-		// start render timer
-		renderTimer.resetChronoTimer();
+		//write the trace once enough frames are recorded
+		if (trace_frames_left && (--trace_frames_left == 0))
+			EndTrace();
+
+		PROFILE_ZONE("Frame");
+		Clock::time_point frame_start = Clock::now();
 
 		//handle pressed keys
 		KeyHold();
 
+		//poses of the next replay frame instead of the simulated ones
+		if (replay_frame < replay_end)
+			scene->ShowRewind(rewind_buffer, replay_frame++);
+
+		Clock::time_point render_start = Clock::now();
+
 		//start rendering
 		Renderer::Start(camera->getEye(), camera->getDir());
 
-		if ((render_mode == DEBUG) || (render_mode == BOTH))
+		//actors first: the shadow pass reuses the depth buffer
+		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
-			Renderer::Render(scene->Get()->getRenderBuffer());
+			Renderer::Render(scene->GetRenderProxies());
 		}
 
-		if ((render_mode == NORMAL) || (render_mode == BOTH))
+		if ((render_mode == DEBUG) || (render_mode == BOTH))
 		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			Renderer::Render(scene->Get()->getRenderBuffer());
+
+			//used by the next simulation step
+			scene->VisualisationCullingBox(Renderer::ViewBounds(debug_distance));
 		}
 
 		//adjust the HUD state
 		if (hud_show)
 		{
-			if (scene->Pause())
+			if (replay_end)
+				hud.ActiveScreen(REPLAY);
+			else if (scene->Pause())
 				hud.ActiveScreen(PAUSE);
 			else
 				hud.ActiveScreen(HELP);
@@ -182,61 +306,142 @@ namespace VisualDebugger
 			// show score hud
 		}
 
-		string scoreText = "SCORE: " + std::to_string(PhysicsEngine::score / 4); // divide by 4 as ball has 4 shapes
-		string updateLoopTime = "UPDATE LOOP TIME [micro seconds]: " + std::to_string(updateTime);
-		string renderLoopTime = "RENDER LOOP TIME [micro seconds]: " + std::to_string(renderTime);
-		string fpsOutput = "FPS: " + std::to_string(fps);
-		std::vector<PxActor*> actors = scene->GetAllActors();
-		string actorOutput = "Number of Actors: " + std::to_string(actors.size());
-
-
-		hud.FontSize(0.018f);
-		hud.Color(PxVec3(0.f, 0.f, 0.f));
-		hud.Clear(SCORE);
-		hud.AddLine(SCORE, "MEDIEVAL RUGBY");
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, scoreText);
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, updateLoopTime);
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, renderLoopTime);
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, fpsOutput);
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, actorOutput);
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, "B: spawn a ball");
-		hud.AddLine(SCORE, "V: spawn 1000 balls");
-		hud.AddLine(SCORE, "C: spawn 100 balls");
-		hud.AddLine(SCORE, "X: spawn 20 jousters");
-		hud.AddLine(SCORE, " ");
-		hud.AddLine(SCORE, "F: fire field goal");
-		hud.AddLine(SCORE, "J: move catapult left");
-		hud.AddLine(SCORE, "L: move catapult right");
+		//only lines whose values changed get a new string, the rest keep their cached glyphs
+		if (hud.ActiveScreen() == SCORE)
+		{
+			PROFILE_ZONE("HUD update");
+			HUDScreen* score_screen = hud.Screen(SCORE);
+			const Renderer::Stats& stats = Renderer::GetStats();
 
-		//set font size for all screens
-		hud.FontSize(0.018f);
-		//set font color for all screens
-		hud.Color(PxVec3(0.f, 0.f, 0.f));
-			
+			if (score_screen->Stale(score_lines.score, HUDKey(PhysicsEngine::score)))
+				score_screen->SetLine(score_lines.score, "SCORE: " + std::to_string(PhysicsEngine::score / 4)); // divide by 4 as ball has 4 shapes
+			for (int i = 0; i < FrameStats::PHASE_COUNT; i++)
+			{
+				//shown with 0.01ms resolution
+				const FrameStats::Percentiles& p = frame_stats.Get((FrameStats::Phase)i);
+				if (score_screen->Stale(score_lines.frame_times[i], HUDKey((int)(p.p50*100.f), (int)(p.p95*100.f), (int)(p.p99*100.f), (int)(p.max*100.f))))
+				{
+					char line[128];
+					snprintf(line, sizeof(line), "  %-16s %8.2f %8.2f %8.2f %8.2f", FrameStats::Name((FrameStats::Phase)i), p.p50, p.p95, p.p99, p.max);
+					score_screen->SetLine(score_lines.frame_times[i], line);
+				}
+			}
+			const char* quality_names[] = { "low", "medium", "high" };
+			if (score_screen->Stale(score_lines.shadow_time, HUDKey((int)stats.shadow_time, stats.shadow_map_size, stats.shadow_casters, Renderer::GetShadowQuality())))
+				score_screen->SetLine(score_lines.shadow_time, "SHADOW PASS TIME [micro seconds]: " + std::to_string((int)stats.shadow_time) +
+					" (" + quality_names[Renderer::GetShadowQuality()] + ", " + std::to_string(stats.shadow_map_size) + "px, " + std::to_string(stats.shadow_casters) + " casters)");
+			if (score_screen->Stale(score_lines.state_changes, HUDKey(stats.state_changes, stats.state_changes_unsorted)))
+				score_screen->SetLine(score_lines.state_changes, "STATE CHANGES: " + std::to_string(stats.state_changes) + " (unsorted " + std::to_string(stats.state_changes_unsorted) + ")");
+
+			bool debug_flags[] = { scene->Visualisation(),
+				scene->Visualisation(PxVisualizationParameter::eCOLLISION_SHAPES),
+				scene->Visualisation(PxVisualizationParameter::eJOINT_LOCAL_FRAMES),
+				scene->Visualisation(PxVisualizationParameter::eJOINT_LIMITS),
+				scene->Visualisation(PxVisualizationParameter::eCONTACT_POINT) };
+			PxU64 debug_key = 0;
+			for (unsigned int i = 0; i < 5; i++)
+				debug_key |= (PxU64)debug_flags[i] << i;
+			if (score_screen->Stale(score_lines.debug_view, HUDKey(debug_key)))
+				score_screen->SetLine(score_lines.debug_view, "DEBUG VIEW: " + string(debug_flags[0] ? "on" : "off") +
+					" (F1 shapes " + (debug_flags[1] ? "on" : "off") +
+					", F2 frames " + (debug_flags[2] ? "on" : "off") +
+					", F3 limits " + (debug_flags[3] ? "on" : "off") +
+					", F4 contacts " + (debug_flags[4] ? "on" : "off") + ")");
+
+			const PxRenderBuffer& debug_data = scene->Get()->getRenderBuffer();
+			if (score_screen->Stale(score_lines.debug_lines, HUDKey(debug_data.getNbLines(), debug_data.getNbTriangles())))
+				score_screen->SetLine(score_lines.debug_lines, "DEBUG LINES: " + std::to_string(debug_data.getNbLines()) + ", TRIANGLES: " + std::to_string(debug_data.getNbTriangles()));
+			if (score_screen->Stale(score_lines.fps, HUDKey(fps)))
+				score_screen->SetLine(score_lines.fps, "FPS: " + std::to_string(fps));
+			if (score_screen->Stale(score_lines.capture, HUDKey(capture.Active(), capture.FramesWritten(), capture.FramesDropped(), (int)capture.Latency())))
+				score_screen->SetLine(score_lines.capture, "CAPTURE: " + string(capture.Active() ? "on" : "off") + ", " + std::to_string(capture.FramesWritten()) + " written, " +
+					std::to_string(capture.FramesDropped()) + " dropped, latency " + std::to_string((int)capture.Latency()) + " ms");
+
+			PxU32 nb_actors = scene->Get()->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC | PxActorTypeSelectionFlag::eCLOTH);
+			if (score_screen->Stale(score_lines.actors, HUDKey(nb_actors)))
+				score_screen->SetLine(score_lines.actors, "Number of Actors: " + std::to_string(nb_actors));
+
+			//shown in KB
+			PhysicsEngine::TrackingAllocator& allocator = PhysicsEngine::GetTrackingAllocator();
+			PhysicsEngine::MemoryStats memory = allocator.Total();
+			if (score_screen->Stale(score_lines.memory, HUDKey(memory.live_bytes >> 10, memory.peak_bytes >> 10, memory.live_count)))
+				score_screen->SetLine(score_lines.memory, "MEMORY [KB]: " + std::to_string(memory.live_bytes >> 10) + " live, " +
+					std::to_string(memory.peak_bytes >> 10) + " peak, " + std::to_string(memory.live_count) + " allocations");
+
+			string tags_line = "  ";
+			PxU64 tags_key = 0;
+			for (int i = 0; i < PhysicsEngine::MEMORY_TAG_COUNT; i++)
+			{
+				size_t kb = allocator.Tag((PhysicsEngine::MemoryTag)i).live_bytes >> 10;
+				tags_line += string(i ? ", " : "") + PhysicsEngine::TrackingAllocator::TagName((PhysicsEngine::MemoryTag)i) + " " + std::to_string(kb);
+				tags_key = HUDKey(tags_key, kb);
+			}
+			if (score_screen->Stale(score_lines.memory_tags, tags_key))
+				score_screen->SetLine(score_lines.memory_tags, tags_line);
+
+			//write cost in us, history and memory in 0.1 s and KB
+			int rewind_seconds = (int)(rewind_buffer.FrameCount()*delta_time*10.f);
+			int rewind_write = (int)rewind_buffer.AverageWrite();
+			size_t rewind_used = rewind_buffer.BytesUsed() >> 10, rewind_ceiling = rewind_buffer.MemoryCeiling() >> 10;
+			if (score_screen->Stale(score_lines.rewind, HUDKey(HUDKey(rewind_seconds, rewind_write, rewind_used, rewind_ceiling), auto_replay)))
+				score_screen->SetLine(score_lines.rewind, "REWIND: " + std::to_string(rewind_seconds/10) + "." + std::to_string(rewind_seconds%10) + " s, " +
+					std::to_string(rewind_write) + " us/step, " + std::to_string(rewind_used) + " / " + std::to_string(rewind_ceiling) + " KB, replays " + (auto_replay ? "on" : "off"));
+		}
 
 		//render HUD
 		hud.Render();
 
+		//frame time graph with 60 and 30 fps marks
+		if (hud.ActiveScreen() == SCORE)
+		{
+			static std::vector<PxReal> graph;
+			graph.resize(frame_stats.Count());
+			for (unsigned int i = 0; i < graph.size(); i++)
+				graph[i] = PxMax(frame_stats.Frame(FrameStats::FRAME, i), 0.f);
+
+			static const PxReal marks_data[] = { 1000.f/60.f, 1000.f/30.f };
+			static const std::vector<PxReal> marks(marks_data, marks_data + 2);
+			Renderer::RenderGraph(graph, PxVec2(0.55f, 0.75f), PxVec2(0.4f, 0.2f),
+				PxMax(1000.f/20.f, frame_stats.Get(FrameStats::FRAME).max), PxVec3(0.f, 0.f, 0.f), marks);
+		}
+
+		//read the frame back before the buffers are swapped
+		capture.CaptureFrame(Renderer::WindowWidth(), Renderer::WindowHeight());
+
 		//finish rendering
 		Renderer::Finish();
 
-		// get render time
-		renderTime = renderTimer.getChronoTime();
-
-		// reset update timer
-		updateTimer.resetChronoTimer();
+		Clock::time_point render_end = Clock::now();
 
 		//perform a single simulation step
-		scene->Update(delta_time);
+		PxU32 steps = scene->StepCount();
+		if (!replay_end)
+		{
+			scene->Update(delta_time);
+
+			if (auto_replay && (scene->Highlights() != highlights_seen))
+				StartReplay();
+		}
+		else if (replay_frame >= replay_end)
+			StopReplay();
 
-		// get update time
-		updateTime = updateTimer.getChronoTime();
+		Clock::time_point frame_end = Clock::now();
+
+		const PhysicsEngine::StepTimes& step_times = scene->GetStepTimes();
+		frame_stats.Record(FrameStats::INPUT, std::chrono::duration<float, std::milli>(render_start - frame_start).count());
+		frame_stats.Record(FrameStats::RENDER, std::chrono::duration<float, std::milli>(render_end - render_start).count());
+		//the step times are those of the last step, paused or replaying frames have none
+		if (scene->StepCount() != steps)
+		{
+			frame_stats.Record(FrameStats::GAMEPLAY, step_times.gameplay);
+			frame_stats.Record(FrameStats::SIMULATE, step_times.simulate);
+			frame_stats.Record(FrameStats::FETCH, step_times.fetch);
+		}
+		//includes the time spent outside of this function (buffer swap, event handling)
+		if (last_frame_end != Clock::time_point())
+			frame_stats.Record(FrameStats::FRAME, std::chrono::duration<float, std::milli>(frame_end - last_frame_end).count());
+		frame_stats.EndFrame();
+		last_frame_end = frame_end;
 
 		// calulate fps
 		numOfFrames++;
@@ -258,6 +463,130 @@ namespace VisualDebugger
 		case 'R':
 			scene->ExampleKeyPressHandler();
 			break;
+		case 'P':
+			//simulation statistics log on/off
+			if (stats_logger.Active())
+			{
+				scene->LogStatistics(0);
+				stats_logger.Stop();
+				cout << "Logged " << stats_logger.StepsLogged() << " steps, " << stats_logger.StepsDropped() << " dropped" << endl;
+			}
+			else if (stats_logger.Start("stats_" + std::to_string(stats_log_count++) + ".csv"))
+				scene->LogStatistics(&stats_logger);
+			break;
+		case 'T':
+			//record a profiler trace
+			if (!Profiler::Capturing())
+			{
+				Profiler::BeginCapture();
+				trace_frames_left = trace_length;
+			}
+			break;
+		case 'G':
+		{
+			//save the memory statistics per tag and allocation type
+			string filename = "memory_" + std::to_string(memory_dump_count++) + ".csv";
+			if (PhysicsEngine::GetTrackingAllocator().Dump(filename))
+				cout << "Saved memory statistics to " << filename << endl;
+			else
+				cerr << "Could not write " << filename << endl;
+			break;
+		}
+		case 'N':
+			//action recording on/off, a recording starts from a reset scene with a new seed
+			if (action_recorder.Active())
+			{
+				scene->RecordActions(0);
+				action_recorder.Stop(scene->StepCount(), scene->Hash());
+				cout << "Recorded " << action_recorder.Count() << " actions" << endl;
+			}
+			else
+			{
+				PhysicsEngine::ActionHeader header;
+				header.seed = (unsigned int)std::chrono::system_clock::now().time_since_epoch().count();
+				header.delta_time = delta_time;
+				header.backend = PhysicsEngine::GetTrackingAllocator().Backend();
+				scene->Seed(header.seed);
+				scene->Reset();
+				string filename = "actions_" + std::to_string(action_record_count++) + ".rec";
+				if (action_recorder.Start(filename, header, scene->StepCount()))
+				{
+					scene->RecordActions(&action_recorder);
+					cout << "Recording actions to " << filename << endl;
+				}
+			}
+			break;
+		case 'E':
+			//match recording on/off
+			if (match_recorder.Active())
+			{
+				scene->RecordMatch(0);
+				match_recorder.Stop();
+				cout << "Recorded " << match_recorder.FramesWritten() << " frames, " << (match_recorder.BytesWritten() >> 10) << " KB" << endl;
+			}
+			else
+			{
+				string filename = "match_" + std::to_string(match_record_count++) + ".mrec";
+				if (match_recorder.Start(filename, delta_time))
+				{
+					scene->RecordMatch(&match_recorder);
+					cout << "Recording the match to " << filename << endl;
+				}
+			}
+			break;
+		case 'Y':
+			//instant replay on/off
+			if (replay_end)
+				StopReplay();
+			else
+				StartReplay();
+			break;
+		case 'O':
+			//replays of goals and wall hits on/off
+			auto_replay = !auto_replay;
+			highlights_seen = scene->Highlights();
+			break;
+		case '1':
+		{
+			//save the scene
+			string filename = "checkpoint_" + std::to_string(checkpoint_count++) + ".pxck";
+			if (scene->Save(filename))
+			{
+				last_checkpoint = filename;
+				cout << "Saved the scene to " << filename << endl;
+			}
+			break;
+		}
+		case '2':
+			//back to the last saved scene, the history of the rewind buffer goes with the old one
+			if (last_checkpoint.empty())
+				break;
+			if (replay_end)
+				StopReplay();
+			//a recording cannot be replayed across a load, it ends with the scene before it
+			if (action_recorder.Active())
+			{
+				scene->RecordActions(0);
+				action_recorder.Stop(scene->StepCount(), scene->Hash());
+				cout << "Recorded " << action_recorder.Count() << " actions" << endl;
+			}
+			if (scene->Load(last_checkpoint))
+			{
+				//the restored count is not a new highlight
+				highlights_seen = scene->Highlights();
+				cout << "Loaded " << last_checkpoint << endl;
+			}
+			break;
+		case 'H':
+		{
+			//save the frame time history
+			string filename = "frame_times_" + std::to_string(frame_dump_count++) + ".csv";
+			if (frame_stats.Dump(filename))
+				cout << "Saved " << frame_stats.Count() << " frames to " << filename << endl;
+			else
+				cerr << "Could not write " << filename << endl;
+			break;
+		}
 		default:
 			break;
 		}
@@ -320,43 +649,39 @@ namespace VisualDebugger
 		{
 			// Force controls on the selected actor
 		case 'I': //forward
-			//scene->GetSelectedActor()->addForce(PxVec3(0,0,-1)*gForceStrength);
 			break;
 		case 'K': //backward
-			//scene->GetSelectedActor()->addForce(PxVec3(0,0,1)*gForceStrength);
 			break;
 		case 'J': //left
-			//scene->GetSelectedActor()->addForce(PxVec3(-1,0,0)*gForceStrength);
-			scene->moveCatapultLeft();
+			scene->Queue(PhysicsEngine::GameAction::CATAPULT_LEFT);
 			break;
 		case 'L': //right
-			//scene->GetSelectedActor()->addForce(PxVec3(1,0,0)*gForceStrength);
-			scene->moveCatapultRight();
+			scene->Queue(PhysicsEngine::GameAction::CATAPULT_RIGHT);
 			break;
 		case 'U': //up
-			scene->GetSelectedActor()->addForce(PxVec3(0,1,0)*gForceStrength);
+			scene->Queue(PhysicsEngine::GameAction::FORCE_UP);
 			break;
 		case 'M': //down
-			scene->GetSelectedActor()->addForce(PxVec3(0,-1,0)*gForceStrength);
+			scene->Queue(PhysicsEngine::GameAction::FORCE_DOWN);
 			break;
 		case 'F' :
-			scene->fieldGoal();
+			scene->Queue(PhysicsEngine::GameAction::FIELD_GOAL);
 			// call fucntion to start joint movement
 			break;
 		case 'B':
-			scene->spawnBalls();
+			scene->Queue(PhysicsEngine::GameAction::SPAWN_BALL);
 			// spawn balls
 			break;
 		case 'V':
-			scene->spawn1000Balls();
+			scene->Queue(PhysicsEngine::GameAction::SPAWN_1000_BALLS);
 			// spawn balls
 			break;
 		case 'C':
-			scene->spawn100Balls();
+			scene->Queue(PhysicsEngine::GameAction::SPAWN_100_BALLS);
 			// spawn balls
 			break;
 		case 'X':
-			scene->spawnJoust();
+			scene->Queue(PhysicsEngine::GameAction::SPAWN_JOUST);
 			break;
 		default:
 			break;
@@ -369,14 +694,36 @@ namespace VisualDebugger
 		//simulation control
 		switch (key)
 		{
+			//debug view categories
+		case GLUT_KEY_F1:
+			scene->ToggleVisualisation(PxVisualizationParameter::eCOLLISION_SHAPES);
+			break;
+		case GLUT_KEY_F2:
+			scene->ToggleVisualisation(PxVisualizationParameter::eJOINT_LOCAL_FRAMES);
+			break;
+		case GLUT_KEY_F3:
+			scene->ToggleVisualisation(PxVisualizationParameter::eJOINT_LIMITS);
+			break;
+		case GLUT_KEY_F4:
+			scene->ToggleVisualisation(PxVisualizationParameter::eCONTACT_POINT);
+			break;
+
 			//display control
 		case GLUT_KEY_F5:
 			//hud on/off
 			hud_show = !hud_show;
 			break;
 		case GLUT_KEY_F6:
-			//shadows on/off
-			Renderer::ShowShadows(!Renderer::ShowShadows());
+			//shadows off, low, medium, high
+			if (!Renderer::ShowShadows())
+			{
+				Renderer::ShowShadows(true);
+				Renderer::SetShadowQuality(Renderer::SHADOW_LOW);
+			}
+			else if (Renderer::GetShadowQuality() == Renderer::SHADOW_HIGH)
+				Renderer::ShowShadows(false);
+			else
+				Renderer::SetShadowQuality((Renderer::ShadowQuality)(Renderer::GetShadowQuality() + 1));
 			break;
 		case GLUT_KEY_F7:
 			//toggle render mode
@@ -390,15 +737,22 @@ namespace VisualDebugger
 			//simulation control
 		case GLUT_KEY_F9:
 			//select next actor
-			scene->SelectNextActor();
+			scene->Queue(PhysicsEngine::GameAction::SELECT_NEXT);
 			break;
 		case GLUT_KEY_F10:
 			//toggle scene pause
 			scene->Pause(!scene->Pause());
 			break;
+		case GLUT_KEY_F11:
+			//video capture on/off
+			if (capture.Active())
+				capture.Stop();
+			else
+				capture.Start("capture_" + std::to_string(capture_count++), FrameCapture::RAW_STREAM);
+			break;
 		case GLUT_KEY_F12:
 			//resect scene
-			scene->Reset();
+			scene->Queue(PhysicsEngine::GameAction::RESET);
 			break;
 		default:
 			break;
@@ -431,12 +785,15 @@ namespace VisualDebugger
 	//handle holded keys
 	void KeyHold()
 	{
+		PROFILE_ZONE("KeyHold");
 		for (int i = 0; i < MAX_KEYS; i++)
 		{
 			if (key_state[i]) // if key down
 			{
 				CameraInput(i);
-				ForceInput(i);
+				//the scene does not take input during a replay
+				if (!replay_end)
+					ForceInput(i);
 				UserKeyHold(i);
 			}
 		}
@@ -463,6 +820,36 @@ namespace VisualDebugger
 		mMouseY = y;
 	}
 
+	void StartReplay()
+	{
+		//events shown by this replay do not start another one
+		highlights_seen = scene->Highlights();
+
+		PxU32 count = rewind_buffer.FrameCount();
+		if (!count)
+			return;
+
+		replay_frame = (count > replay_length) ? count - replay_length : 0;
+		replay_end = count;
+	}
+
+	void StopReplay()
+	{
+		replay_frame = replay_end = 0;
+		scene->ShowSimulated();
+		highlights_seen = scene->Highlights();
+	}
+
+	void EndTrace()
+	{
+		trace_frames_left = 0;
+		string filename = "trace_" + std::to_string(trace_count++) + ".json";
+		if (Profiler::EndCapture(filename))
+			cout << "Saved trace to " << filename << endl;
+		else
+			cerr << "Could not write " << filename << endl;
+	}
+
 	void ToggleRenderMode()
 	{
 		if (render_mode == NORMAL)
@@ -471,11 +858,27 @@ namespace VisualDebugger
 			render_mode = BOTH;
 		else if (render_mode == BOTH)
 			render_mode = NORMAL;
+
+		//no debug data is generated while nothing shows it
+		scene->Visualisation(render_mode != NORMAL);
 	}
 
 	///exit callback
 	void exitCallback(void)
 	{
+		if (Profiler::Capturing())
+			EndTrace();
+		capture.Stop();
+		scene->LogStatistics(0);
+		stats_logger.Stop();
+		if (action_recorder.Active())
+		{
+			scene->RecordActions(0);
+			action_recorder.Stop(scene->StepCount(), scene->Hash());
+		}
+		scene->RecordMatch(0);
+		match_recorder.Stop();
+		scene->RecordRewind(0);
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
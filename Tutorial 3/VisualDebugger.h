@@ -7,7 +7,7 @@ namespace VisualDebugger
 	using namespace physx;
 
 	///Init visualisation
-	void Init(const char *window_name, int width=512, int height=512);
+	void Init(const char *window_name, int width=512, int height=512, PhysicsEngine::MemoryBackend memory_backend=PhysicsEngine::MEMORY_HEAP);
 
 	///Start visualisation
 	void Start();
@@ -1,6 +1,9 @@
 #include "Renderer.h"
 #include <iostream>
 #include <vector>
+#include <map>
+#include <string.h>
+#include <xmmintrin.h>
 #include "UserData.h"
 
 using namespace std;
@@ -156,44 +159,149 @@ namespace VisualDebugger
 			}
 		}
 
-		void RenderCloth(const PxCloth* cloth)
+		///Per-cloth render buffers, kept between frames
+		struct ClothBuffers
 		{
-			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
-			PxVec3* color = ((UserData*)cloth->userData)->color;
+			//particles are copied as they are (position + inverse weight), so 16 byte strides
+			std::vector<PxVec4> verts;
+			std::vector<PxVec4> norms;
+			bool valid;
 
-			PxU32 quad_count = mesh_desc->quads.count;
-			PxU32* quads = (PxU32*)mesh_desc->quads.data;
+			ClothBuffers() : valid(false) {}
+		};
+
+		std::map<const PxCloth*, ClothBuffers*> cloth_buffers;
+
+		///Releases the buffers of cloths going away
+		class DeletionListener : public PxDeletionListener
+		{
+		public:
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				std::map<const PxCloth*, ClothBuffers*>::iterator cloth = cloth_buffers.find((const PxCloth*)observed);
+				if (cloth != cloth_buffers.end())
+				{
+					delete cloth->second;
+					cloth_buffers.erase(cloth);
+				}
+			}
+		};
 
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
+		DeletionListener deletion_listener;
 
-			//get verts data
-			cloth->lockParticleData();
+		inline __m128 Cross(const __m128& a, const __m128& b)
+		{
+			__m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+			return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		///Accumulate quad normals into vertex normals and normalise them (SSE)
+		void ComputeClothNormals(const PxVec4* verts, PxVec4* norms, PxU32 vert_count, const PxU32* quads, PxU32 quad_count)
+		{
+			memset(norms, 0, vert_count*sizeof(PxVec4));
+
+			//w holds the inverse weight; it cancels out in the cross product so the normals keep w = 0
+			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			{
+				__m128 v0 = _mm_loadu_ps(&verts[quads[i]].x);
+				__m128 e0 = _mm_sub_ps(_mm_loadu_ps(&verts[quads[i+1]].x), v0);
+				__m128 e1 = _mm_sub_ps(_mm_loadu_ps(&verts[quads[i+2]].x), v0);
+				__m128 n = Cross(e1, e0);
+
+				for (PxU32 j = 0; j < 4; j++)
+				{
+					float* norm = &norms[quads[i+j]].x;
+					_mm_storeu_ps(norm, _mm_add_ps(_mm_loadu_ps(norm), n));
+				}
+			}
+
+			//normalise four normals at a time
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 three = _mm_set1_ps(3.f);
+			const __m128 epsilon = _mm_set1_ps(1e-20f);
+			PxU32 i = 0;
+			for (; i+4 <= vert_count; i+=4)
+			{
+				__m128 x = _mm_loadu_ps(&norms[i].x);
+				__m128 y = _mm_loadu_ps(&norms[i+1].x);
+				__m128 z = _mm_loadu_ps(&norms[i+2].x);
+				__m128 w = _mm_loadu_ps(&norms[i+3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				__m128 length2 = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), epsilon);
+				//reciprocal square root estimate refined with one Newton-Raphson step
+				__m128 r = _mm_rsqrt_ps(length2);
+				r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(length2, r), r)));
+				x = _mm_mul_ps(x, r);
+				y = _mm_mul_ps(y, r);
+				z = _mm_mul_ps(z, r);
+
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+				_mm_storeu_ps(&norms[i].x, x);
+				_mm_storeu_ps(&norms[i+1].x, y);
+				_mm_storeu_ps(&norms[i+2].x, z);
+				_mm_storeu_ps(&norms[i+3].x, w);
+			}
+
+			for (; i < vert_count; i++)
+			{
+				PxVec3 n = norms[i].getXYZ();
+				n.normalize();
+				norms[i] = PxVec4(n, 0.f);
+			}
+		}
+
+		///Copy the particles and rebuild the normals if the cloth has moved
+		void UpdateCloth(const PxCloth* cloth, ClothBuffers& buffers, const PxU32* quads, PxU32 quad_count)
+		{
+			//nothing to do for a resting cloth
+			if (buffers.valid && cloth->isSleeping())
+				return;
 
 			PxClothParticleData* particle_data = cloth->lockParticleData();
 			if (!particle_data)
 				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
+
+			PxU32 vert_count = cloth->getNbParticles();
+			bool changed = !buffers.valid || (buffers.verts.size() != vert_count) ||
+				(memcmp(&buffers.verts.front(), particle_data->particles, vert_count*sizeof(PxVec4)) != 0);
+
+			if (changed)
+			{
+				buffers.verts.resize(vert_count);
+				buffers.norms.resize(vert_count);
+				memcpy(&buffers.verts.front(), particle_data->particles, vert_count*sizeof(PxVec4));
+			}
 
 			particle_data->unlock();
 
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			if (changed)
 			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
-
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
+				ComputeClothNormals(&buffers.verts.front(), &buffers.norms.front(), vert_count, quads, quad_count);
+				buffers.valid = true;
 			}
+		}
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+		void RenderCloth(const PxCloth* cloth)
+		{
+			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
+			PxVec3* color = ((UserData*)cloth->userData)->color;
+
+			PxU32 quad_count = mesh_desc->quads.count;
+			PxU32* quads = (PxU32*)mesh_desc->quads.data;
+
+			if (!cloth->getNbParticles() || !quad_count)
+				return;
+
+			ClothBuffers*& buffers = cloth_buffers[cloth];
+			if (!buffers)
+				buffers = new ClothBuffers();
+
+			UpdateCloth(cloth, *buffers, quads, quad_count);
+			if (!buffers->valid)
+				return;
 
 			PxTransform pose = cloth->getGlobalPose();
 			PxMat44 shapePose(pose);
@@ -206,8 +314,8 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec4), &buffers->verts.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), &buffers->norms.front());
 
 			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
 
@@ -265,6 +373,9 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			//free the cloth buffers together with their cloths
+			PxGetPhysics().registerDeletionListener(deletion_listener, PxDeletionEventFlag::eMEMORY_RELEASE);
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)